@@ -2,13 +2,15 @@
 
 #include <iostream>
 #include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 #include "tiny_dnn/tiny_dnn.h"
 
 using namespace tiny_dnn;
 using namespace tiny_dnn::activation;
 
-const size_t nthreads = 8;
-
 static void construct_simple_net(std::shared_ptr<network<sequential>> nn,
                           core::backend_t backend_type) {
     // Baby network for now...
@@ -17,19 +19,101 @@ static void construct_simple_net(std::shared_ptr<network<sequential>> nn,
        << fully_connected_layer(80, 10, true, backend_type);
 }
 
-static void leea_experiment(const std::string &data_path, const int seed) {
-    Random * random = new Random(seed);
+/**
+ * Split "key=v1,v2,..." into one assignment per value.
+ */
+static std::vector<std::string> expand_sweep(const std::string &sweep) {
+    std::vector<std::string> assignments;
+    size_t eq = sweep.find('=');
+    if (eq == std::string::npos) {
+        throw nn_error("Expected key=v1,v2,... for --sweep, got: " + sweep);
+    }
+
+    std::string key = sweep.substr(0, eq + 1);
+    std::istringstream values(sweep.substr(eq + 1));
+    std::string value;
+    while (std::getline(values, value, ',')) {
+        assignments.push_back(key + value);
+    }
+    return assignments;
+}
+
+/**
+ * Console output every tracking_stride generations, plus a CSV or JSON lines
+ * file (by extension) when a metrics path is given. A sweep writes one file
+ * per run, numbered before the extension.
+ */
+static std::shared_ptr<MetricsSink> make_metrics_sink(
+        const std::string &metrics_path, size_t run, size_t runs) {
+    auto sinks = std::make_shared<MultiMetricsSink>();
+    sinks->add(std::make_shared<ConsoleMetricsSink>());
+    if (metrics_path.empty()) {
+        return sinks;
+    }
+
+    std::string path = metrics_path;
+    size_t dot = path.rfind('.');
+    std::string extension = dot == std::string::npos ? "" : path.substr(dot);
+    if (runs > 1) {
+        path = path.substr(0, path.size() - extension.size()) + "."
+             + std::to_string(run + 1) + extension;
+    }
+
+    std::shared_ptr<MetricsSink> file;
+    if (extension == ".jsonl" || extension == ".json") {
+        file = std::make_shared<JsonLinesMetricsSink>(path);
+    }
+    else {
+        file = std::make_shared<CsvMetricsSink>(path);
+    }
+    sinks->add(std::make_shared<AsyncMetricsSink>(file));
+    return sinks;
+}
+
+static void island_experiment(std::shared_ptr<std::vector<vec_t> > labels,
+                              std::shared_ptr<std::vector<vec_t> > images,
+                              const int seed, EvoParams params) {
+    if (params.threads == 0) {
+        // Share the cores between the islands.
+        params.threads = std::max<size_t>(
+            1, std::thread::hardware_concurrency() / params.islands);
+    }
 
-    std::array<std::shared_ptr<network<sequential>>, nthreads> networks;
     core::backend_t backend_type = core::default_engine();
+    IslandModel<se> model(params, seed,
+        [&](size_t island, Random *random) {
+            // Each island pins its threads onto cpus of its own.
+            EvoParams island_params = params;
+            island_params.pin_first = island * params.threads;
+            island_params.pin_total = params.islands * params.threads;
 
-    for (size_t i = 0; i < nthreads; i++) {
+            auto nn = std::make_shared<network<sequential>>();
+            construct_simple_net(nn, backend_type);
+            return std::unique_ptr<Evolver<se> >(
+                new Evolver<se>(nn, labels, images, random, island_params));
+        });
+
+    std::vector<Migrant> champions;
+    if (params.island_processes) {
         auto nn = std::make_shared<network<sequential>>();
         construct_simple_net(nn, backend_type);
+        size_t weight_count = BatchEvaluator<se>(*nn).getWeightCount();
+        champions = model.runProcesses(weight_count);
+    }
+    else {
+        champions = model.runThreads();
+    }
 
-        networks[i] = nn;
+    for (const Migrant &champion : champions) {
+        std::cout << "Best fitness of island " << champion.source << ": "
+                  << champion.fitness << std::endl;
     }
+}
 
+static void leea_experiment(const std::string &data_path, const int seed,
+                            const std::vector<EvoParams> &runs,
+                            const std::string &resume_path,
+                            const std::string &metrics_path) {
     size_t num_classes = 10;
 
     std::cout << "Loading mnist data..." << std::endl;
@@ -44,26 +128,71 @@ static void leea_experiment(const std::string &data_path, const int seed) {
     parse_mnist_labels(data_path + "/t10k-labels.idx1-ubyte", &test_labels);
     parse_mnist_images(data_path + "/t10k-images.idx3-ubyte", &test_images, -1.0, 1.0, 0, 0); // Skip the padding.
 
-    std::cout << "Start training..." << std::endl;
+    // Every run of a sweep shares the same copy of the data.
+    auto labels = std::make_shared<std::vector<vec_t> >(one_hot_labels);
+    auto images = std::make_shared<std::vector<vec_t> >(train_images);
+
+    for (size_t run = 0; run < runs.size(); run++) {
+        std::cout << "Start training, run " << run + 1 << " of "
+                  << runs.size() << "..." << std::endl;
+        runs[run].print(std::cout);
+        std::cout << std::endl;
+
+        if (runs[run].islands > 1) {
+            island_experiment(labels, images, seed, runs[run]);
+            continue;
+        }
+
+        Random random(seed);
 
-    Evolver<se, nthreads> evo(&networks,
-                            std::make_shared<std::vector<vec_t> >(one_hot_labels),
-                            std::make_shared<std::vector<vec_t> >(train_images),
-                            random);
+        if (runs[run].engine == "es") {
+            core::backend_t backend_type = core::default_engine();
+            auto nn = std::make_shared<network<sequential>>();
+            construct_simple_net(nn, backend_type);
 
-    evo.evolve();
+            EvolutionStrategy<se> es(nn, labels, images, &random, runs[run]);
+            es.setMetricsSink(make_metrics_sink(metrics_path, run,
+                                                runs.size()));
+            es.evolve();
+            continue;
+        }
+
+        // Genomes are scored straight from the population by the batch
+        // evaluator, so a single network describing the architecture is
+        // enough.
+        core::backend_t backend_type = core::default_engine();
+        auto nn = std::make_shared<network<sequential>>();
+        construct_simple_net(nn, backend_type);
+
+        Evolver<se> evo(nn, labels, images, &random, runs[run]);
+        evo.setMetricsSink(make_metrics_sink(metrics_path, run, runs.size()));
+        if (!resume_path.empty()) {
+            std::cout << "Resuming from " << resume_path << std::endl;
+            evo.resume(resume_path);
+        }
 
-    delete random;
+        evo.evolve();
+    }
 }
 
 static void usage(const char *argv0) {
     std::cout << "Usage: " << argv0 << " --data_path path_to_dataset_folder \n"
-            << "\t--seed 0" <<
+            << "\t--seed 0\n"
+            << "\t--config params.config\n"
+            << "\t--set key=value (repeatable, applied after --config)\n"
+            << "\t--sweep key=v1,v2,... (one run per value)\n"
+            << "\t--resume snapshot (written via checkpoint_path)\n"
+            << "\t--metrics path.csv|path.jsonl (per-generation metrics)" <<
             std::endl;
 }
 
 int main(int argc, char **argv) {
     std::string data_path = "";
+    std::string config_path = "";
+    std::vector<std::string> overrides;
+    std::string sweep = "";
+    std::string resume_path = "";
+    std::string metrics_path = "";
     int seed = 0;
 
     if (argc == 2) {
@@ -82,6 +211,21 @@ int main(int argc, char **argv) {
         else if (argname == "--seed") {
             seed = atoi(argv[count + 1]);
         }
+        else if (argname == "--config") {
+            config_path = std::string(argv[count + 1]);
+        }
+        else if (argname == "--set") {
+            overrides.push_back(std::string(argv[count + 1]));
+        }
+        else if (argname == "--sweep") {
+            sweep = std::string(argv[count + 1]);
+        }
+        else if (argname == "--resume") {
+            resume_path = std::string(argv[count + 1]);
+        }
+        else if (argname == "--metrics") {
+            metrics_path = std::string(argv[count + 1]);
+        }
         else {
           std::cerr << "Invalid parameter specified - \"" << argname << "\""
                     << std::endl;
@@ -98,11 +242,54 @@ int main(int argc, char **argv) {
 
     std::cout << "Running with the following parameters: " << std::endl
             << "Data path: " << data_path << std::endl
+            << "Config: " << (config_path.empty() ? "defaults" : config_path)
+            << std::endl
             << "Seed: " << seed << std::endl
             << std::endl;
 
     try {
-        leea_experiment(data_path, seed);
+        EvoParams params;
+        if (!config_path.empty()) {
+            params = EvoParams::fromFile(config_path);
+        }
+        for (const std::string &assignment : overrides) {
+            params.set(assignment);
+        }
+
+        std::vector<EvoParams> runs;
+        if (sweep.empty()) {
+            runs.push_back(params);
+        }
+        else {
+            for (const std::string &assignment : expand_sweep(sweep)) {
+                runs.push_back(params);
+                runs.back().set(assignment);
+            }
+        }
+
+        for (const EvoParams &run : runs) {
+            run.validate();
+            if (run.engine == "es" && !resume_path.empty()) {
+                throw nn_error("--resume needs engine = leea");
+            }
+            if (run.islands > 1 && !resume_path.empty()) {
+                throw nn_error("--resume needs islands = 1");
+            }
+        }
+        // A snapshot holds a single run.
+        if (runs.size() > 1 && !resume_path.empty()) {
+            throw nn_error("--resume can't be combined with --sweep");
+        }
+        // The layers' thread pool starts on first use and is shared by
+        // every run, so it's pinned up front if any run of a sweep asks
+        // for pin_threads.
+        bool pin = false;
+        for (const EvoParams &run : runs) {
+            pin = pin || run.pin_threads;
+        }
+        set_worker_affinity(pin);
+
+        leea_experiment(data_path, seed, runs, resume_path, metrics_path);
     }
     catch (tiny_dnn::nn_error &err) {
         std::cerr << "Exception: " << err.what() << std::endl;
@@ -22,6 +22,7 @@ using namespace tiny_dnn::activation;
 #include "test_concat_layer.h"
 #include "test_convolutional_layer.h"
 #include "test_core.h"
+#include "test_dag_scheduler.h"
 #include "test_deconvolutional_layer.h"
 #include "test_dropout_layer.h"
 #include "test_fully_connected_layer.h"
@@ -31,6 +32,8 @@ using namespace tiny_dnn::activation;
 #include "test_max_pooling_layer.h"
 #include "test_models.h"
 #include "test_node.h"
+#include "test_parallel_for.h"
+#include "test_pipeline.h"
 #include "test_nodes.h"
 #include "test_power_layer.h"
 #include "test_quantization.h"
@@ -40,10 +43,31 @@ using namespace tiny_dnn::activation;
 #include "test_slice_layer.h"
 #include "test_target_cost.h"
 #include "test_tensor.h"
+#include "test_thread_pool.h"
+#include "test_topology.h"
 #include "test_evolver.h"
 #include "test_roulette.h"
+#include "test_selection.h"
+#include "test_elite_ranking.h"
+#include "test_island.h"
+#include "test_checkpoint.h"
+#include "test_metrics.h"
+#include "test_minibatch.h"
+#include "test_fitness_cache.h"
+#include "test_genome_codec.h"
+#include "test_genome_initializer.h"
+#include "test_refinement.h"
+#include "test_evolution_strategy.h"
+#include "test_speciation.h"
 #include "test_individual.h"
 #include "test_evo_random.h"
+#include "test_evo_params.h"
+#include "test_population.h"
+#include "test_batch_evaluator.h"
+#include "test_delta_evaluator.h"
+#include "test_eval_scheduler.h"
+#include "test_random_stream.h"
+#include "test_rng_service.h"
 
 #ifndef CNN_NO_SERIALIZATION
 #include "test_serialization.h"
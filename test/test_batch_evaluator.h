@@ -0,0 +1,107 @@
+#pragma once
+
+#include <memory>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(EvoBatchEvaluatorTest, matches_network_loss) {
+    Random * random = new Random(42);
+
+    network<sequential> nn;
+    nn << fully_connected_layer(6, 4) << sigmoid_layer()
+       << fully_connected_layer(4, 3, false) << tanh_layer();
+
+    BatchEvaluator<mse> evaluator(nn);
+    ASSERT_TRUE(evaluator.isSupported());
+
+    size_t weight_count = 0;
+    for (auto & l : nn) {
+        for (auto * weights : l->weights()) {
+            weight_count += weights->size();
+        }
+    }
+    EXPECT_EQ(weight_count, evaluator.getWeightCount());
+
+    std::vector<vec_t> data(5, vec_t(6));
+    std::vector<vec_t> labels(5, vec_t(3));
+    for (size_t i = 0; i < data.size(); i++) {
+        for (auto & x : data[i]) x = random->getDouble(-1, 1);
+        for (auto & t : labels[i]) t = random->getDouble(-1, 1);
+    }
+
+    BatchEvaluator<mse>::Workspace workspace;
+    for (size_t k = 0; k < 3; k++) {
+        Individual ind(weight_count, random);
+
+        int idx = 0;
+        for (auto & l : nn) {
+            l->load(*(ind.getGenome()), idx);
+        }
+
+        float_t expected = nn.get_loss<mse>(data, labels);
+        float_t actual = evaluator.evaluate(ind.getGenomeView(), data, labels,
+                                            workspace);
+        EXPECT_NEAR(expected, actual, 1e-4);
+    }
+
+    delete random;
+}
+
+TEST(EvoBatchEvaluatorTest, blocks_match_single_genomes) {
+    Random * random = new Random(7);
+
+    network<sequential> nn;
+    nn << fully_connected_layer(6, 5) << relu_layer()
+       << fully_connected_layer(5, 4) << sigmoid_layer()
+       << fully_connected_layer(4, 2, false);
+
+    BatchEvaluator<mse> evaluator(nn);
+    ASSERT_TRUE(evaluator.isSupported());
+
+    std::vector<vec_t> data(7, vec_t(6));
+    std::vector<vec_t> labels(7, vec_t(2));
+    for (size_t i = 0; i < data.size(); i++) {
+        for (auto & x : data[i]) x = random->getDouble(-1, 1);
+        for (auto & t : labels[i]) t = random->getDouble(-1, 1);
+    }
+
+    // More genomes than one block holds, and a partial block at the end.
+    const size_t count = 2 * BatchEvaluator<mse>::blockSize + 1;
+    std::vector<std::unique_ptr<Individual>> individuals;
+    std::vector<GenomeView> genomes;
+    for (size_t k = 0; k < count; k++) {
+        individuals.emplace_back(
+            new Individual(evaluator.getWeightCount(), random));
+        genomes.push_back(individuals.back()->getGenomeView());
+    }
+
+    BatchEvaluator<mse>::Workspace workspace;
+    std::vector<float_t> errors(count);
+    evaluator.evaluate(genomes.data(), count, data, labels, &errors[0],
+                       workspace);
+
+    BatchEvaluator<mse>::Workspace single;
+    for (size_t k = 0; k < count; k++) {
+        EXPECT_EQ(evaluator.evaluate(genomes[k], data, labels, single),
+                  errors[k]);
+    }
+
+    // The same workspace still serves single genomes afterwards.
+    EXPECT_EQ(errors[1], evaluator.evaluate(genomes[1], data, labels,
+                                            workspace));
+
+    delete random;
+}
+
+TEST(EvoBatchEvaluatorTest, unsupported_layers) {
+    network<sequential> nn;
+    nn << fully_connected_layer(4, 4) << dropout_layer(4, 0.5)
+       << fully_connected_layer(4, 2);
+
+    BatchEvaluator<mse> evaluator(nn);
+    EXPECT_FALSE(evaluator.isSupported());
+}
+
+}
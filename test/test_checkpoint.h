@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(EvoCheckpointTest, random_state) {
+    Random random(42);
+    random.getDouble();
+
+    Random::State state = random.getState();
+    std::vector<double> expected;
+    for (size_t i = 0; i < 100; i++) {
+        expected.push_back(random.getDouble());
+    }
+
+    Random other(7);
+    other.setState(state);
+    for (size_t i = 0; i < 100; i++) {
+        EXPECT_EQ(expected[i], other.getDouble());
+    }
+}
+
+TEST(EvoCheckpointTest, resume_is_exact) {
+    EvoTestData data_set;
+
+    // Speciation carries representatives and a threshold across
+    // generations, which the snapshot must hold too. Packed genomes must
+    // come back exactly as they were stored.
+    for (const char * precision : {"float", "fp16", "bf16", "int8"}) {
+        for (bool speciation : {false, true}) {
+            const std::string path = unique_path();
+
+            EvoParams params = make_test_params(30, 7);
+            params.checkpoint_path = path;
+            params.checkpoint_interval = 3;
+            params.speciation = speciation;
+            params.species_threshold = 0.3f;
+            params.species_target = 4;
+            params.genome_precision = precision;
+
+            Random random(1);
+            auto nn = make_test_network();
+            Evolver<se> original(nn, data_set.labels, data_set.data, &random,
+                                 params);
+            original.evolve(4); // Checkpoint at generation 3.
+
+            EvoParams resumed_params = params;
+            resumed_params.checkpoint_interval = 0;
+            resumed_params.threads = 3;
+
+            Random other_random(2);
+            auto other_nn = make_test_network();
+            Evolver<se> resumed(other_nn, data_set.labels, data_set.data,
+                                &other_random, resumed_params);
+            resumed.resume(path);
+            EXPECT_EQ(size_t(3), resumed.getCurrentGeneration());
+
+            original.evolve();
+            resumed.evolve();
+            EXPECT_EQ(size_t(7), resumed.getCurrentGeneration());
+
+            population_t expected = original.getPopulation();
+            population_t actual = resumed.getPopulation();
+            ASSERT_EQ(expected->size(), actual->size());
+            for (size_t i = 0; i < expected->size(); i++) {
+                EXPECT_EQ(*(*expected)[i]->getGenome(),
+                          *(*actual)[i]->getGenome())
+                    << precision << " " << speciation;
+                EXPECT_EQ((*expected)[i]->getFitness(),
+                          (*actual)[i]->getFitness())
+                    << precision << " " << speciation;
+            }
+
+            std::remove(path.c_str());
+        }
+    }
+}
+
+TEST(EvoCheckpointTest, rejects_other_precision) {
+    EvoTestData data_set;
+
+    const std::string path = unique_path();
+    EvoParams params = make_test_params(10, 2);
+    params.genome_precision = "int8";
+
+    Random random(1);
+    auto nn = make_test_network();
+    Evolver<se> original(nn, data_set.labels, data_set.data, &random, params);
+    original.evolve(1);
+    original.saveCheckpoint(path);
+
+    params.genome_precision = "float";
+    Random other_random(2);
+    auto other_nn = make_test_network();
+    Evolver<se> other(other_nn, data_set.labels, data_set.data, &other_random,
+                      params);
+    EXPECT_THROW(other.resume(path), nn_error);
+
+    std::remove(path.c_str());
+}
+
+TEST(EvoCheckpointTest, rejects_bad_files) {
+    const std::string path = unique_path();
+    EXPECT_THROW(SnapshotReader reader(path), nn_error);
+
+    Snapshot snapshot;
+    std::memset(&snapshot.header, 0, sizeof(snapshot.header));
+    snapshot.header.populationSize = 2;
+    snapshot.header.genomeLength = 3;
+    snapshot.fitness.assign(2, 1.0f);
+    snapshot.errors.assign(2, 0.5f);
+    snapshot.genomes.assign(6, 0.25f);
+    writeSnapshot(snapshot, path);
+
+    {
+        SnapshotReader reader(path);
+        EXPECT_EQ(uint64_t(2), reader.getHeader().populationSize);
+        EXPECT_EQ(1.0f, reader.getFitness()[1]);
+        EXPECT_EQ(float_t(0.5f), reader.getErrors()[0]);
+        EXPECT_EQ(size_t(3), reader.getGenome(1).size());
+        EXPECT_EQ(float_t(0.25f), reader.getGenome(1)[2]);
+    }
+
+#ifndef _WIN32
+    // Cut the file short.
+    std::FILE * file = std::fopen(path.c_str(), "r+b");
+    ASSERT_TRUE(file != nullptr);
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fclose(file);
+    ASSERT_EQ(0, truncate(path.c_str(), size - 4));
+    EXPECT_THROW(SnapshotReader reader(path), nn_error);
+#endif
+
+    std::remove(path.c_str());
+}
+
+}
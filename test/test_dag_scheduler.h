@@ -0,0 +1,154 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+#include "tiny_dnn/util/dag_scheduler.h"
+
+namespace tiny_dnn {
+
+TEST(dag_scheduler, width) {
+  // 0 -> {1, 2, 3} -> 4
+  std::vector<std::vector<size_t>> deps = {{}, {0}, {0}, {0}, {1, 2, 3}};
+  EXPECT_EQ(3u, dag_scheduler(deps).width());
+  EXPECT_EQ(1u, dag_scheduler({{}, {0}, {1}}).width());
+  EXPECT_EQ(0u, dag_scheduler().width());
+}
+
+TEST(dag_scheduler, runs_after_dependencies) {
+  // two chains of 20 from a common root, joined at the end.
+  std::vector<std::vector<size_t>> deps(42);
+  for (size_t i = 1; i < 41; i++) deps[i].push_back(i < 3 ? 0 : i - 2);
+  deps[41] = {39, 40};
+  dag_scheduler scheduler(deps);
+
+  size_t saved = max_concurrency();
+  for (size_t threads : {1, 2, 4}) {
+    set_max_concurrency(threads);
+    for (int rep = 0; rep < 20; rep++) {
+      std::vector<std::atomic<int>> done(deps.size());
+      for (auto &d : done) d = 0;
+      std::atomic<int> late(0);
+
+      scheduler.run([&](size_t task) {
+        for (size_t d : deps[task]) {
+          if (done[d].load() == 0) late++;
+        }
+        done[task]++;
+      });
+
+      EXPECT_EQ(0, late.load());
+      for (auto &d : done) EXPECT_EQ(1, d.load());
+    }
+  }
+  set_max_concurrency(saved);
+}
+
+namespace {
+
+bool dag_branches_overlap() {
+#if defined(CNN_SINGLE_THREAD)
+  return false;
+#elif defined(CNN_USE_THREAD_POOL)
+  return thread_pool::instance().size() >= 3;
+#else
+  return true;
+#endif
+}
+
+}  // namespace
+
+TEST(dag_scheduler, serial_trunk) {
+  // 0 -> 1 -> {2, 3, 4} -> 5 -> 6: a trunk around three branches.
+  std::vector<std::vector<size_t>> deps = {{},  {0},       {1}, {1},
+                                           {1}, {2, 3, 4}, {5}};
+  dag_scheduler scheduler(deps);
+  const std::thread::id caller = std::this_thread::get_id();
+
+  size_t saved = max_concurrency();
+  set_max_concurrency(6);
+  std::mutex mutex;
+  std::vector<bool> on_caller(deps.size()), in_region(deps.size());
+  std::vector<size_t> budget(deps.size());
+  std::atomic<size_t> in_flight(0), most(0);
+
+  scheduler.run([&](size_t task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      on_caller[task] = std::this_thread::get_id() == caller;
+      in_region[task] = parallel_region::active();
+      budget[task]    = max_concurrency();
+    }
+    if (task < 2 || task > 4) return;
+
+    // a branch waits a little for the others, to see them overlap.
+    size_t now = ++in_flight;
+    for (size_t seen = most.load(); seen < now;) {
+      most.compare_exchange_weak(seen, now);
+    }
+    auto until = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (dag_branches_overlap() && most.load() < 3 &&
+           std::chrono::steady_clock::now() < until) {
+      std::this_thread::yield();
+    }
+    --in_flight;
+  });
+  set_max_concurrency(saved);
+
+  // the trunk runs on the caller, outside any region, with the whole
+  // budget; the branches split it.
+  for (size_t task : {0, 1, 5, 6}) {
+    EXPECT_TRUE(on_caller[task]) << task;
+    EXPECT_FALSE(in_region[task]) << task;
+    EXPECT_EQ(6u, budget[task]) << task;
+  }
+  for (size_t task : {2, 3, 4}) {
+    EXPECT_FALSE(in_region[task]) << task;
+    EXPECT_GE(6u / most.load(), budget[task]) << task;
+  }
+  // the pool can't overlap them on a single core, nor a single thread.
+  if (dag_branches_overlap()) {
+    EXPECT_EQ(3u, most.load());
+  }
+}
+
+TEST(dag_scheduler, serial_order) {
+  dag_scheduler scheduler({{2}, {}, {1}, {}});
+  std::vector<size_t> order;
+  size_t saved = max_concurrency();
+  set_max_concurrency(1);
+  scheduler.run([&](size_t task) { order.push_back(task); });
+  set_max_concurrency(saved);
+  EXPECT_EQ(std::vector<size_t>({1, 2, 0, 3}), order);
+}
+
+TEST(dag_scheduler, rethrows) {
+  dag_scheduler scheduler({{}, {}, {}, {0, 1, 2}});
+  size_t saved = max_concurrency();
+  set_max_concurrency(3);
+  EXPECT_THROW(scheduler.run([](size_t task) {
+    if (task == 1) throw std::runtime_error("task");
+  }),
+               std::runtime_error);
+  set_max_concurrency(saved);
+}
+
+TEST(dag_scheduler, rejects_cycles) {
+  EXPECT_THROW(dag_scheduler({{1}, {0}}), nn_error);
+  EXPECT_THROW(dag_scheduler(std::vector<std::vector<size_t>>(1, {3})),
+               nn_error);
+}
+
+}  // namespace tiny_dnn
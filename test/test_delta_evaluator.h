@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vector>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(EvoDeltaEvaluatorTest, matches_full_evaluation) {
+    Random * random = new Random(42);
+
+    network<sequential> nn;
+    nn << fully_connected_layer(6, 4) << sigmoid_layer()
+       << fully_connected_layer(4, 3) << tanh_layer();
+
+    BatchEvaluator<mse> evaluator(nn);
+    ASSERT_TRUE(evaluator.supportsDelta());
+
+    std::vector<vec_t> data(5, vec_t(6));
+    std::vector<vec_t> labels(5, vec_t(3));
+    for (size_t i = 0; i < data.size(); i++) {
+        for (auto & x : data[i]) x = random->getDouble(-1, 1);
+        for (auto & t : labels[i]) t = random->getDouble(-1, 1);
+    }
+
+    // Parent 0 has three mutated children, parent 1 only one.
+    Population population(5, evaluator.getWeightCount());
+    for (size_t i = 0; i < population.size(); i++) {
+        Individual::randomize(population.getMutableGenome(i), random);
+    }
+
+    DeltaEvaluator<mse> delta(evaluator, population.size());
+    RandomStream stream(1);
+    const size_t parents[] = {0, 0, 0, 1};
+    for (size_t i = 0; i < 4; i++) {
+        Individual::mutate(population.getGenome(parents[i]),
+                           population.getOffspring(i), 0.5f, 0.3f, stream,
+                           delta.recordMutation(i, parents[i]));
+    }
+    Individual::crossover(population.getGenome(2), population.getGenome(3),
+                          population.getOffspring(4), stream);
+    delta.recordOther(4);
+    population.swap();
+
+    EvalScheduler scheduler(2);
+    delta.prepare(population, data, scheduler);
+
+    BatchEvaluator<mse>::Workspace workspace;
+    for (size_t i = 0; i < population.size(); i++) {
+        float_t error = 0;
+        bool incremental = delta.evaluate(i, population, data, labels,
+                                          workspace, &error);
+        EXPECT_EQ(i < 3, incremental);
+
+        if (incremental) {
+            float_t expected = evaluator.evaluate(population.getGenome(i),
+                                                  data, labels, workspace);
+            EXPECT_NEAR(expected, error, 1e-5);
+        }
+    }
+
+    delete random;
+}
+
+TEST(EvoDeltaEvaluatorTest, mutate_records_touched_genes) {
+    std::vector<float_t> parent(1000, 0);
+    std::vector<float_t> child(1000);
+    std::vector<uint32_t> touched;
+
+    RandomStream stream(3);
+    Individual::mutate(GenomeView(parent.data(), parent.size()),
+                       MutableGenomeView(child.data(), child.size()),
+                       0.1f, 0.05f, stream, &touched);
+
+    ASSERT_FALSE(touched.empty());
+    for (size_t k = 1; k < touched.size(); k++) {
+        EXPECT_LT(touched[k - 1], touched[k]);
+    }
+
+    size_t changed = 0;
+    for (size_t i = 0; i < child.size(); i++) {
+        if (child[i] != parent[i]) {
+            changed++;
+            EXPECT_TRUE(std::find(touched.begin(), touched.end(), i)
+                        != touched.end());
+        }
+    }
+    EXPECT_LE(changed, touched.size());
+}
+
+TEST(EvoDeltaEvaluatorTest, unsupported_first_layer) {
+    network<sequential> nn;
+    nn << sigmoid_layer(4) << fully_connected_layer(4, 2);
+
+    BatchEvaluator<mse> evaluator(nn);
+    EXPECT_TRUE(evaluator.isSupported());
+    EXPECT_FALSE(evaluator.supportsDelta());
+}
+
+}
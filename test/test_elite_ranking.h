@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(EvoEliteRankingTest, top_in_order) {
+    std::vector<float> fitness = {3, 9, 1, 7, 7, 2, 8};
+    std::vector<float_t> errors = {4, 1, 6, 2, 2, 5, 3};
+
+    EliteRanking elites;
+    std::vector<size_t> ranking;
+    elites.rank(fitness, errors, 4, &ranking);
+
+    ASSERT_EQ(fitness.size(), ranking.size());
+    EXPECT_EQ(size_t(1), ranking[0]);
+    EXPECT_EQ(size_t(6), ranking[1]);
+    EXPECT_EQ(size_t(3), ranking[2]); // Ties go to the lower index.
+    EXPECT_EQ(size_t(4), ranking[3]);
+
+    std::vector<size_t> sorted(ranking);
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < sorted.size(); i++) {
+        EXPECT_EQ(i, sorted[i]);
+    }
+
+    const EliteRanking::Stats & stats = elites.getStats();
+    EXPECT_FLOAT_EQ(9.0f, stats.bestFitness);
+    EXPECT_NEAR(37.0 / 7, stats.averageFitness, 1e-6);
+    EXPECT_FLOAT_EQ(1.0f, stats.lowestError);
+    EXPECT_NEAR(23.0 / 7, stats.averageError, 1e-6);
+}
+
+TEST(EvoEliteRankingTest, parallel_matches_sequential) {
+    RandomStream stream(7);
+    std::vector<float> fitness(10007);
+    for (float & f : fitness) {
+        // Few distinct values, plenty of ties.
+        f = float(size_t(stream.getDouble() * 500));
+    }
+    std::vector<float_t> errors(fitness.size(), 1);
+
+    const size_t top = 4000;
+    EliteRanking sequential;
+    std::vector<size_t> expected;
+    sequential.rank(fitness, errors, top, &expected);
+
+    EvalScheduler scheduler(4);
+    EliteRanking parallel(1000);
+    std::vector<size_t> ranking;
+    parallel.rank(fitness, errors, top, &ranking, &scheduler);
+
+    ASSERT_EQ(expected.size(), ranking.size());
+    for (size_t i = 0; i < top; i++) {
+        EXPECT_EQ(expected[i], ranking[i]);
+    }
+
+    std::vector<size_t> sorted(ranking);
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < sorted.size(); i++) {
+        EXPECT_EQ(i, sorted[i]);
+    }
+
+    EXPECT_EQ(sequential.getStats().bestFitness,
+              parallel.getStats().bestFitness);
+    EXPECT_NEAR(sequential.getStats().averageFitness,
+                parallel.getStats().averageFitness, 1e-6);
+}
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(EvoEvalSchedulerTest, visits_every_item_once) {
+    EvalScheduler scheduler(4);
+    EXPECT_EQ(size_t(4), scheduler.getThreadCount());
+
+    // Reuse the same workers for several jobs of different shapes.
+    for (size_t count : {1, 3, 100, 1001}) {
+        std::vector<std::atomic<int>> visits(count);
+        for (auto & v : visits) v = 0;
+
+        scheduler.run(count, 0, [&](size_t begin, size_t end, size_t id) {
+            EXPECT_LT(id, size_t(4));
+            for (size_t i = begin; i < end; i++) {
+                visits[i]++;
+            }
+        });
+
+        for (auto & v : visits) {
+            EXPECT_EQ(1, v.load());
+        }
+    }
+}
+
+TEST(EvoEvalSchedulerTest, rethrows_worker_exception) {
+    EvalScheduler scheduler(2);
+
+    EXPECT_THROW(scheduler.run(100, 1, [](size_t begin, size_t, size_t) {
+        if (begin == 42) {
+            throw std::runtime_error("failed");
+        }
+    }), std::runtime_error);
+
+    // Still usable afterwards.
+    std::atomic<size_t> total(0);
+    scheduler.run(10, 1, [&](size_t begin, size_t end, size_t) {
+        total += end - begin;
+    });
+    EXPECT_EQ(size_t(10), total.load());
+}
+
+}
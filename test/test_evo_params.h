@@ -0,0 +1,102 @@
+#pragma once
+
+#include <sstream>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(EvoParamsTest, defaults) {
+    EvoParams params;
+
+    EXPECT_EQ(size_t(Params::population_size), params.population_size);
+    EXPECT_EQ(size_t(Params::sample_count), params.sample_count);
+    EXPECT_FLOAT_EQ(float(Params::mutation_rate), params.mutation_rate);
+    EXPECT_EQ(size_t(0), params.threads);
+}
+
+TEST(EvoParamsTest, parse) {
+    std::istringstream config(
+        "population_size      = 10\n"
+        "\n"
+        "mutation_rate = 0.5    ## Comment.\n"
+        "# A comment line.\n"
+        "threads=3\n");
+
+    EvoParams params;
+    params.parse(config);
+
+    EXPECT_EQ(size_t(10), params.population_size);
+    EXPECT_FLOAT_EQ(0.5f, params.mutation_rate);
+    EXPECT_EQ(size_t(3), params.threads);
+    EXPECT_EQ(size_t(Params::max_generations), params.max_generations);
+}
+
+TEST(EvoParamsTest, round_trip) {
+    EvoParams params;
+    params.set("sex_proportion=0.25");
+    params.set("max_generations", "7");
+
+    std::stringstream ss;
+    params.print(ss);
+
+    EvoParams parsed;
+    parsed.parse(ss);
+
+    EXPECT_FLOAT_EQ(0.25f, parsed.sex_proportion);
+    EXPECT_EQ(size_t(7), parsed.max_generations);
+}
+
+TEST(EvoParamsTest, rejects_bad_input) {
+    EvoParams params;
+
+    EXPECT_THROW(params.set("no_such_key", "1"), nn_error);
+    EXPECT_THROW(params.set("population_size", "ten"), nn_error);
+    EXPECT_THROW(params.set("population_size", "-1"), nn_error);
+    EXPECT_THROW(params.set("mutation_rate", "0.1x"), nn_error);
+    EXPECT_THROW(params.set("mutation_rate"), nn_error);
+
+    std::istringstream config("population_size 10\n");
+    EXPECT_THROW(params.parse(config), nn_error);
+
+    params.selection_proportion = 0;
+    EXPECT_THROW(params.validate(), nn_error);
+}
+
+TEST(EvoParamsTest, evolver_uses_params) {
+    Random * random = new Random(42);
+
+    auto nn = std::make_shared<network<sequential>>();
+    make_test_network(nn);
+
+    std::vector<vec_t> train_labels;
+    std::vector<vec_t> train_data;
+    put_random_data(&train_labels, 1, random);
+    put_random_data(&train_data, 5, random);
+
+    EvoParams params;
+    params.population_size = 12;
+    params.max_generations = 2;
+    params.initial_weights_delta = 0.1f;
+    params.threads = 2;
+
+    Evolver<se> evo(nn,
+                    std::make_shared<std::vector<vec_t>>(train_labels),
+                    std::make_shared<std::vector<vec_t>>(train_data),
+                    random, params);
+
+    EXPECT_EQ(size_t(2), evo.getThreadCount());
+
+    population_t population = evo.getPopulation();
+    EXPECT_EQ(size_t(12), population->size());
+    for (auto individual : *population) {
+        auto genome = individual->getGenome();
+        for (float_t weight : *genome) {
+            EXPECT_TRUE(weight <= 0.1f && weight >= -0.1f);
+        }
+    }
+
+    delete random;
+}
+
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(EvoStrategyTest, noise_table_is_standard_normal) {
+    NoiseTable table(1 << 18, 11);
+    NoiseTable same(1 << 18, 11);
+    ASSERT_EQ(size_t(1 << 18), table.size());
+
+    GenomeView all = table.get(0, table.size());
+    GenomeView again = same.get(0, same.size());
+    double sum = 0;
+    double squares = 0;
+    for (size_t k = 0; k < all.size(); k++) {
+        ASSERT_EQ(all[k], again[k]);
+        sum += all[k];
+        squares += all[k] * all[k];
+    }
+    const double mean = sum / all.size();
+    EXPECT_NEAR(0.0, mean, 0.01);
+    EXPECT_NEAR(1.0, squares / all.size() - mean * mean, 0.02);
+
+    RandomStream stream(3);
+    for (int i = 0; i < 100; i++) {
+        size_t offset = table.sampleOffset(stream, 1000);
+        EXPECT_LE(offset + 1000, table.size());
+    }
+    EXPECT_THROW(table.sampleOffset(stream, table.size() + 1), nn_error);
+}
+
+EvoParams strategy_params() {
+    EvoParams params = make_test_params(40, 150);
+    params.sample_count = 10; // Every batch is the whole data set.
+    params.es_sigma = 0.05f;
+    params.es_learning_rate = 0.03f;
+    params.noise_table_size = 1 << 16;
+    return params;
+}
+
+TEST(EvoStrategyTest, lowers_error) {
+    EvoTestData data_set;
+
+    for (const char * name : {"adam", "sgd"}) {
+        EvoParams params = strategy_params();
+        params.es_optimizer = name;
+
+        Random random(1);
+        auto nn = make_test_network();
+        EvolutionStrategy<se> strategy(nn, data_set.labels, data_set.data,
+                                       &random, params);
+
+        const float_t before = strategy.evaluate(*data_set.data,
+                                                 *data_set.labels);
+        strategy.evolve();
+        const float_t after = strategy.evaluate(*data_set.data,
+                                                *data_set.labels);
+
+        EXPECT_TRUE(strategy.isFinished());
+        EXPECT_LT(after, before * 0.5) << name;
+
+        // The network handed back carries theta.
+        const float_t loss = strategy.getNetwork()->get_loss<se>(
+            *data_set.data, *data_set.labels);
+        EXPECT_NEAR(after, loss, 1e-4) << name;
+    }
+}
+
+TEST(EvoStrategyTest, thread_count_independent) {
+    EvoTestData data_set;
+
+    vec_t expected;
+    for (size_t threads : {1, 3}) {
+        EvoParams params = strategy_params();
+        params.threads = threads;
+        params.max_generations = 10;
+
+        Random random(9);
+        auto nn = make_test_network();
+        EvolutionStrategy<se> strategy(nn, data_set.labels, data_set.data,
+                                       &random, params);
+        strategy.evolve();
+
+        GenomeView theta = strategy.getParameters();
+        if (expected.empty()) {
+            expected.assign(theta.begin(), theta.end());
+        }
+        else {
+            EXPECT_EQ(expected, vec_t(theta.begin(), theta.end()));
+        }
+    }
+}
+
+TEST(EvoStrategyTest, records_metrics) {
+    EvoTestData data_set;
+
+    EvoParams params = strategy_params();
+    params.max_generations = 6;
+    params.tracking_stride = 2;
+
+    Random random(1);
+    auto nn = make_test_network();
+    EvolutionStrategy<se> strategy(nn, data_set.labels, data_set.data, &random,
+                                   params);
+    auto ring = std::make_shared<RingBufferMetricsSink>(10);
+    strategy.setMetricsSink(ring);
+    strategy.evolve();
+
+    std::vector<GenerationMetrics> records = ring->getRecords();
+    ASSERT_EQ(size_t(3), records.size());
+    for (size_t k = 0; k < records.size(); k++) {
+        EXPECT_EQ(uint64_t(2 * k), records[k].generation);
+        EXPECT_LE(records[k].p10Fitness, records[k].medianFitness);
+        EXPECT_LE(records[k].medianFitness, records[k].p90Fitness);
+        EXPECT_LE(records[k].p90Fitness, records[k].bestFitness);
+        EXPECT_LE(records[k].lowestError, records[k].meanError);
+    }
+}
+
+}  // namespace tiny_dnn
@@ -25,6 +25,35 @@ void make_test_network(std::shared_ptr<network<sequential>> nn) {
     << fully_connected_layer(2, 1, true, backend_type);
 }
 
+std::shared_ptr<network<sequential>> make_test_network() {
+    auto nn = std::make_shared<network<sequential>>();
+    make_test_network(nn);
+    return nn;
+}
+
+// Labels and data for make_test_network(), drawn from Random(42).
+struct EvoTestData {
+    std::shared_ptr<std::vector<vec_t>> labels;
+    std::shared_ptr<std::vector<vec_t>> data;
+
+    EvoTestData()
+        : labels(std::make_shared<std::vector<vec_t>>()),
+          data(std::make_shared<std::vector<vec_t>>()) {
+        Random random(42);
+        put_random_data(labels.get(), 1, &random);
+        put_random_data(data.get(), 5, &random);
+    }
+};
+
+// A small run on two threads, to be adjusted by each test.
+EvoParams make_test_params(size_t population_size, size_t max_generations) {
+    EvoParams params;
+    params.population_size = population_size;
+    params.max_generations = max_generations;
+    params.threads = 2;
+    return params;
+}
+
 TEST(EvoEvolverTest, initialize_population) {
     Random * random = new Random(42);
 
@@ -191,4 +220,181 @@ TEST(EvoEvolverTest, mini_batch_handler) {
     delete random;
 }
 
+#ifndef CNN_NO_SERIALIZATION
+// Replicas are built from the first network's JSON model.
+TEST(EvoEvolverTest, lazy_replicas) {
+    Random * random = new Random(42);
+
+    // power_layer isn't batch evaluated, so threads need real networks.
+    auto nn = std::make_shared<network<sequential>>();
+    *nn << fully_connected_layer(5, 2) << power_layer(shape3d(2, 1, 1), 1.0)
+        << fully_connected_layer(2, 1);
+
+    std::vector<vec_t> train_labels;
+    std::vector<vec_t> train_data;
+
+    put_random_data(&train_labels, 1, random);
+    put_random_data(&train_data, 5, random);
+
+    Evolver<se> evo(nn,
+                    std::make_shared<std::vector<vec_t>>(train_labels),
+                    std::make_shared<std::vector<vec_t>>(train_data),
+                    random, 3);
+
+    EXPECT_EQ(size_t(3), evo.getThreadCount());
+
+    auto population = evo.getPopulation();
+    EXPECT_EQ(size_t(Params::population_size), population->size());
+    for (auto individual : *population) {
+        EXPECT_TRUE(std::isfinite(individual->getFitness()));
+        EXPECT_GE(individual->getFitness(), float(Params::min_fitness));
+    }
+
+    // Threads past the first get their own replica, built on demand.
+    auto genome = *((*population)[0]->getGenome());
+    for (size_t id = 0; id < 3; id++) {
+        evo.loadWeights((*population)[0], id);
+        auto network_weights = *(evo.getCurrentNetworkWeights(id));
+
+        ASSERT_EQ(genome.size(), network_weights.size());
+        for (size_t i = 0; i < genome.size(); i++) {
+            EXPECT_EQ(genome[i], network_weights[i]);
+        }
+    }
+
+    delete random;
+}
+#endif  // CNN_NO_SERIALIZATION
+
+TEST(EvoEvolverTest, reproduction_independent_of_threads) {
+    std::vector<population_t> populations;
+
+    for (size_t threads : {1, 3}) {
+        Random * random = new Random(42);
+
+        auto nn = std::make_shared<network<sequential>>();
+        make_test_network(nn);
+
+        std::vector<vec_t> train_labels;
+        std::vector<vec_t> train_data;
+
+        put_random_data(&train_labels, 1, random);
+        put_random_data(&train_data, 5, random);
+
+        Evolver<se> evo(nn,
+                        std::make_shared<std::vector<vec_t>>(train_labels),
+                        std::make_shared<std::vector<vec_t>>(train_data),
+                        random, threads);
+
+        evo.sortPopulation();
+        evo.reproducePopulation();
+        populations.push_back(evo.getPopulation());
+
+        delete random;
+    }
+
+    ASSERT_EQ(populations[0]->size(), populations[1]->size());
+    for (size_t i = 0; i < populations[0]->size(); i++) {
+        EXPECT_EQ(*((*populations[0])[i]->getGenome()),
+                  *((*populations[1])[i]->getGenome()));
+        EXPECT_EQ((*populations[0])[i]->getFitness(),
+                  (*populations[1])[i]->getFitness());
+    }
+}
+
+TEST(EvoEvolverTest, default_params_score_like_full_evaluation) {
+    // The shipped defaults score mutated children from their parents and
+    // the other individuals in blocks; every individual must still get the
+    // fitness a full evaluation gives it.
+    ASSERT_TRUE(EvoParams().delta_evaluation);
+
+    std::vector<std::vector<float>> fitness;
+    for (bool delta : {true, false}) {
+        Random * random = new Random(42);
+
+        auto nn = std::make_shared<network<sequential>>();
+        make_test_network(nn);
+
+        std::vector<vec_t> train_labels;
+        std::vector<vec_t> train_data;
+
+        put_random_data(&train_labels, 1, random);
+        put_random_data(&train_data, 5, random);
+
+        EvoParams params;
+        params.delta_evaluation = delta;
+        Evolver<se> evo(nn,
+                        std::make_shared<std::vector<vec_t>>(train_labels),
+                        std::make_shared<std::vector<vec_t>>(train_data),
+                        random, params);
+
+        evo.evaluatePopulation();
+        evo.reproducePopulation();
+        evo.evaluatePopulation();
+        evo.sortPopulation();
+
+        population_t population = evo.getPopulation();
+        std::vector<float> scores;
+        for (auto individual : *population) {
+            scores.push_back(individual->getFitness());
+        }
+        std::sort(scores.begin(), scores.end());
+        fitness.push_back(scores);
+
+        delete random;
+    }
+
+    ASSERT_EQ(fitness[0].size(), fitness[1].size());
+    for (size_t i = 0; i < fitness[0].size(); i++) {
+        EXPECT_NEAR(fitness[1][i], fitness[0][i], 1e-4);
+    }
+}
+
+TEST(EvoEvolverTest, ranking_puts_fittest_first) {
+    Random * random = new Random(42);
+
+    auto nn = std::make_shared<network<sequential>>();
+    make_test_network(nn);
+
+    std::vector<vec_t> train_labels;
+    std::vector<vec_t> train_data;
+
+    put_random_data(&train_labels, 1, random);
+    put_random_data(&train_data, 5, random);
+
+    Evolver<se> evo(nn,
+                    std::make_shared<std::vector<vec_t>>(train_labels),
+                    std::make_shared<std::vector<vec_t>>(train_data),
+                    random);
+
+    evo.sortPopulation();
+    population_t population = evo.getPopulation();
+
+    const size_t top = size_t(Params::population_size
+                              * Params::selection_proportion);
+    float best = 0;
+    for (auto individual : *population) {
+        best = std::max(best, individual->getFitness());
+    }
+
+    EXPECT_EQ(best, (*population)[0]->getFitness());
+    for (size_t i = 1; i < top; i++) {
+        EXPECT_GE((*population)[i - 1]->getFitness(),
+                  (*population)[i]->getFitness());
+    }
+    for (size_t i = top; i < population->size(); i++) {
+        EXPECT_GE((*population)[top - 1]->getFitness(),
+                  (*population)[i]->getFitness());
+    }
+    EXPECT_NEAR(evo.getAverageFitness(), [&] {
+        double sum = 0;
+        for (auto individual : *population) {
+            sum += individual->getFitness();
+        }
+        return sum / population->size();
+    }(), 1e-4);
+
+    delete random;
+}
+
 }
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(EvoFitnessCacheTest, hash_follows_mutation) {
+    Random random(3);
+    Individual parent(300, &random);
+    Individual child(parent);
+
+    RandomStream stream(5);
+    std::vector<uint32_t> touched;
+    Individual::mutate(parent.getGenomeView(), child.getMutableGenomeView(),
+                       0.1f, 0.05f, stream, &touched);
+    ASSERT_FALSE(touched.empty());
+
+    const uint64_t parent_hash = GenomeHash::of(parent.getGenomeView());
+    const uint64_t child_hash = GenomeHash::of(child.getGenomeView());
+    EXPECT_NE(parent_hash, child_hash);
+    EXPECT_EQ(child_hash,
+              GenomeHash::update(parent_hash, parent.getGenomeView(),
+                                 child.getGenomeView(), touched));
+}
+
+TEST(EvoFitnessCacheTest, find_and_replace) {
+    FitnessCache cache(8);
+    float_t error = 0;
+    EXPECT_FALSE(cache.find(1, 2, &error));
+
+    cache.insert(1, 2, float_t(0.5));
+    EXPECT_TRUE(cache.find(1, 2, &error));
+    EXPECT_EQ(float_t(0.5), error);
+    EXPECT_FALSE(cache.find(1, 3, &error));
+
+    cache.insert(1, 2, float_t(0.25));
+    EXPECT_TRUE(cache.find(1, 2, &error));
+    EXPECT_EQ(float_t(0.25), error);
+
+    cache.clear();
+    EXPECT_FALSE(cache.find(1, 2, &error));
+}
+
+TEST(EvoFitnessCacheTest, evolver_skips_clones) {
+    EvoTestData data_set;
+
+    EvoParams params = make_test_params(40, 6);
+    params.mutation_rate = 0.01f; // Most children are unmutated clones.
+    params.sex_proportion = 0.3f;
+    params.delta_evaluation = false;
+
+    std::vector<float> expected;
+    for (bool cache : {false, true}) {
+        params.fitness_cache = cache;
+        Random random(1);
+        auto nn = make_test_network();
+        Evolver<se> evolver(nn, data_set.labels, data_set.data, &random,
+                            params);
+        evolver.evolve();
+
+        population_t population = evolver.getPopulation();
+        std::vector<float> fitness;
+        for (auto & individual : *population) {
+            fitness.push_back(individual->getFitness());
+        }
+
+        if (!cache) {
+            expected = fitness;
+            EXPECT_EQ(size_t(0), evolver.getSkippedEvaluations());
+        }
+        else {
+            EXPECT_EQ(expected, fitness);
+            EXPECT_LT(size_t(params.population_size),
+                      evolver.getSkippedEvaluations());
+        }
+    }
+}
+
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(EvoGenomeCodecTest, half_and_bfloat) {
+    EXPECT_EQ(0x3c00, GenomeCodec::toHalf(1.0f));
+    EXPECT_EQ(0xc000, GenomeCodec::toHalf(-2.0f));
+    EXPECT_EQ(0x7bff, GenomeCodec::toHalf(65504.0f));
+    EXPECT_EQ(0x7c00, GenomeCodec::toHalf(1e6f));
+    EXPECT_EQ(0x0001, GenomeCodec::toHalf(std::ldexp(1.0f, -24)));
+    EXPECT_EQ(0x0000, GenomeCodec::toHalf(std::ldexp(1.0f, -26)));
+    EXPECT_EQ(std::ldexp(1.0f, -24), GenomeCodec::fromHalf(0x0001));
+    EXPECT_EQ(0.0999755859375f,
+              GenomeCodec::fromHalf(GenomeCodec::toHalf(0.1f)));
+
+    EXPECT_EQ(0x3f80, GenomeCodec::toBfloat(1.0f));
+    EXPECT_EQ(1.0f, GenomeCodec::fromBfloat(GenomeCodec::toBfloat(1.001f)));
+    // Ties go to even.
+    EXPECT_EQ(0x3f80, GenomeCodec::toBfloat(1.00390625f));
+    EXPECT_EQ(0x3f82, GenomeCodec::toBfloat(1.01171875f));
+}
+
+TEST(EvoGenomeCodecTest, encode_rounds_in_place) {
+    Random random(4);
+    const std::vector<size_t> segments = {40, 8};
+
+    for (const char * name : {"float", "fp16", "bf16", "int8"}) {
+        GenomeCodec codec(GenomeCodec::parse(name), segments);
+        std::vector<float_t> genome(48);
+        for (size_t k = 0; k < genome.size(); k++) {
+            // The second segment is much narrower than the first.
+            genome[k] = random.getDouble(-1, 1) * (k < 40 ? 1 : 0.01);
+        }
+        const std::vector<float_t> original = genome;
+
+        std::vector<uint8_t> row(genome.size() * codec.getBytesPerGene());
+        std::vector<float> ranges(codec.getRangeCount());
+        codec.encode(MutableGenomeView(genome.data(), genome.size()),
+                     row.data(), ranges.data());
+
+        std::vector<float_t> decoded(genome.size());
+        codec.decode(row.data(), ranges.data(),
+                     MutableGenomeView(decoded.data(), decoded.size()));
+        EXPECT_EQ(genome, decoded) << name;
+
+        for (size_t k = 0; k < genome.size(); k++) {
+            // Within one step of each format, relative to its segment.
+            const double scale = k < 40 ? 1 : 0.01;
+            EXPECT_NEAR(original[k], genome[k], scale / 100) << name;
+        }
+    }
+}
+
+TEST(EvoGenomeCodecTest, int8_keeps_parent_grid) {
+    Random random(6);
+    GenomeCodec codec(GenomePrecision::int8, std::vector<size_t>({64}));
+    std::vector<float_t> genome(64);
+    for (auto & gene : genome) {
+        gene = random.getDouble(-1, 1);
+    }
+    std::vector<uint8_t> row(genome.size());
+    std::vector<float> ranges(codec.getRangeCount());
+    codec.encode(MutableGenomeView(genome.data(), genome.size()),
+                 row.data(), ranges.data());
+    const std::vector<float_t> first = genome;
+
+    // Mutate one gene at a time, moving the segment's extremes inward; the
+    // genes left alone must never drift.
+    for (size_t step = 0; step < 200; step++) {
+        const size_t k = step % 63;
+        genome[k] = genome[k] * float_t(0.9);
+        std::vector<float> child_ranges(ranges.size());
+        std::vector<uint8_t> child_row(row.size());
+        codec.encode(MutableGenomeView(genome.data(), genome.size()),
+                     child_row.data(), child_ranges.data(), ranges.data());
+        EXPECT_EQ(ranges, child_ranges);
+        EXPECT_EQ(first[63], genome[63]);
+        ranges = child_ranges;
+        row = child_row;
+    }
+
+    // A gene outside the range grows it.
+    genome[0] = float_t(ranges[1] + 1);
+    std::vector<float> grown(ranges.size());
+    codec.encode(MutableGenomeView(genome.data(), genome.size()),
+                 row.data(), grown.data(), ranges.data());
+    EXPECT_EQ(ranges[0], grown[0]);
+    EXPECT_NEAR(ranges[1] + 1, grown[1], 1e-6);
+}
+
+TEST(EvoGenomeCodecTest, int8_refits_after_outlier) {
+    Random random(9);
+    GenomeCodec codec(GenomePrecision::int8, std::vector<size_t>({32}));
+    std::vector<float_t> genome(32);
+    for (auto & gene : genome) {
+        gene = random.getDouble(-1, 1);
+    }
+    std::vector<uint8_t> row(genome.size());
+    std::vector<float> ranges(codec.getRangeCount());
+    codec.encode(MutableGenomeView(genome.data(), genome.size()),
+                 row.data(), ranges.data());
+    const std::vector<float> original = ranges;
+
+    // An outlying mutation widens the grid for its offspring...
+    genome[0] = 20;
+    std::vector<float> wide(ranges.size());
+    codec.encode(MutableGenomeView(genome.data(), genome.size()),
+                 row.data(), wide.data(), ranges.data());
+    EXPECT_NEAR(20, wide[1], 1e-6);
+
+    // ...and once it is bred out, the grid shrinks back to the genes.
+    genome[0] = 0;
+    std::vector<float> narrow(ranges.size());
+    codec.encode(MutableGenomeView(genome.data(), genome.size()),
+                 row.data(), narrow.data(), wide.data());
+    EXPECT_LE(narrow[1] - narrow[0], original[1] - original[0] + 1e-6);
+    EXPECT_GT(wide[1] - wide[0], 5 * (narrow[1] - narrow[0]));
+}
+
+TEST(EvoGenomeCodecTest, packed_population) {
+    GenomeCodec codec(GenomePrecision::fp16, std::vector<size_t>());
+    Population packed(4, 1024, codec);
+    Population full(4, 1024);
+    EXPECT_TRUE(packed.isCompressed());
+    EXPECT_EQ(full.getArenaBytes(),
+              packed.getArenaBytes() * sizeof(float_t) / 2);
+
+    vec_t genome(1024, float_t(0.5));
+    packed.writeOffspring(2, MutableGenomeView(genome.data(), genome.size()));
+    packed.swap();
+
+    vec_t scratch;
+    GenomeView read = packed.readGenome(2, scratch);
+    ASSERT_EQ(size_t(1024), read.size());
+    EXPECT_EQ(float_t(0.5), read[0]);
+    EXPECT_EQ(float_t(0.5), read[1023]);
+    EXPECT_EQ(float_t(0), packed.readPreviousGenome(2, scratch)[0]);
+}
+
+TEST(EvoGenomeCodecTest, evolver_runs_packed) {
+    EvoTestData data_set;
+
+    for (const char * precision : {"fp16", "bf16", "int8"}) {
+        EvoParams params = make_test_params(30, 5);
+        params.fitness_cache = true;
+        params.genome_precision = precision;
+
+        Random random(1);
+        auto nn = make_test_network();
+        Evolver<se> evolver(nn, data_set.labels, data_set.data, &random,
+                            params);
+        EXPECT_FALSE(evolver.getParams().delta_evaluation);
+        evolver.evolve();
+
+        population_t population = evolver.getPopulation();
+        ASSERT_EQ(size_t(30), population->size());
+        for (auto & individual : *population) {
+            EXPECT_TRUE(std::isfinite(individual->getFitness()));
+        }
+
+        // The best genome is stored exactly as it was evaluated.
+        std::vector<Migrant> best = evolver.getElites(1);
+        std::vector<float_t> again = best[0].genome;
+        GenomeCodec codec(GenomeCodec::parse(precision),
+                          std::vector<size_t>({10, 2, 2, 1}));
+        std::vector<uint8_t> row(again.size() * codec.getBytesPerGene());
+        std::vector<float> ranges(codec.getRangeCount());
+        codec.encode(MutableGenomeView(again.data(), again.size()),
+                     row.data(), ranges.data());
+        if (codec.getPrecision() != GenomePrecision::int8) {
+            EXPECT_EQ(best[0].genome, again) << precision;
+        }
+        else {
+            // int8 genomes sit on their parents' grid, which may be wider
+            // than their own extremes: a fresh grid is only within a step.
+            for (size_t k = 0; k < again.size(); k++) {
+                EXPECT_NEAR(best[0].genome[k], again[k], 0.01) << k;
+            }
+        }
+    }
+}
+
+}
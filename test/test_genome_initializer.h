@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+/// 100 inputs, 50 outputs: 5000 weights then 50 biases.
+std::vector<float_t> initial_genome(const std::string & scheme) {
+    network<sequential> nn;
+    nn << fully_connected_layer(100, 50);
+
+    GenomeInitializer initializer(scheme, 0.5f, nn);
+    std::vector<float_t> genome(NetworkReplicas::countWeights(nn));
+    RandomStream stream(42);
+    initializer.fill(MutableGenomeView(genome.data(), genome.size()),
+                     stream);
+    return genome;
+}
+
+TEST(EvoGenomeInitializerTest, uniform) {
+    std::vector<float_t> genome = initial_genome("uniform");
+    ASSERT_EQ(size_t(5050), genome.size());
+    for (float_t gene : genome) {
+        EXPECT_TRUE(float_t(-0.5) <= gene && gene < float_t(0.5));
+    }
+}
+
+TEST(EvoGenomeInitializerTest, per_layer_bounds) {
+    // xavier: sqrt(6 / (fan_in + fan_out)), lecun: 1 / sqrt(fan_in).
+    const float_t xavier = std::sqrt(float_t(6) / 150);
+    const float_t lecun = float_t(1) / std::sqrt(float_t(100));
+
+    std::vector<float_t> genome = initial_genome("xavier");
+    float_t largest = 0;
+    for (size_t k = 0; k < 5000; k++) {
+        EXPECT_LE(std::abs(genome[k]), xavier);
+        largest = std::max(largest, std::abs(genome[k]));
+    }
+    EXPECT_GT(largest, float_t(0.9) * xavier);
+
+    genome = initial_genome("lecun");
+    for (size_t k = 0; k < 5000; k++) {
+        EXPECT_LE(std::abs(genome[k]), lecun);
+    }
+    for (size_t k = 5000; k < genome.size(); k++) {
+        EXPECT_EQ(float_t(0), genome[k]);
+    }
+}
+
+TEST(EvoGenomeInitializerTest, he) {
+    std::vector<float_t> genome = initial_genome("he");
+
+    double squares = 0;
+    for (size_t k = 0; k < 5000; k++) {
+        squares += genome[k] * genome[k];
+    }
+    EXPECT_NEAR(std::sqrt(2.0 / 100), std::sqrt(squares / 5000), 0.01);
+    for (size_t k = 5000; k < genome.size(); k++) {
+        EXPECT_EQ(float_t(0), genome[k]);
+    }
+}
+
+TEST(EvoGenomeInitializerTest, unknown_scheme) {
+    network<sequential> nn;
+    nn << fully_connected_layer(4, 2);
+    EXPECT_THROW(GenomeInitializer("orthogonal", 1, nn), nn_error);
+
+    EvoParams params;
+    params.weight_init = "orthogonal";
+    EXPECT_THROW(params.validate(), nn_error);
+}
+
+TEST(EvoGenomeInitializerTest, evolver_population) {
+    EvoTestData data_set;
+
+    for (const char * precision : {"float", "fp16"}) {
+        EvoParams params;
+        params.population_size = 10;
+        params.sample_count = 10;
+        params.threads = 2;
+        params.weight_init = "xavier";
+        params.genome_precision = precision;
+
+        Random random(1);
+        auto nn = make_test_network();
+        Evolver<se> evolver(nn, data_set.labels, data_set.data, &random,
+                            params);
+
+        // fc(5, 2): 10 weights within sqrt(6 / 7), then 2 zero biases.
+        population_t population = evolver.getPopulation();
+        for (auto & individual : *population) {
+            GenomeView genome = individual->getGenomeView();
+            for (size_t k = 0; k < 10; k++) {
+                EXPECT_LE(std::abs(genome[k]), float_t(0.93)) << precision;
+            }
+            EXPECT_EQ(float_t(0), genome[10]) << precision;
+            EXPECT_EQ(float_t(0), genome[11]) << precision;
+        }
+    }
+}
+
+}  // namespace tiny_dnn
@@ -35,11 +35,50 @@ TEST(EvoIndividualTest, sexual_reproduction) {
 
     for (size_t i = 0; i < ind1.getSize(); i++) {
         EXPECT_TRUE((fabs((*ind1_genome)[i] - (*child_genome)[i]) < 1e-5)
-                    || (fabs((*ind1_genome)[i] - (*child_genome)[i]) < 1e-5));
+                    || (fabs((*ind2_genome)[i] - (*child_genome)[i]) < 1e-5));
     }
 
     delete random;
 }
 
+TEST(EvoIndividualTest, genome_view) {
+    Random * random = new Random(42);
+
+    Individual ind(100, random);
+    GenomeView view = ind.getGenomeView();
+    auto genome = ind.getGenome();
+
+    EXPECT_EQ(ind.getSize(), view.size());
+    for (size_t i = 0; i < ind.getSize(); i++) {
+        EXPECT_EQ((*genome)[i], view[i]);
+    }
+
+    // Views alias the individual's storage, they don't copy it.
+    ind.getMutableGenomeView()[0] += 1.0f;
+    EXPECT_EQ((*genome)[0] + 1.0f, view[0]);
+
+    delete random;
+}
+
+TEST(EvoIndividualTest, asexual_reproduction_mutates_child) {
+    Random * random = new Random(42);
+
+    Individual ind(100, random);
+    auto child = ind.createOffspring(1.0f, 1.0f); // Always mutate.
+
+    GenomeView parent_genome = ind.getGenomeView();
+    GenomeView child_genome = child->getGenomeView();
+
+    size_t changed = 0;
+    for (size_t i = 0; i < ind.getSize(); i++) {
+        if (parent_genome[i] != child_genome[i]) {
+            changed++;
+        }
+    }
+
+    EXPECT_GT(changed, size_t(0));
+
+    delete random;
+}
 
 }
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+Migrant make_migrant(size_t length, float_t value, float fitness) {
+    Migrant migrant;
+    migrant.genome.assign(length, value);
+    migrant.fitness = fitness;
+    migrant.source = 0;
+    return migrant;
+}
+
+// Mailbox semantics every transport has to follow.
+void check_transport(MigrationTransport & transport) {
+    ASSERT_EQ(size_t(3), transport.getIslandCount());
+    EXPECT_TRUE(transport.receive(1).empty());
+
+    transport.send(0, 1, {make_migrant(4, 1, 10)});
+    // Latest message wins.
+    transport.send(0, 1, {make_migrant(4, 2, 20), make_migrant(4, 3, 30)});
+    transport.send(2, 1, {make_migrant(4, 4, 40)});
+
+    std::vector<Migrant> arrived = transport.receive(1);
+    ASSERT_EQ(size_t(3), arrived.size());
+    EXPECT_EQ(float_t(2), arrived[0].genome[0]);
+    EXPECT_EQ(20.0f, arrived[0].fitness);
+    EXPECT_EQ(size_t(0), arrived[0].source);
+    EXPECT_EQ(float_t(4), arrived[2].genome[3]);
+    EXPECT_EQ(size_t(2), arrived[2].source);
+
+    EXPECT_TRUE(transport.receive(1).empty());
+    EXPECT_TRUE(transport.receive(0).empty());
+
+    transport.report(2, make_migrant(4, 5, 50));
+    EXPECT_TRUE(transport.receive(2).empty());
+    ASSERT_EQ(size_t(1), transport.getResult(2).size());
+    EXPECT_EQ(50.0f, transport.getResult(2)[0].fitness);
+    EXPECT_TRUE(transport.getResult(0).empty());
+}
+
+TEST(EvoIslandTest, local_transport) {
+    LocalTransport transport(3);
+    check_transport(transport);
+}
+
+#ifndef _WIN32
+TEST(EvoIslandTest, shared_memory_transport) {
+    SharedMemoryTransport transport(3, 4, 2);
+    check_transport(transport);
+
+    // Messages cross process boundaries.
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        transport.send(1, 0, {make_migrant(4, 7, 70)});
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    std::vector<Migrant> arrived = transport.receive(0);
+    ASSERT_EQ(size_t(1), arrived.size());
+    EXPECT_EQ(float_t(7), arrived[0].genome[0]);
+    EXPECT_EQ(size_t(1), arrived[0].source);
+
+    EXPECT_THROW(transport.send(0, 1, {make_migrant(3, 0, 0)}), nn_error);
+}
+#endif
+
+TEST(EvoIslandTest, topology) {
+    typedef IslandModel<se> model_t;
+    EXPECT_EQ(std::vector<size_t>({2}), model_t::neighbours("ring", 3, 1));
+    EXPECT_EQ(std::vector<size_t>({0}), model_t::neighbours("ring", 3, 2));
+    EXPECT_EQ(std::vector<size_t>({0, 2}), model_t::neighbours("full", 3, 1));
+    EXPECT_TRUE(model_t::neighbours("full", 1, 0).empty());
+    EXPECT_THROW(model_t::neighbours("star", 3, 0), nn_error);
+}
+
+TEST(EvoIslandTest, immigrants_replace_least_fit) {
+    Random * random = new Random(42);
+
+    auto nn = std::make_shared<network<sequential>>();
+    make_test_network(nn);
+
+    std::vector<vec_t> train_labels;
+    std::vector<vec_t> train_data;
+    put_random_data(&train_labels, 1, random);
+    put_random_data(&train_data, 5, random);
+
+    EvoParams params;
+    params.population_size = 20;
+    params.threads = 1;
+
+    Evolver<se> evo(nn,
+                    std::make_shared<std::vector<vec_t>>(train_labels),
+                    std::make_shared<std::vector<vec_t>>(train_data),
+                    random, params);
+
+    std::vector<Migrant> elites = evo.getElites(3);
+    ASSERT_EQ(size_t(3), elites.size());
+    EXPECT_GE(elites[0].fitness, elites[1].fitness);
+    EXPECT_GE(elites[1].fitness, elites[2].fitness);
+
+    std::vector<Migrant> migrants(2,
+        make_migrant(evo.getWeightCount(), 0.5, elites[0].fitness + 1));
+    evo.immigrate(migrants);
+
+    std::vector<Migrant> best = evo.getElites(2);
+    for (const Migrant & migrant : best) {
+        EXPECT_EQ(elites[0].fitness + 1, migrant.fitness);
+        EXPECT_EQ(std::vector<float_t>(evo.getWeightCount(), 0.5),
+                  migrant.genome);
+    }
+    // The previous best are still there.
+    EXPECT_EQ(elites[0].fitness, evo.getElites(3)[2].fitness);
+
+    delete random;
+}
+
+IslandModel<se>::factory_t make_island_factory(
+        const EvoTestData & data_set, const EvoParams & params) {
+    return [=](size_t, Random * random) {
+        return std::unique_ptr<Evolver<se>>(new Evolver<se>(
+            make_test_network(), data_set.labels, data_set.data, random,
+            params));
+    };
+}
+
+TEST(EvoIslandTest, islands_on_threads) {
+    EvoTestData data_set;
+
+    EvoParams params = make_test_params(20, 6);
+    params.threads = 1;
+    params.islands = 3;
+    params.migration_interval = 2;
+    params.migrants = 2;
+    params.topology = "full";
+
+    IslandModel<se> model(params, 42,
+                          make_island_factory(data_set, params));
+    std::vector<Migrant> champions = model.runThreads();
+
+    ASSERT_EQ(size_t(3), champions.size());
+    for (size_t i = 0; i < champions.size(); i++) {
+        EXPECT_EQ(i, champions[i].source);
+        EXPECT_EQ(size_t(15), champions[i].genome.size());
+        EXPECT_GT(champions[i].fitness, 0.0f);
+    }
+}
+
+#ifndef _WIN32
+TEST(EvoIslandTest, islands_in_processes) {
+    EvoTestData data_set;
+
+    EvoParams params = make_test_params(20, 4);
+    params.threads = 1;
+    params.islands = 2;
+    params.migration_interval = 1;
+    params.migrants = 3;
+
+    IslandModel<se> model(params, 42,
+                          make_island_factory(data_set, params));
+    // make_test_network has 5x2 + 2 + 2x1 + 1 weights.
+    std::vector<Migrant> champions = model.runProcesses(15);
+
+    ASSERT_EQ(size_t(2), champions.size());
+    for (size_t i = 0; i < champions.size(); i++) {
+        EXPECT_EQ(i, champions[i].source);
+        EXPECT_EQ(size_t(15), champions[i].genome.size());
+    }
+}
+#endif
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+static GenerationMetrics make_metrics(uint64_t generation) {
+    GenerationMetrics metrics = GenerationMetrics();
+    metrics.generation = generation;
+    metrics.bestFitness = 4.5f;
+    metrics.meanFitness = 2.0;
+    metrics.p10Fitness = 1.0f;
+    metrics.medianFitness = 2.0f;
+    metrics.p90Fitness = 4.0f;
+    metrics.lowestError = 0.5f;
+    metrics.meanError = 3.0;
+    metrics.mutationPower = 0.25f;
+    metrics.mutationRate = 0.5f;
+    return metrics;
+}
+
+TEST(EvoMetricsTest, csv_rows) {
+    std::ostringstream os;
+    CsvMetricsSink sink(os);
+    sink.record(make_metrics(7));
+
+    std::istringstream lines(os.str());
+    std::string header, row;
+    std::getline(lines, header);
+    std::getline(lines, row);
+    EXPECT_EQ(0u, header.find("generation,best_fitness,mean_fitness"));
+    EXPECT_EQ("7,4.5,2,1,2,4,0.5,3,0.25,0.5,0,0,0,0,0", row);
+}
+
+TEST(EvoMetricsTest, json_lines) {
+    std::ostringstream os;
+    JsonLinesMetricsSink sink(os);
+    sink.record(make_metrics(3));
+    sink.record(make_metrics(4));
+
+    std::istringstream lines(os.str());
+    std::string first, second;
+    std::getline(lines, first);
+    std::getline(lines, second);
+    EXPECT_EQ(0u, first.find("{\"generation\":3,\"best_fitness\":4.5,"));
+    EXPECT_EQ('}', first.back());
+    EXPECT_EQ(0u, second.find("{\"generation\":4,"));
+}
+
+TEST(EvoMetricsTest, ring_buffer_keeps_latest) {
+    RingBufferMetricsSink sink(3);
+    for (uint64_t g = 0; g < 5; g++) {
+        sink.record(make_metrics(g));
+    }
+
+    std::vector<GenerationMetrics> records = sink.getRecords();
+    ASSERT_EQ(size_t(3), records.size());
+    EXPECT_EQ(uint64_t(2), records[0].generation);
+    EXPECT_EQ(uint64_t(4), records[2].generation);
+    EXPECT_EQ(size_t(5), sink.getCount());
+
+    std::ostringstream os;
+    sink.dump(os);
+    EXPECT_EQ(3 * sizeof(GenerationMetrics), os.str().size());
+}
+
+TEST(EvoMetricsTest, async_forwards_in_order) {
+    auto ring = std::make_shared<RingBufferMetricsSink>(100);
+    {
+        AsyncMetricsSink sink(ring);
+        for (uint64_t g = 0; g < 50; g++) {
+            sink.record(make_metrics(g));
+        }
+        sink.flush();
+        EXPECT_EQ(size_t(50), ring->getCount());
+
+        sink.record(make_metrics(50));
+    }
+    // Destruction drains what's left.
+    std::vector<GenerationMetrics> records = ring->getRecords();
+    ASSERT_EQ(size_t(51), records.size());
+    for (uint64_t g = 0; g < records.size(); g++) {
+        EXPECT_EQ(g, records[g].generation);
+    }
+}
+
+TEST(EvoMetricsTest, evolver_honours_stride) {
+    EvoTestData data_set;
+
+    EvoParams params = make_test_params(20, 7);
+    params.tracking_stride = 3;
+
+    Random random(1);
+    auto nn = make_test_network();
+    Evolver<se> evolver(nn, data_set.labels, data_set.data, &random, params);
+
+    auto ring = std::make_shared<RingBufferMetricsSink>(10);
+    evolver.setMetricsSink(ring);
+    evolver.evolve();
+
+    std::vector<GenerationMetrics> records = ring->getRecords();
+    ASSERT_EQ(size_t(3), records.size());
+    EXPECT_EQ(uint64_t(0), records[0].generation);
+    EXPECT_EQ(uint64_t(3), records[1].generation);
+    EXPECT_EQ(uint64_t(6), records[2].generation);
+
+    for (const GenerationMetrics & metrics : records) {
+        EXPECT_LE(metrics.p10Fitness, metrics.medianFitness);
+        EXPECT_LE(metrics.medianFitness, metrics.p90Fitness);
+        EXPECT_LE(metrics.p90Fitness, metrics.bestFitness);
+        EXPECT_LE(metrics.meanFitness, metrics.bestFitness);
+        EXPECT_GE(metrics.evalSeconds, 0.0);
+        EXPECT_GT(metrics.mutationPower, 0.0f);
+    }
+    EXPECT_LT(records[2].mutationPower, records[0].mutationPower);
+}
+
+}
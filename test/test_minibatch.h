@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+/**
+ * size samples, sample i holding i, labelled one-hot over classes with
+ * class i % classes.
+ */
+static void make_class_data(size_t size, size_t classes,
+                            std::shared_ptr<std::vector<vec_t>> labels,
+                            std::shared_ptr<std::vector<vec_t>> data) {
+    for (size_t i = 0; i < size; i++) {
+        vec_t label(classes, float_t(0));
+        label[i % classes] = float_t(1);
+        labels->push_back(label);
+        data->push_back(vec_t(1, float_t(i)));
+    }
+}
+
+TEST(EvoMiniBatchTest, sequential_wraps_around) {
+    auto labels = std::make_shared<std::vector<vec_t>>();
+    auto data = std::make_shared<std::vector<vec_t>>();
+    make_class_data(5, 2, labels, data);
+
+    MiniBatchHandler handler(labels, data, 3);
+    EXPECT_EQ(std::vector<uint32_t>({0, 1, 2}), handler.next());
+    EXPECT_EQ(std::vector<uint32_t>({3, 4, 0}), handler.next());
+    EXPECT_EQ(size_t(1), handler.getEpoch());
+    EXPECT_EQ(size_t(1), handler.getIndex());
+
+    // Views read the training set in place.
+    EXPECT_EQ(&(*data)[4], &handler.getData()[1]);
+    EXPECT_EQ(&(*labels)[0], &handler.getLabels()[2]);
+}
+
+TEST(EvoMiniBatchTest, shuffle_permutes_every_epoch) {
+    const size_t size = 50;
+    auto labels = std::make_shared<std::vector<vec_t>>();
+    auto data = std::make_shared<std::vector<vec_t>>();
+    make_class_data(size, 5, labels, data);
+
+    MiniBatchHandler handler(labels, data, size, "shuffle");
+    handler.setSeed(3);
+    std::vector<uint32_t> first = handler.next();
+    std::vector<uint32_t> second = handler.next();
+
+    EXPECT_NE(first, second);
+    std::vector<uint32_t> sorted = first;
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < size; i++) {
+        EXPECT_EQ(i, sorted[i]);
+    }
+}
+
+TEST(EvoMiniBatchTest, stratified_balances_classes) {
+    const size_t classes = 4;
+    auto labels = std::make_shared<std::vector<vec_t>>();
+    auto data = std::make_shared<std::vector<vec_t>>();
+    make_class_data(400, classes, labels, data);
+
+    MiniBatchHandler handler(labels, data, 8, "stratified");
+    handler.setSeed(11);
+    for (size_t batch = 0; batch < 100; batch++) {
+        std::vector<size_t> counts(classes, 0);
+        for (uint32_t i : handler.next()) {
+            counts[i % classes]++;
+        }
+        for (size_t count : counts) {
+            EXPECT_EQ(size_t(2), count);
+        }
+    }
+}
+
+TEST(EvoMiniBatchTest, prefetch_and_copies_agree) {
+    auto labels = std::make_shared<std::vector<vec_t>>();
+    auto data = std::make_shared<std::vector<vec_t>>();
+    make_class_data(37, 3, labels, data);
+
+    MiniBatchHandler eager(labels, data, 5, "stratified", false);
+    MiniBatchHandler prefetched(labels, data, 5, "stratified", true);
+    eager.setSeed(7);
+    prefetched.setSeed(7);
+
+    for (size_t batch = 0; batch < 20; batch++) {
+        EXPECT_EQ(eager.next(), prefetched.next());
+    }
+
+    MiniBatchHandler copy(prefetched);
+    MiniBatchHandler resumed(labels, data, 5, "stratified", true);
+    resumed.setSeed(7);
+    resumed.setPosition(prefetched.getIndex(), prefetched.getEpoch());
+    for (size_t batch = 0; batch < 20; batch++) {
+        std::vector<uint32_t> expected = prefetched.next();
+        EXPECT_EQ(expected, copy.next());
+        EXPECT_EQ(expected, resumed.next());
+    }
+
+    // Batches longer than an epoch span two or three orders each.
+    MiniBatchHandler long_eager(labels, data, 80, "shuffle", false);
+    MiniBatchHandler long_prefetched(labels, data, 80, "shuffle", true);
+    for (size_t batch = 0; batch < 5; batch++) {
+        EXPECT_EQ(long_eager.next(), long_prefetched.next());
+    }
+}
+
+TEST(EvoMiniBatchTest, rejects_unknown_order) {
+    auto labels = std::make_shared<std::vector<vec_t>>();
+    auto data = std::make_shared<std::vector<vec_t>>();
+    EXPECT_THROW(MiniBatchHandler(labels, data, 2, "random"), nn_error);
+
+    EvoParams params;
+    params.batch_order = "random";
+    EXPECT_THROW(params.validate(), nn_error);
+}
+
+}
@@ -0,0 +1,56 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#ifndef _CRT_SECURE_NO_WARNINGS
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+// The evo path must work in builds without serialization support, so this
+// file is its own test binary, compiled with CNN_NO_SERIALIZATION.
+#ifndef CNN_NO_SERIALIZATION
+#define CNN_NO_SERIALIZATION
+#endif
+
+#include "gtest/gtest.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+using namespace tiny_dnn::activation;
+
+#include "test_evolver.h"
+
+namespace tiny_dnn {
+
+TEST(EvoNoSerializationTest, evolves_on_several_threads) {
+    Random random(42);
+    auto labels = std::make_shared<std::vector<vec_t>>();
+    auto data = std::make_shared<std::vector<vec_t>>();
+    put_random_data(labels.get(), 1, &random);
+    put_random_data(data.get(), 5, &random);
+
+    auto nn = std::make_shared<network<sequential>>();
+    make_test_network(nn);
+
+    EvoParams params;
+    params.population_size = 10;
+    params.max_generations = 2;
+    params.threads = 2;
+
+    Evolver<mse> evo(nn, labels, data, &random, params);
+    evo.evolve();
+    EXPECT_EQ(size_t(2), evo.getCurrentGeneration());
+}
+
+TEST(EvoNoSerializationTest, replicas_need_a_network_per_thread) {
+    auto nn = std::make_shared<network<sequential>>();
+    make_test_network(nn);
+
+    NetworkReplicas replicas({nn}, 2);
+    EXPECT_EQ(nn, replicas.get(0));
+    EXPECT_THROW(replicas.get(1), nn_error);
+}
+
+}  // namespace tiny_dnn
@@ -84,4 +84,73 @@ TEST(nodes, graph_branch2) {
   EXPECT_FLOAT_EQ(static_cast<float_t>(res[2]), static_cast<float_t>(0.0));
 }
 
+namespace {
+
+// an input feeding three branches, joined by a concat_layer.
+struct branch_net {
+  branch_net()
+    : in(shape3d(8, 1, 1)),
+      fc1(8, 5),
+      fc2(8, 5),
+      fc3(8, 5),
+      act1(5),
+      act2(5),
+      cat({shape3d(5, 1, 1), shape3d(5, 1, 1), shape3d(5, 1, 1)}),
+      out(15, 3) {
+    in << fc1 << act1;
+    in << fc2 << act2;
+    in << fc3;
+    (act1, act2, fc3) << cat;
+    cat << out;
+    construct_graph(net, {&in}, {&out});
+  }
+
+  input_layer in;
+  fully_connected_layer fc1, fc2, fc3;
+  relu_layer act1;
+  tanh_layer act2;
+  concat_layer cat;
+  fully_connected_layer out;
+  network<graph> net;
+};
+
+}  // namespace
+
+TEST(nodes, graph_branches_concurrently) {
+  std::vector<vec_t> in(16, vec_t(8)), t(16, vec_t(3));
+  for (size_t i = 0; i < in.size(); i++) {
+    uniform_rand(in[i].begin(), in[i].end(), -1, 1);
+    uniform_rand(t[i].begin(), t[i].end(), -1, 1);
+  }
+
+  // the same training, with the branches run one by one and concurrently.
+  size_t saved = max_concurrency();
+  branch_net serial, concurrent;
+  for (auto *b : {&serial, &concurrent}) {
+    set_max_concurrency(b == &serial ? 1 : 4);
+    set_random_seed(7);
+    b->net.init_weight();
+    gradient_descent opt;
+    b->net.fit<mse>(opt, in, t, 4, 2);
+  }
+  set_max_concurrency(saved);
+
+  for (size_t l = 0; l < serial.net.depth(); l++) {
+    auto w1 = serial.net[l]->weights();
+    auto w2 = concurrent.net[l]->weights();
+    ASSERT_EQ(w1.size(), w2.size());
+    for (size_t k = 0; k < w1.size(); k++) {
+      for (size_t j = 0; j < w1[k]->size(); j++) {
+        EXPECT_FLOAT_EQ((*w1[k])[j], (*w2[k])[j]);
+      }
+    }
+  }
+
+  for (auto &sample : in) {
+    vec_t y1 = serial.net.predict(sample);
+    vec_t y2 = concurrent.net.predict(sample);
+    for (size_t j = 0; j < y1.size(); j++) EXPECT_FLOAT_EQ(y1[j], y2[j]);
+  }
+}
+
 }  // namespace tiny_dnn
@@ -0,0 +1,105 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+/// blocks for_ hands out over [0, count).
+std::vector<std::pair<size_t, size_t>> parallel_blocks(size_t count,
+                                                       size_t grainsize) {
+  std::mutex mutex;
+  std::vector<std::pair<size_t, size_t>> blocks;
+  for_(true, 0, count,
+       [&](const blocked_range &r) {
+         std::lock_guard<std::mutex> lock(mutex);
+         blocks.emplace_back(r.begin(), r.end());
+       },
+       grainsize);
+  std::sort(blocks.begin(), blocks.end());
+  return blocks;
+}
+
+TEST(parallel_for, covers_range) {
+  for (size_t grainsize : {1, 7, 100, 5000}) {
+    std::vector<std::pair<size_t, size_t>> blocks =
+      parallel_blocks(1000, grainsize);
+    size_t next = 0;
+    for (auto &block : blocks) {
+      EXPECT_EQ(next, block.first);
+      next = block.second;
+    }
+    EXPECT_EQ(1000u, next);
+  }
+}
+
+TEST(parallel_for, scheduler_grain) {
+  // TBB and GCD keep the grain of 100 the old default gave every caller.
+  EXPECT_EQ(100u, detail::scheduler_grain(400, 1));
+  EXPECT_EQ(100u, detail::scheduler_grain(100000, 1));
+  EXPECT_EQ(1u, detail::scheduler_grain(100, 1));
+  EXPECT_EQ(300u, detail::scheduler_grain(1000, 300));
+  EXPECT_EQ(1u, detail::scheduler_grain(1000, 5000));
+}
+
+#if !defined(CNN_USE_TBB) && !defined(CNN_USE_OMP) && \
+  !defined(CNN_USE_GCD) && !defined(CNN_SINGLE_THREAD)
+
+TEST(parallel_for, honors_grainsize_and_budget) {
+  set_max_concurrency(8);
+  std::vector<std::pair<size_t, size_t>> blocks = parallel_blocks(1000, 300);
+  EXPECT_LE(blocks.size(), 3u);
+  for (size_t k = 0; k + 1 < blocks.size(); k++) {
+    EXPECT_GE(blocks[k].second - blocks[k].first, 300u);
+  }
+
+  set_max_concurrency(2);
+  EXPECT_EQ(2u, max_concurrency());
+  EXPECT_LE(parallel_blocks(1000, 1).size(), 2u);
+  set_max_concurrency(0);
+  EXPECT_EQ(std::max<size_t>(std::thread::hardware_concurrency(), 1),
+            max_concurrency());
+}
+
+TEST(parallel_for, nested_runs_inline) {
+  EXPECT_FALSE(parallel_region::active());
+  {
+    parallel_region region;
+    EXPECT_TRUE(parallel_region::active());
+
+    std::vector<std::pair<size_t, size_t>> blocks = parallel_blocks(1000, 1);
+    ASSERT_EQ(1u, blocks.size());
+    EXPECT_EQ(0u, blocks[0].first);
+    EXPECT_EQ(1000u, blocks[0].second);
+  }
+  EXPECT_FALSE(parallel_region::active());
+
+  // every inner loop runs on the thread of its outer iteration.
+  std::atomic<size_t> total(0);
+  std::atomic<size_t> foreign(0);
+  for_i(true, 16, [&](size_t) {
+    std::thread::id outer = std::this_thread::get_id();
+    for_i(true, 100, [&](size_t) {
+      total++;
+      if (std::this_thread::get_id() != outer) foreign++;
+    });
+  });
+  EXPECT_EQ(1600u, total.load());
+  EXPECT_EQ(0u, foreign.load());
+}
+
+#endif
+
+}  // namespace tiny_dnn
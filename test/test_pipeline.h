@@ -0,0 +1,89 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+namespace {
+
+void make_pipeline_net(network<sequential> &net) {
+  net << convolutional_layer(6, 6, 3, 1, 4) << relu_layer()
+      << fully_connected_layer(64, 32) << tanh_layer()
+      << fully_connected_layer(32, 16) << relu_layer()
+      << fully_connected_layer(16, 4) << softmax_layer();
+  net.init_weight();
+}
+
+std::vector<vec_t> pipeline_samples(size_t count, size_t size) {
+  std::vector<vec_t> samples(count, vec_t(size));
+  for (auto &sample : samples) {
+    uniform_rand(sample.begin(), sample.end(), -1, 1);
+  }
+  return samples;
+}
+
+}  // namespace
+
+TEST(pipeline, same_outputs_as_predict) {
+  network<sequential> net;
+  make_pipeline_net(net);
+  auto in = pipeline_samples(37, 36);
+
+  for (size_t stages : {1, 2, 3, 8}) {
+    for (size_t micro_batch : {1, 3, 64}) {
+      pipeline_executor pipeline(net, stages, micro_batch);
+      std::vector<vec_t> out = pipeline.predict(in);
+
+      // the network's own edges are back, so predict runs as before.
+      ASSERT_EQ(in.size(), out.size());
+      for (size_t i = 0; i < in.size(); i++) {
+        vec_t expected = net.predict(in[i]);
+        ASSERT_EQ(expected.size(), out[i].size());
+        for (size_t j = 0; j < expected.size(); j++) {
+          EXPECT_NEAR(expected[j], out[i][j], 1e-5);
+        }
+      }
+    }
+  }
+}
+
+TEST(pipeline, reused_across_calls) {
+  network<sequential> net;
+  make_pipeline_net(net);
+  pipeline_executor pipeline(net, 3, 2, 1);
+
+  for (size_t count : {0, 1, 5, 20}) {
+    auto in  = pipeline_samples(count, 36);
+    auto out = pipeline.predict(in);
+    ASSERT_EQ(count, out.size());
+    for (size_t i = 0; i < count; i++) {
+      EXPECT_NEAR(net.predict(in[i])[2], out[i][2], 1e-5);
+    }
+  }
+}
+
+TEST(pipeline, stages_balance_cost) {
+  network<sequential> net;
+  net << fully_connected_layer(256, 256) << relu_layer()
+      << fully_connected_layer(256, 8) << relu_layer()
+      << fully_connected_layer(8, 8) << relu_layer();
+
+  pipeline_executor pipeline(net, 2);
+  ASSERT_EQ(2u, pipeline.stages());
+  // the first layer alone outweighs all the others.
+  EXPECT_EQ(std::vector<size_t>({0, 1, 6}), pipeline.bounds());
+
+  pipeline_executor capped(net, 100);
+  EXPECT_EQ(6u, capped.stages());
+}
+
+}  // namespace tiny_dnn
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(EvoPopulationTest, rows_are_aligned) {
+    Population population(7, 13);
+
+    EXPECT_EQ(size_t(7), population.size());
+    EXPECT_EQ(size_t(13), population.getGenomeLength());
+    EXPECT_EQ(size_t(0), population.getStride() * sizeof(float_t)
+                         % Population::alignment);
+
+    for (size_t i = 0; i < population.size(); i++) {
+        auto address = reinterpret_cast<std::uintptr_t>(
+            population.getGenome(i).data());
+        EXPECT_EQ(size_t(0), address % Population::alignment);
+        EXPECT_EQ(size_t(13), population.getGenome(i).size());
+    }
+}
+
+TEST(EvoPopulationTest, swap_recycles_arenas) {
+    Population population(3, 5);
+
+    for (size_t i = 0; i < population.size(); i++) {
+        population.setFitness(i, 1.0f);
+        for (float_t & gene : population.getMutableGenome(i)) {
+            gene = float_t(1);
+        }
+
+        population.setOffspringFitness(i, 2.0f);
+        for (float_t & gene : population.getOffspring(i)) {
+            gene = float_t(2);
+        }
+    }
+
+    const float_t * parents = population.getGenome(0).data();
+    const float_t * offspring = population.getOffspring(0).data();
+
+    population.swap();
+
+    // No reallocation, the two arenas just trade places.
+    EXPECT_EQ(offspring, population.getGenome(0).data());
+    EXPECT_EQ(parents, population.getOffspring(0).data());
+
+    for (size_t i = 0; i < population.size(); i++) {
+        EXPECT_EQ(2.0f, population.getFitness(i));
+        for (float_t gene : population.getGenome(i)) {
+            EXPECT_EQ(float_t(2), gene);
+        }
+    }
+}
+
+}
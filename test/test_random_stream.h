@@ -0,0 +1,145 @@
+#pragma once
+
+#include <vector>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(EvoRandomStreamTest, keyed_streams_are_reproducible) {
+    RandomStream a(42, 3, 7);
+    RandomStream b(42, 3, 7);
+    RandomStream c(42, 3, 8);
+
+    size_t same_as_c = 0;
+    for (size_t i = 0; i < 100; i++) {
+        uint64_t x = a.next();
+        EXPECT_EQ(x, b.next());
+        if (x == c.next()) {
+            same_as_c++;
+        }
+    }
+    EXPECT_EQ(size_t(0), same_as_c);
+}
+
+TEST(EvoRandomStreamTest, get_double) {
+    RandomStream stream(42);
+
+    double sum = 0;
+    for (size_t i = 0; i < 10000; i++) {
+        double r = stream.getDouble();
+        EXPECT_TRUE(0.0 <= r && r < 1.0);
+        sum += r;
+    }
+    EXPECT_NEAR(0.5, sum / 10000, 0.02);
+}
+
+TEST(EvoRandomStreamTest, geometric_skips) {
+    RandomStream stream(42);
+    const double p = 0.04;
+
+    double sum = 0;
+    for (size_t i = 0; i < 20000; i++) {
+        sum += stream.getGeometric(p);
+    }
+    // Mean number of failures before a success is (1 - p) / p.
+    EXPECT_NEAR((1 - p) / p, sum / 20000, 1.0);
+
+    EXPECT_EQ(size_t(0), stream.getGeometric(1.0));
+    EXPECT_EQ(SIZE_MAX, stream.getGeometric(0.0));
+}
+
+TEST(EvoRandomStreamTest, jump) {
+    RandomStream a(42);
+    RandomStream b(42);
+    b.jump();
+
+    EXPECT_NE(a.next(), b.next());
+}
+
+TEST(EvoRandomStreamTest, fill_uniform) {
+    RandomStream a(42);
+    RandomStream b(42);
+    std::vector<float_t> first(10003);
+    std::vector<float_t> second(10003);
+    a.fillUniform(MutableGenomeView(first.data(), first.size()), -2, 3);
+    b.fillUniform(MutableGenomeView(second.data(), second.size()), -2, 3);
+    EXPECT_EQ(first, second);
+
+    double sum = 0;
+    for (float_t value : first) {
+        EXPECT_TRUE(float_t(-2) <= value && value < float_t(3));
+        sum += value;
+    }
+    EXPECT_NEAR(0.5, sum / first.size(), 0.05);
+
+    // A fill takes one draw, whatever its length.
+    RandomStream c(42);
+    c.fillUniform(MutableGenomeView(first.data(), 5), 0, 1);
+    EXPECT_EQ(a.next(), c.next());
+}
+
+TEST(EvoRandomStreamTest, fill_normal) {
+    RandomStream stream(42);
+    std::vector<float_t> values(100001);
+    stream.fillNormal(MutableGenomeView(values.data(), values.size()), 1, 2);
+
+    double sum = 0;
+    double squares = 0;
+    for (float_t value : values) {
+        EXPECT_TRUE(std::isfinite(value));
+        sum += value;
+        squares += value * value;
+    }
+    const double mean = sum / values.size();
+    EXPECT_NEAR(1.0, mean, 0.02);
+    EXPECT_NEAR(4.0, squares / values.size() - mean * mean, 0.05);
+}
+
+TEST(EvoRandomStreamTest, sparse_mutation_rate) {
+    RandomStream stream(42);
+    std::vector<float_t> parent(100000, float_t(0));
+    std::vector<float_t> child(parent.size());
+
+    Individual::mutate(GenomeView(parent.data(), parent.size()),
+                       MutableGenomeView(child.data(), child.size()),
+                       0.5f, 0.04f, stream);
+
+    size_t mutated = 0;
+    for (float_t gene : child) {
+        EXPECT_LE(std::abs(gene), float_t(0.5));
+        if (gene != float_t(0)) {
+            mutated++;
+        }
+    }
+    EXPECT_NEAR(0.04, double(mutated) / child.size(), 0.005);
+
+    // Rate 0 is a plain copy.
+    Individual::mutate(GenomeView(parent.data(), parent.size()),
+                       MutableGenomeView(child.data(), child.size()),
+                       0.5f, 0.0f, stream);
+    EXPECT_EQ(parent, child);
+}
+
+TEST(EvoRandomStreamTest, crossover_mask) {
+    RandomStream stream(42);
+    std::vector<float_t> first(1000, float_t(1));
+    std::vector<float_t> second(1000, float_t(2));
+    std::vector<float_t> child(1000);
+
+    Individual::crossover(GenomeView(first.data(), first.size()),
+                          GenomeView(second.data(), second.size()),
+                          MutableGenomeView(child.data(), child.size()),
+                          stream);
+
+    size_t from_second = 0;
+    for (float_t gene : child) {
+        EXPECT_TRUE(gene == float_t(1) || gene == float_t(2));
+        if (gene == float_t(2)) {
+            from_second++;
+        }
+    }
+    EXPECT_NEAR(500, double(from_second), 60);
+}
+
+}
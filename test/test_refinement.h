@@ -0,0 +1,110 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+/// Loss of a genome on the whole data set, through a fresh network.
+float_t refined_loss(const std::vector<float_t> & genome,
+                     const EvoTestData & data_set) {
+    auto nn = make_test_network();
+    nn->init_weight();
+
+    const float_t * src = genome.data();
+    for (auto layer : *nn) {
+        for (vec_t * weights : layer->weights()) {
+            std::copy(src, src + weights->size(), weights->begin());
+            src += weights->size();
+        }
+    }
+    return nn->get_loss<se>(*data_set.data, *data_set.labels);
+}
+
+EvoParams refinement_params() {
+    EvoParams params = make_test_params(20, 4);
+    params.sample_count = 10; // Every batch is the whole data set.
+    params.refine_elites = 3;
+    params.refine_steps = 20;
+    params.refine_learning_rate = 0.5f;
+    return params;
+}
+
+TEST(EvoRefinementTest, elites_improve) {
+    EvoTestData data_set;
+
+    for (const char * name : {"sgd", "adam"}) {
+        EvoParams params = refinement_params();
+        params.refine_optimizer = name;
+        if (params.refine_optimizer == "adam") {
+            params.refine_learning_rate = 0.05f;
+        }
+
+        Random random(1);
+        auto nn = make_test_network();
+        Evolver<se> evolver(nn, data_set.labels, data_set.data, &random,
+                            params);
+
+        std::vector<Migrant> before = evolver.getElites(20);
+        evolver.refineElites();
+        std::vector<Migrant> after = evolver.getElites(20);
+
+        ASSERT_EQ(before.size(), after.size());
+        for (size_t k = 0; k < before.size(); k++) {
+            // Fitness is only updated by the next evaluation.
+            EXPECT_EQ(before[k].fitness, after[k].fitness);
+            if (k < 3) {
+                EXPECT_LT(refined_loss(after[k].genome, data_set),
+                          refined_loss(before[k].genome, data_set))
+                    << name;
+            }
+            else {
+                EXPECT_EQ(before[k].genome, after[k].genome) << name;
+            }
+        }
+    }
+}
+
+TEST(EvoRefinementTest, thread_count_independent) {
+    EvoTestData data_set;
+
+    std::vector<vec_t> expected;
+    for (size_t threads : {1, 3}) {
+        EvoParams params = refinement_params();
+        params.threads = threads;
+
+        Random random(7);
+        auto nn = make_test_network();
+        Evolver<se> evolver(nn, data_set.labels, data_set.data, &random,
+                            params);
+        evolver.evolve();
+
+        population_t population = evolver.getPopulation();
+        std::vector<vec_t> genomes;
+        for (auto & individual : *population) {
+            GenomeView genome = individual->getGenomeView();
+            genomes.emplace_back(genome.begin(), genome.end());
+        }
+
+        if (expected.empty()) {
+            expected = genomes;
+        }
+        else {
+            EXPECT_EQ(expected, genomes);
+        }
+    }
+}
+
+TEST(EvoRefinementTest, unknown_optimizer) {
+    EvoParams params;
+    params.refine_optimizer = "lbfgs";
+    EXPECT_THROW(params.validate(), nn_error);
+
+    params.refine_optimizer = "adam";
+    params.refine_learning_rate = 0;
+    EXPECT_THROW(params.validate(), nn_error);
+}
+
+}  // namespace tiny_dnn
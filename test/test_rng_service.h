@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+TEST(EvoRngServiceTest, streams_and_splits) {
+    RngService rng(42);
+
+    RandomStream a = rng.stream(3, 7);
+    RandomStream b = RandomStream(42, 3, 7);
+    EXPECT_EQ(a.next(), b.next());
+
+    // Same key, same child. Different keys, unrelated children.
+    EXPECT_EQ(rng.split(1).getSeed(), rng.split(1).getSeed());
+    EXPECT_NE(rng.split(1).getSeed(), rng.split(2).getSeed());
+    EXPECT_NE(rng.getSeed(), rng.split(0).getSeed());
+    EXPECT_NE(rng.split(1).stream(3, 7).next(), rng.stream(3, 7).next());
+}
+
+TEST(EvoRngServiceTest, from_random) {
+    Random first(5);
+    Random second(5);
+    EXPECT_EQ(RngService::fromRandom(&first).getSeed(),
+              RngService::fromRandom(&second).getSeed());
+}
+
+TEST(EvoRngServiceTest, initial_population_thread_count_independent) {
+    EvoTestData data_set;
+
+    std::vector<vec_t> expected;
+    for (size_t threads : {1, 4}) {
+        EvoParams params;
+        params.population_size = 30;
+        params.sample_count = 10;
+        params.threads = threads;
+
+        Random random(3);
+        auto nn = make_test_network();
+        Evolver<se> evolver(nn, data_set.labels, data_set.data, &random,
+                            params);
+
+        population_t population = evolver.getPopulation();
+        std::vector<vec_t> genomes;
+        for (auto & individual : *population) {
+            GenomeView genome = individual->getGenomeView();
+            for (float_t gene : genome) {
+                EXPECT_LE(std::abs(gene), params.initial_weights_delta);
+            }
+            genomes.emplace_back(genome.begin(), genome.end());
+        }
+
+        if (expected.empty()) {
+            expected = genomes;
+        }
+        else {
+            EXPECT_EQ(expected, genomes);
+        }
+    }
+}
+
+}  // namespace tiny_dnn
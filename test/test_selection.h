@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vector>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+// Fraction of draws landing on each candidate.
+std::vector<double> selection_frequencies(const Selector & selector,
+                                          size_t candidates, size_t draws) {
+    RandomStream stream(42);
+    std::vector<double> frequencies(candidates, 0.0);
+    for (size_t i = 0; i < draws; i++) {
+        size_t pick = selector.select(stream);
+        EXPECT_LT(pick, candidates);
+        frequencies[pick] += 1.0 / draws;
+    }
+    return frequencies;
+}
+
+TEST(EvoSelectionTest, alias_table_matches_weights) {
+    std::vector<float> fitness = {1, 2, 3, 4, 0, 10};
+    float total = 20;
+
+    Roulette wheel(nullptr);
+    wheel.reset(fitness);
+
+    std::vector<double> frequencies =
+        selection_frequencies(wheel, fitness.size(), 200000);
+    for (size_t i = 0; i < fitness.size(); i++) {
+        EXPECT_NEAR(fitness[i] / total, frequencies[i], 0.005);
+    }
+}
+
+TEST(EvoSelectionTest, alias_table_degenerate_weights) {
+    AliasTable table;
+    table.build(4, [](size_t) { return 0.0; });
+
+    EXPECT_EQ(size_t(4), table.size());
+    EXPECT_EQ(size_t(0), table.sample(0.0));
+    EXPECT_EQ(size_t(3), table.sample(0.999999));
+
+    table.build(1, [](size_t) { return 5.0; });
+    EXPECT_EQ(size_t(0), table.sample(0.7));
+}
+
+TEST(EvoSelectionTest, tournament_prefers_fittest) {
+    std::vector<float> fitness = {1, 5, 3, 2};
+
+    TournamentSelector single(1);
+    single.reset(fitness);
+    std::vector<double> uniform = selection_frequencies(single, 4, 100000);
+    for (double frequency : uniform) {
+        EXPECT_NEAR(0.25, frequency, 0.01);
+    }
+
+    // Index 1 loses only when it is never drawn: 1 - (3/4)^3.
+    TournamentSelector triple(3);
+    triple.reset(fitness);
+    std::vector<double> frequencies = selection_frequencies(triple, 4, 100000);
+    EXPECT_NEAR(1 - 27.0 / 64, frequencies[1], 0.01);
+    EXPECT_NEAR(1.0 / 64, frequencies[0], 0.005);
+}
+
+TEST(EvoSelectionTest, rank_ignores_fitness_scale) {
+    // Ranks are 2, 0, 1: weights 0.5, 1.5, 1.0 out of 3.
+    std::vector<float> fitness = {1, 1000, 2};
+
+    RankSelector rank(1.5f);
+    rank.reset(fitness);
+    std::vector<double> frequencies = selection_frequencies(rank, 3, 100000);
+    EXPECT_NEAR(0.5 / 3, frequencies[0], 0.01);
+    EXPECT_NEAR(1.5 / 3, frequencies[1], 0.01);
+    EXPECT_NEAR(1.0 / 3, frequencies[2], 0.01);
+}
+
+TEST(EvoSelectionTest, make_selector) {
+    EvoParams params;
+    EXPECT_TRUE(dynamic_cast<Roulette *>(
+        makeSelector(params, nullptr).get()) != nullptr);
+
+    params.set("selection", "tournament");
+    EXPECT_TRUE(dynamic_cast<TournamentSelector *>(
+        makeSelector(params, nullptr).get()) != nullptr);
+
+    params.set("selection", "rank");
+    EXPECT_TRUE(dynamic_cast<RankSelector *>(
+        makeSelector(params, nullptr).get()) != nullptr);
+
+    params.selection = "lottery";
+    EXPECT_THROW(params.validate(), nn_error);
+    EXPECT_THROW(makeSelector(params, nullptr), nn_error);
+}
+
+TEST(EvoSelectionTest, evolver_runs_each_scheme) {
+    Random * random = new Random(42);
+
+    std::vector<vec_t> train_labels;
+    std::vector<vec_t> train_data;
+    put_random_data(&train_labels, 1, random);
+    put_random_data(&train_data, 5, random);
+
+    for (const char * scheme : {"roulette", "tournament", "rank"}) {
+        auto nn = std::make_shared<network<sequential>>();
+        make_test_network(nn);
+
+        EvoParams params;
+        params.population_size = 20;
+        params.max_generations = 2;
+        params.threads = 2;
+        params.set("selection", scheme);
+
+        Evolver<se> evo(nn,
+                        std::make_shared<std::vector<vec_t>>(train_labels),
+                        std::make_shared<std::vector<vec_t>>(train_data),
+                        random, params);
+        evo.evolve();
+
+        EXPECT_EQ(size_t(20), evo.getPopulation()->size());
+    }
+
+    delete random;
+}
+
+}
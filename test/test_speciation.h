@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+namespace tiny_dnn {
+
+/// Genomes scattered by noise around one of a few centres.
+std::vector<vec_t> clustered_genomes(size_t centres, size_t per_centre,
+                                     size_t length, float noise) {
+    Random random(5);
+    std::vector<vec_t> genomes;
+    for (size_t c = 0; c < centres; c++) {
+        vec_t centre(length);
+        for (float_t & gene : centre) {
+            gene = random.getDouble(-1, 1);
+        }
+        for (size_t m = 0; m < per_centre; m++) {
+            vec_t genome(centre);
+            for (float_t & gene : genome) {
+                gene += random.getDouble(-noise, noise);
+            }
+            genomes.push_back(genome);
+        }
+    }
+    return genomes;
+}
+
+TEST(EvoSpeciationTest, sketch_distance) {
+    const size_t length = 4000;
+    std::vector<vec_t> genomes = clustered_genomes(2, 2, length, 0.1f);
+    Speciation species(genomes.size(), length, 0.5f, 0, 8);
+    for (size_t i = 0; i < genomes.size(); i++) {
+        species.sketch(i, GenomeView(genomes[i].data(), length));
+    }
+
+    for (size_t a = 0; a < genomes.size(); a++) {
+        EXPECT_NEAR(0.0f, species.distance(a, a), 1e-3f);
+        for (size_t b = a + 1; b < genomes.size(); b++) {
+            double squared = 0;
+            for (size_t k = 0; k < length; k++) {
+                const double d = genomes[a][k] - genomes[b][k];
+                squared += d * d;
+            }
+            const float exact = static_cast<float>(std::sqrt(squared / length));
+            // A 32 value sketch, accurate to a few tens of percent.
+            EXPECT_NEAR(exact, species.distance(a, b), 0.4f * exact);
+        }
+    }
+}
+
+TEST(EvoSpeciationTest, groups_and_shares) {
+    const size_t length = 2000;
+    std::vector<vec_t> genomes = clustered_genomes(3, 5, length, 0.05f);
+    EvalScheduler scheduler(2);
+
+    Speciation species(genomes.size(), length, 0.3f, 0, 8);
+    std::vector<float> fitness(genomes.size());
+    for (size_t i = 0; i < genomes.size(); i++) {
+        species.sketch(i, GenomeView(genomes[i].data(), length));
+        fitness[i] = float(i + 1);
+    }
+    species.speciate(fitness, scheduler);
+
+    ASSERT_EQ(size_t(3), species.getSpeciesCount());
+    EXPECT_EQ(size_t(5), species.getLargestSpecies());
+    for (size_t i = 0; i < genomes.size(); i++) {
+        EXPECT_EQ(species.getSpecies(i / 5 * 5), species.getSpecies(i));
+        EXPECT_FLOAT_EQ(fitness[i] / 5, species.getSharedFitness()[i]);
+    }
+    EXPECT_EQ(0.3f, species.getThreshold());
+
+    // Species persist through their representatives.
+    species.speciate(fitness, scheduler);
+    EXPECT_EQ(size_t(3), species.getSpeciesCount());
+}
+
+TEST(EvoSpeciationTest, capped_and_steered) {
+    const size_t length = 2000;
+    std::vector<vec_t> genomes = clustered_genomes(6, 2, length, 0.05f);
+    EvalScheduler scheduler(1);
+    std::vector<float> fitness(genomes.size(), 1.0f);
+
+    Speciation capped(genomes.size(), length, 0.3f, 0, 4);
+    Speciation steered(genomes.size(), length, 0.3f, 2, 32);
+    for (size_t i = 0; i < genomes.size(); i++) {
+        capped.sketch(i, GenomeView(genomes[i].data(), length));
+        steered.sketch(i, GenomeView(genomes[i].data(), length));
+    }
+
+    capped.speciate(fitness, scheduler);
+    EXPECT_EQ(size_t(4), capped.getSpeciesCount());
+
+    // Too many species, the threshold widens until there are fewer.
+    steered.speciate(fitness, scheduler);
+    EXPECT_EQ(size_t(6), steered.getSpeciesCount());
+    EXPECT_GT(steered.getThreshold(), 0.3f);
+    for (int g = 0; g < 20; g++) {
+        steered.speciate(fitness, scheduler);
+    }
+    EXPECT_LT(steered.getSpeciesCount(), size_t(6));
+}
+
+TEST(EvoSpeciationTest, evolver_reports_species) {
+    EvoTestData data_set;
+
+    EvoParams params = make_test_params(60, 5);
+    params.tracking_stride = 1;
+    params.speciation = true;
+
+    std::vector<float> expected;
+    for (size_t threads : {1, 3}) {
+        params.threads = threads;
+        Random random(1);
+        auto nn = make_test_network();
+        Evolver<se> evolver(nn, data_set.labels, data_set.data, &random,
+                            params);
+        auto ring = std::make_shared<RingBufferMetricsSink>(10);
+        evolver.setMetricsSink(ring);
+        evolver.evolve();
+
+        for (const GenerationMetrics & metrics : ring->getRecords()) {
+            EXPECT_GE(metrics.speciesCount, 1u);
+            EXPECT_LE(metrics.speciesCount, 32u);
+            EXPECT_GE(metrics.largestSpecies, 1u);
+        }
+
+        population_t population = evolver.getPopulation();
+        std::vector<float> fitness;
+        for (auto & individual : *population) {
+            fitness.push_back(individual->getFitness());
+        }
+        if (expected.empty()) {
+            expected = fitness;
+        }
+        else {
+            EXPECT_EQ(expected, fitness);
+        }
+    }
+}
+
+}  // namespace tiny_dnn
@@ -0,0 +1,75 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+#include "tiny_dnn/util/thread_pool.h"
+
+namespace tiny_dnn {
+
+TEST(thread_pool, runs_every_block_once) {
+  thread_pool pool(4);
+  EXPECT_EQ(4u, pool.size());
+
+  for (size_t blocks : {0, 1, 3, 4, 1000}) {
+    std::vector<std::atomic<int>> hits(blocks);
+    for (auto &hit : hits) hit = 0;
+    pool.run(blocks, [&](size_t b) { hits[b]++; });
+    for (auto &hit : hits) EXPECT_EQ(1, hit.load());
+  }
+}
+
+TEST(thread_pool, nested_and_concurrent_calls) {
+  thread_pool pool(3);
+  std::atomic<size_t> total(0);
+
+  auto nested = [&] {
+    pool.run(8, [&](size_t) {
+      pool.run(8, [&](size_t) { total++; });
+    });
+  };
+
+  std::vector<std::thread> callers;
+  for (int t = 0; t < 4; t++) {
+    callers.emplace_back([&] {
+      for (int k = 0; k < 50; k++) nested();
+    });
+  }
+  for (auto &caller : callers) caller.join();
+
+  EXPECT_EQ(size_t(4 * 50 * 8 * 8), total.load());
+}
+
+TEST(thread_pool, rethrows) {
+  thread_pool pool(4);
+  EXPECT_THROW(pool.run(100,
+                        [](size_t b) {
+                          if (b == 57) throw std::runtime_error("block");
+                        }),
+               std::runtime_error);
+
+  // still usable afterwards
+  std::atomic<size_t> count(0);
+  pool.run(100, [&](size_t) { count++; });
+  EXPECT_EQ(100u, count.load());
+}
+
+TEST(thread_pool, for_i) {
+  std::vector<int> values(10000, 0);
+  for (int k = 0; k < 100; k++) {
+    for_i(values.size(), [&](size_t i) { values[i]++; });
+  }
+  for (int value : values) EXPECT_EQ(100, value);
+}
+
+}  // namespace tiny_dnn
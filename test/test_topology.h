@@ -0,0 +1,137 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "testhelper.h"
+#include "tiny_dnn/tiny_dnn.h"
+
+#if defined(__linux__)
+#include <sys/stat.h>
+#endif
+
+namespace tiny_dnn {
+
+TEST(topology, parse_cpulist) {
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 8, 10, 11}),
+            cpu_topology::parse_cpulist("0-3,8,10-11\n"));
+  EXPECT_TRUE(cpu_topology::parse_cpulist("").empty());
+}
+
+TEST(topology, placement) {
+  cpu_topology topology = cpu_topology::detect();
+  ASSERT_GE(topology.node_count(), 1u);
+  ASSERT_GE(topology.cpu_count(), 1u);
+
+  std::vector<int> cpus = topology.placement(3 * topology.cpu_count());
+  EXPECT_EQ(3 * topology.cpu_count(), cpus.size());
+
+  std::vector<size_t> nodes = topology.worker_nodes(10);
+  EXPECT_EQ(0u, nodes.front());
+  EXPECT_EQ(topology.node_count() - 1, nodes.back());
+  EXPECT_TRUE(std::is_sorted(nodes.begin(), nodes.end()));
+}
+
+#if defined(__linux__)
+
+TEST(topology, from_sysfs) {
+  std::string root = "tiny_dnn_test_sysfs";
+  for (const char *dir : {"", "/cpu", "/node", "/node/node0", "/node/node1"}) {
+    mkdir((root + dir).c_str(), 0755);
+  }
+  std::ofstream(root + "/cpu/online") << "0-5,7\n";
+  std::ofstream(root + "/node/node0/cpulist") << "0-3\n";
+  std::ofstream(root + "/node/node1/cpulist") << "4-7\n";
+
+  cpu_topology topology = cpu_topology::from_sysfs(root);
+  ASSERT_EQ(2u, topology.node_count());
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3}), topology.cpus(0));
+  EXPECT_EQ(std::vector<int>({4, 5, 7}), topology.cpus(1));  // 6 offline
+
+  // four workers, two per node.
+  EXPECT_EQ(std::vector<int>({0, 1, 4, 5}), topology.placement(4));
+
+  // two groups of two sharing the machine take separate cpus.
+  EXPECT_EQ(std::vector<int>({0, 1}), topology.placement(2, 0, 4));
+  EXPECT_EQ(std::vector<int>({4, 5}), topology.placement(2, 2, 4));
+
+  // outside the process affinity mask.
+  cpu_topology allowed = cpu_topology::from_sysfs(root, {1, 2, 5, 6});
+  ASSERT_EQ(2u, allowed.node_count());
+  EXPECT_EQ(std::vector<int>({1, 2}), allowed.cpus(0));
+  EXPECT_EQ(std::vector<int>({5}), allowed.cpus(1));
+
+  for (const char *file :
+       {"/cpu/online", "/node/node0/cpulist", "/node/node1/cpulist"}) {
+    std::remove((root + file).c_str());
+  }
+  for (const char *dir : {"/node/node1", "/node/node0", "/node", "/cpu", ""}) {
+    rmdir((root + dir).c_str());
+  }
+}
+
+TEST(topology, pin_current_thread) {
+  int cpu = cpu_topology::detect().cpus(0)[0];
+  bool pinned = false;
+  std::thread worker([&] { pinned = pin_current_thread(cpu); });
+  worker.join();
+  EXPECT_TRUE(pinned);
+  EXPECT_FALSE(pin_current_thread(-1));
+
+  // the threads stay alive until they have been pinned.
+  std::atomic<bool> release(false);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 2; i++) {
+    threads.emplace_back([&] {
+      while (!release.load()) std::this_thread::yield();
+    });
+  }
+  EXPECT_EQ(1u, pin_workers(threads, {cpu, -1}));
+  release = true;
+  for (auto &thread : threads) thread.join();
+}
+
+TEST(topology, detect_within_affinity) {
+  std::vector<int> allowed = cpu_topology::allowed_cpus();
+  if (allowed.empty()) return;
+  const cpu_topology &topology = cpu_topology::detect();
+  for (size_t n = 0; n < topology.node_count(); n++) {
+    for (int cpu : topology.cpus(n)) {
+      EXPECT_TRUE(std::find(allowed.begin(), allowed.end(), cpu) !=
+                  allowed.end());
+    }
+  }
+}
+
+#endif
+
+TEST(topology, pinned_pools) {
+  thread_pool pool(3, true);
+  std::atomic<size_t> count(0);
+  pool.run(30, [&](size_t) { count++; });
+  EXPECT_EQ(30u, count.load());
+#if defined(__linux__)
+  EXPECT_EQ(0u, pool.unpinned());
+#endif
+
+  EvalScheduler scheduler(2, true, 2, 4);
+  std::atomic<size_t> items(0);
+  scheduler.run(100, 0, [&](size_t begin, size_t end, size_t) {
+    items += end - begin;
+  });
+  EXPECT_EQ(100u, items.load());
+#if defined(__linux__)
+  EXPECT_EQ(0u, scheduler.getUnpinnedCount());
+#endif
+}
+
+}  // namespace tiny_dnn
@@ -35,6 +35,12 @@
  */
 //#define CNN_USE_GCD
 
+/**
+ * define to run parallel_for on tiny-dnn's own persistent thread pool
+ * instead of starting threads for every call
+ */
+// #define CNN_USE_THREAD_POOL
+
 /**
  * define to use exceptions
  */
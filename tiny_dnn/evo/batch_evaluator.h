@@ -0,0 +1,404 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "tiny_dnn/network.h"
+#include "tiny_dnn/activations/activation_layer.h"
+#include "tiny_dnn/layers/fully_connected_layer.h"
+#include "tiny_dnn/evo/genome_view.h"
+#include "tiny_dnn/evo/sample_view.h"
+#include "tiny_dnn/util/product.h"
+
+namespace tiny_dnn {
+
+    /**
+     * Evaluates many genomes at once on the same minibatch, without going
+     * through network::forward.
+     *
+     * The network is compiled once into a flat list of steps. Each
+     * fully_connected_layer is computed as a GEMM over all samples of the
+     * minibatch, reading its weights straight out of the genome: every
+     * individual brings its own weight matrix, the input rows are shared.
+     * evaluate() on several genomes runs up to blockSize of them through
+     * each step together, one loop over inputs and samples driving all
+     * their GEMMs, so each input value is loaded once per block rather than
+     * once per genome.
+     * Activation layers are applied through activation_layer's own
+     * forward_activation so results match the layer code exactly.
+     *
+     * Only networks made of fully connected and activation layers are
+     * supported; check isSupported() and fall back to network replicas
+     * otherwise.
+     */
+    template <typename Error>
+    class BatchEvaluator {
+    public:
+        /**
+         * Scratch buffers for one evaluating thread.
+         * Sized lazily, reused across calls.
+         */
+        struct Workspace {
+            /// One activation tensor per step and genome of a block, one
+            /// vec_t per sample: genome k's step s is k * steps + s.
+            std::vector<tensor_t> outputs;
+        };
+
+        /// Genomes evaluate() runs through the steps together.
+        static const size_t blockSize = 4;
+
+        /**
+         * Compile the network. It is only read here, never run.
+         * @param net
+         */
+        explicit BatchEvaluator(network<sequential> & net)
+            : mSupported(true), mWeightCount(0) {
+            for (auto & l : net) {
+                Step step;
+                step.dense = false;
+                step.activation = nullptr;
+
+                auto * dense = dynamic_cast<fully_connected_layer *>(l);
+                auto * activation = dynamic_cast<activation_layer *>(l);
+
+                if (dense != nullptr) {
+                    step.dense = true;
+                    step.in = dense->fan_in_size();
+                    step.out = dense->fan_out_size();
+                    step.hasBias = (dense->weights().size() == 2);
+                    step.weightOffset = mWeightCount;
+                    step.biasOffset = mWeightCount + step.in * step.out;
+                }
+                else if (activation != nullptr) {
+                    step.activation = activation;
+                    step.in = step.out = activation->in_data_size();
+                }
+                else {
+                    mSupported = false;
+                }
+
+                for (const vec_t * weights : l->weights()) {
+                    mWeightCount += weights->size();
+                }
+
+                mSteps.push_back(step);
+            }
+
+            if (mSteps.empty()) {
+                mSupported = false;
+            }
+        }
+
+        /**
+         * Can this network be evaluated without running it?
+         * @return supported
+         */
+        bool isSupported() const { return mSupported; }
+
+        size_t getWeightCount() const { return mWeightCount; }
+
+        /**
+         * Sum of Error over the minibatch for a single genome, the same value
+         * network::get_loss<Error> returns with that genome loaded.
+         * @param genome
+         * @param data
+         * @param labels
+         * @param workspace scratch buffers private to the calling thread.
+         * @return error
+         */
+        float_t evaluate(GenomeView genome,
+                         const SampleView & data,
+                         const SampleView & labels,
+                         Workspace & workspace) const {
+            prepare(data.size(), workspace);
+            return forward(0, genome, data, labels, workspace);
+        }
+
+        /**
+         * Evaluate count genomes on the same minibatch, blockSize at a time.
+         * Each error is exactly what evaluate() returns for that genome.
+         * @param genomes
+         * @param count
+         * @param data
+         * @param labels
+         * @param errors    count outputs.
+         * @param workspace scratch buffers private to the calling thread.
+         */
+        void evaluate(const GenomeView * genomes, size_t count,
+                      const SampleView & data,
+                      const SampleView & labels,
+                      float_t * errors, Workspace & workspace) const {
+            const size_t steps = mSteps.size();
+            const size_t samples = data.size();
+            for (size_t first = 0; first < count; first += blockSize) {
+                const size_t n = std::min(size_t(blockSize), count - first);
+                const GenomeView * block = genomes + first;
+                prepare(samples, workspace, n);
+
+                tensor_t * outputs[blockSize];
+                for (size_t k = 0; k < n; k++) {
+                    outputs[k] = &workspace.outputs[k * steps];
+                }
+                const SampleView * shared[blockSize];
+                std::fill(shared, shared + n, &data);
+                runBlock(mSteps[0], block, n, shared, outputs);
+
+                for (size_t s = 1; s < steps; s++) {
+                    const tensor_t * inputs[blockSize];
+                    for (size_t k = 0; k < n; k++) {
+                        inputs[k] = outputs[k];
+                        outputs[k] = &workspace.outputs[k * steps + s];
+                    }
+                    runBlock(mSteps[s], block, n, inputs, outputs);
+                }
+
+                for (size_t k = 0; k < n; k++) {
+                    float_t error(0);
+                    for (size_t j = 0; j < samples; j++) {
+                        error += Error::f((*outputs[k])[j], labels[j]);
+                    }
+                    errors[first + k] = error;
+                }
+            }
+        }
+
+        /**
+         * Can children be scored from their parent's input layer?
+         * True when the first layer is fully connected.
+         * @return supported
+         */
+        bool supportsDelta() const { return mSupported && mSteps[0].dense; }
+
+        /**
+         * Pre-activations of the first layer, one row per sample.
+         * Computed once for a parent, reused by evaluateDelta() for each of
+         * its mutated children.
+         * @param genome
+         * @param data
+         * @param output resized to samples x outputs.
+         */
+        void inputLayer(GenomeView genome, const SampleView & data,
+                        tensor_t & output) const {
+            output.resize(data.size());
+            for (vec_t & row : output) {
+                row.resize(mSteps[0].out);
+            }
+            dense(mSteps[0], genome, data, output);
+        }
+
+        /**
+         * Score a child that differs from its parent in the touched genes
+         * only. The first layer is patched from the parent's inputLayer()
+         * output, one multiply-add per sample and touched weight, instead of
+         * being recomputed. The other layers read the child genome as usual.
+         * @param parent_input parent's inputLayer() for this minibatch.
+         * @param parent
+         * @param child
+         * @param touched ascending indices of the genes that may differ.
+         * @param data
+         * @param labels
+         * @param workspace scratch buffers private to the calling thread.
+         * @return error, up to rounding the same as evaluate(child).
+         */
+        float_t evaluateDelta(const tensor_t & parent_input,
+                              GenomeView parent, GenomeView child,
+                              const std::vector<uint32_t> & touched,
+                              const SampleView & data,
+                              const SampleView & labels,
+                              Workspace & workspace) const {
+            const size_t samples = data.size();
+            prepare(samples, workspace);
+
+            const Step & step = mSteps[0];
+            tensor_t & output = workspace.outputs[0];
+            for (size_t j = 0; j < samples; j++) {
+                std::copy(parent_input[j].begin(), parent_input[j].end(),
+                          output[j].begin());
+            }
+
+            const size_t bias_end = step.hasBias ? step.biasOffset + step.out
+                                                 : step.biasOffset;
+            for (uint32_t k : touched) {
+                if (k >= bias_end) {
+                    break;
+                }
+
+                const float_t delta = child[k] - parent[k];
+                if (k >= step.biasOffset) {
+                    const size_t o = k - step.biasOffset;
+                    for (size_t j = 0; j < samples; j++) {
+                        output[j][o] += delta;
+                    }
+                }
+                else {
+                    const size_t c = (k - step.weightOffset) / step.out;
+                    const size_t o = (k - step.weightOffset) % step.out;
+                    for (size_t j = 0; j < samples; j++) {
+                        output[j][o] += delta * data[j][c];
+                    }
+                }
+            }
+
+            return forward(1, child, data, labels, workspace);
+        }
+
+    private:
+        struct Step {
+            bool dense;
+            bool hasBias;
+            size_t in;
+            size_t out;
+            size_t weightOffset;
+            size_t biasOffset;
+            activation_layer * activation;
+        };
+
+        bool mSupported;
+        size_t mWeightCount;
+        std::vector<Step> mSteps;
+
+        void prepare(size_t samples, Workspace & workspace,
+                     size_t genomes = 1) const {
+            const size_t steps = mSteps.size();
+            if (workspace.outputs.size() < steps * genomes) {
+                workspace.outputs.resize(steps * genomes);
+            }
+            for (size_t t = 0; t < steps * genomes; t++) {
+                tensor_t & output = workspace.outputs[t];
+                if (output.size() != samples) {
+                    output.resize(samples);
+                }
+                for (vec_t & row : output) {
+                    row.resize(mSteps[t % steps].out);
+                }
+            }
+        }
+
+        /**
+         * Run the steps from first on, the earlier steps' outputs already
+         * being in the workspace.
+         */
+        float_t forward(size_t first, GenomeView genome,
+                        const SampleView & data,
+                        const SampleView & labels,
+                        Workspace & workspace) const {
+            const size_t samples = data.size();
+
+            if (first == 0) {
+                run(mSteps[0], genome, data, workspace.outputs[0]);
+                first = 1;
+            }
+            for (size_t s = first; s < mSteps.size(); s++) {
+                run(mSteps[s], genome, workspace.outputs[s - 1],
+                    workspace.outputs[s]);
+            }
+
+            const tensor_t & result = workspace.outputs[mSteps.size() - 1];
+            float_t error(0);
+            for (size_t j = 0; j < samples; j++) {
+                error += Error::f(result[j], labels[j]);
+            }
+            return error;
+        }
+
+        /**
+         * One step over every sample. Input is the minibatch for the first
+         * step, the previous step's output tensor after that.
+         */
+        template <typename Input>
+        static void run(const Step & step, GenomeView genome,
+                        const Input & input, tensor_t & output) {
+            if (step.dense) {
+                dense(step, genome, input, output);
+            }
+            else {
+                for (size_t j = 0; j < input.size(); j++) {
+                    step.activation->forward_activation(input[j], output[j]);
+                }
+            }
+        }
+
+        /**
+         * One step for n genomes of a block, genome k reading inputs[k] and
+         * writing outputs[k].
+         */
+        template <typename Input>
+        static void runBlock(const Step & step, const GenomeView * genomes,
+                             size_t n, const Input * const * inputs,
+                             tensor_t * const * outputs) {
+            if (step.dense) {
+                denseBlock(step, genomes, n, inputs, outputs);
+                return;
+            }
+            for (size_t k = 0; k < n; k++) {
+                run(step, genomes[k], *inputs[k], *outputs[k]);
+            }
+        }
+
+        /**
+         * dense() for n genomes at once. For every input c and sample j,
+         * row c of each genome's W is applied in turn, so the shared input
+         * column stays in registers and each genome's row in L1, while
+         * every genome's outputs accumulate in the same order as dense().
+         */
+        template <typename Input>
+        static void denseBlock(const Step & step, const GenomeView * genomes,
+                               size_t n, const Input * const * inputs,
+                               tensor_t * const * outputs) {
+            const size_t samples = inputs[0]->size();
+            const float_t * W[blockSize];
+            for (size_t k = 0; k < n; k++) {
+                W[k] = genomes[k].data() + step.weightOffset;
+                for (size_t j = 0; j < samples; j++) {
+                    vec_t & row = (*outputs[k])[j];
+                    if (step.hasBias) {
+                        const float_t * b = genomes[k].data() + step.biasOffset;
+                        std::copy(b, b + step.out, row.begin());
+                    }
+                    else {
+                        std::fill(row.begin(), row.end(), float_t(0));
+                    }
+                }
+            }
+
+            for (size_t c = 0; c < step.in; c++) {
+                for (size_t j = 0; j < samples; j++) {
+                    for (size_t k = 0; k < n; k++) {
+                        vectorize::muladd(W[k] + c * step.out,
+                                          (*inputs[k])[j][c], step.out,
+                                          &(*outputs[k])[j][0]);
+                    }
+                }
+            }
+        }
+
+        /**
+         * Y = X * W + b over every sample. Weight rows are streamed once for
+         * the whole minibatch instead of once per sample.
+         */
+        template <typename Input>
+        static void dense(const Step & step, GenomeView genome,
+                          const Input & input, tensor_t & output) {
+            const float_t * W = genome.data() + step.weightOffset;
+            const size_t samples = input.size();
+
+            for (size_t j = 0; j < samples; j++) {
+                if (step.hasBias) {
+                    const float_t * b = genome.data() + step.biasOffset;
+                    std::copy(b, b + step.out, output[j].begin());
+                }
+                else {
+                    std::fill(output[j].begin(), output[j].end(), float_t(0));
+                }
+            }
+
+            for (size_t c = 0; c < step.in; c++) {
+                const float_t * row = W + c * step.out;
+                for (size_t j = 0; j < samples; j++) {
+                    vectorize::muladd(row, input[j][c], step.out,
+                                      &output[j][0]);
+                }
+            }
+        }
+    };
+}
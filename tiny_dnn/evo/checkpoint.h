@@ -0,0 +1,347 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+#include "tiny_dnn/config.h"
+#include "tiny_dnn/evo/genome_view.h"
+#include "tiny_dnn/evo/random.h"
+#include "tiny_dnn/util/aligned_allocator.h"
+#include "tiny_dnn/util/nn_error.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace tiny_dnn {
+
+    /**
+     * Fixed size header at the start of an Evolver snapshot file.
+     *
+     * The file is the header, the fitness of every individual, the last
+     * generation's errors, the species representatives (speciation only),
+     * the int8 ranges of every genome (int8 only) and then the genomes, one
+     * after the other, each section starting on
+     * a 64-byte boundary. Values are stored in the
+     * machine's own representation: a snapshot is meant to be resumed on the
+     * same kind of machine that wrote it.
+     */
+    struct SnapshotHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t floatSize;
+
+        uint64_t populationSize;
+        uint64_t genomeLength;
+        uint64_t generation;
+        uint64_t batchIndex;
+        uint64_t batchEpoch;
+        uint64_t seed;
+        float mutationPower;
+        float mutationRate;
+        Random::State random;
+        /// Species representatives and the adaptive species threshold.
+        uint64_t speciesCount;
+        float speciesThreshold;
+        /// GenomePrecision the population was stored with, and the floats
+        /// of int8 ranges each genome's row sits on.
+        uint32_t genomePrecision;
+        uint64_t rangeCount;
+
+        uint64_t fitnessOffset;
+        uint64_t errorsOffset;
+        uint64_t speciesOffset;
+        uint64_t rangesOffset;
+        uint64_t genomesOffset;
+        uint64_t fileSize;
+
+        static const uint32_t current_version = 3;
+
+        static const char * expectedMagic() { return "LEEASNAP"; }
+    };
+
+    /**
+     * An Evolver's complete state, held in memory. Filled by
+     * Evolver::checkpoint(), written by writeSnapshot().
+     */
+    struct Snapshot {
+        SnapshotHeader header;
+        std::vector<float> fitness;
+        std::vector<float_t> errors;
+        /// Speciation::getState() of speciesCount representatives.
+        std::vector<float_t> species;
+        /// rangeCount floats per genome, see Population::getRanges().
+        std::vector<float> ranges;
+        /// populationSize rows of genomeLength genes, back to back.
+        std::vector<float_t, aligned_allocator<float_t, 64>> genomes;
+    };
+
+    namespace snapshot_detail {
+        inline uint64_t align(uint64_t offset) {
+            return (offset + 63) / 64 * 64;
+        }
+
+        inline void write(std::FILE * file, const void * data, size_t bytes,
+                          uint64_t * offset) {
+            if (bytes > 0 && std::fwrite(data, 1, bytes, file) != bytes) {
+                throw nn_error("Failed writing snapshot");
+            }
+            *offset += bytes;
+        }
+
+        inline void pad(std::FILE * file, uint64_t * offset) {
+            static const char zeros[64] = {0};
+            write(file, zeros, align(*offset) - *offset, offset);
+        }
+    }
+
+    /**
+     * Stream a snapshot to disk. The file is written next to path and
+     * renamed over it at the end, so an interrupted write never leaves a
+     * truncated snapshot behind.
+     * @param snapshot header offsets are filled in here.
+     * @param path
+     */
+    inline void writeSnapshot(Snapshot & snapshot, const std::string & path) {
+        using namespace snapshot_detail;
+        SnapshotHeader & header = snapshot.header;
+
+        std::memcpy(header.magic, SnapshotHeader::expectedMagic(), 8);
+        header.version = SnapshotHeader::current_version;
+        header.floatSize = sizeof(float_t);
+        header.fitnessOffset = align(sizeof(SnapshotHeader));
+        header.errorsOffset = align(header.fitnessOffset
+                                    + snapshot.fitness.size() * sizeof(float));
+        header.speciesOffset = align(header.errorsOffset
+                                     + snapshot.errors.size() * sizeof(float_t));
+        header.rangesOffset = align(header.speciesOffset
+                                    + snapshot.species.size() * sizeof(float_t));
+        header.genomesOffset = align(header.rangesOffset
+                                     + snapshot.ranges.size() * sizeof(float));
+        header.fileSize = header.genomesOffset
+                        + snapshot.genomes.size() * sizeof(float_t);
+
+        const std::string temporary = path + ".tmp";
+        std::FILE * file = std::fopen(temporary.c_str(), "wb");
+        if (file == nullptr) {
+            throw nn_error("Can't open snapshot file: " + temporary);
+        }
+
+        try {
+            uint64_t offset = 0;
+            write(file, &header, sizeof(header), &offset);
+            pad(file, &offset);
+            write(file, snapshot.fitness.data(),
+                  snapshot.fitness.size() * sizeof(float), &offset);
+            pad(file, &offset);
+            write(file, snapshot.errors.data(),
+                  snapshot.errors.size() * sizeof(float_t), &offset);
+            pad(file, &offset);
+            write(file, snapshot.species.data(),
+                  snapshot.species.size() * sizeof(float_t), &offset);
+            pad(file, &offset);
+            write(file, snapshot.ranges.data(),
+                  snapshot.ranges.size() * sizeof(float), &offset);
+            pad(file, &offset);
+            write(file, snapshot.genomes.data(),
+                  snapshot.genomes.size() * sizeof(float_t), &offset);
+
+            if (std::fclose(file) != 0) {
+                file = nullptr;
+                throw nn_error("Failed writing snapshot");
+            }
+        }
+        catch (...) {
+            if (file != nullptr) {
+                std::fclose(file);
+            }
+            std::remove(temporary.c_str());
+            throw;
+        }
+
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+            throw nn_error("Can't move snapshot into place: " + path);
+        }
+    }
+
+    /**
+     * Read only view of a snapshot file. The file is memory mapped where
+     * the platform allows it, so genomes are paged in as they are copied
+     * out instead of being read up front.
+     */
+    class SnapshotReader {
+    public:
+        explicit SnapshotReader(const std::string & path) {
+#ifndef _WIN32
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw nn_error("Can't open snapshot file: " + path);
+            }
+            struct stat info;
+            if (fstat(fd, &info) != 0 || info.st_size == 0) {
+                close(fd);
+                throw nn_error("Can't read snapshot file: " + path);
+            }
+            mSize = static_cast<size_t>(info.st_size);
+            void * memory = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (memory == MAP_FAILED) {
+                throw nn_error("Can't map snapshot file: " + path);
+            }
+            mData = static_cast<const char *>(memory);
+#else
+            std::FILE * file = std::fopen(path.c_str(), "rb");
+            if (file == nullptr) {
+                throw nn_error("Can't open snapshot file: " + path);
+            }
+            std::fseek(file, 0, SEEK_END);
+            mBuffer.resize(static_cast<size_t>(std::ftell(file)));
+            std::fseek(file, 0, SEEK_SET);
+            size_t read = std::fread(&mBuffer[0], 1, mBuffer.size(), file);
+            std::fclose(file);
+            if (read != mBuffer.size()) {
+                throw nn_error("Can't read snapshot file: " + path);
+            }
+            mData = mBuffer.data();
+            mSize = mBuffer.size();
+#endif
+            validate(path);
+        }
+
+        ~SnapshotReader() {
+#ifndef _WIN32
+            munmap(const_cast<char *>(mData), mSize);
+#endif
+        }
+
+        SnapshotReader(const SnapshotReader &) = delete;
+        SnapshotReader & operator=(const SnapshotReader &) = delete;
+
+        const SnapshotHeader & getHeader() const {
+            return *reinterpret_cast<const SnapshotHeader *>(mData);
+        }
+
+        const float * getFitness() const {
+            return reinterpret_cast<const float *>(
+                mData + getHeader().fitnessOffset);
+        }
+
+        const float_t * getErrors() const {
+            return reinterpret_cast<const float_t *>(
+                mData + getHeader().errorsOffset);
+        }
+
+        const float_t * getSpecies() const {
+            return reinterpret_cast<const float_t *>(
+                mData + getHeader().speciesOffset);
+        }
+
+        /**
+         * The int8 ranges genome i was stored on, rangeCount floats.
+         * @param i
+         * @return ranges
+         */
+        const float * getRanges(size_t i) const {
+            const SnapshotHeader & header = getHeader();
+            return reinterpret_cast<const float *>(
+                mData + header.rangesOffset) + i * header.rangeCount;
+        }
+
+        GenomeView getGenome(size_t i) const {
+            const SnapshotHeader & header = getHeader();
+            const float_t * genomes = reinterpret_cast<const float_t *>(
+                mData + header.genomesOffset);
+            return GenomeView(genomes + i * header.genomeLength,
+                              header.genomeLength);
+        }
+
+    private:
+        const char * mData = nullptr;
+        size_t mSize = 0;
+#ifdef _WIN32
+        std::vector<char> mBuffer;
+#endif
+
+        void validate(const std::string & path) const {
+            if (mSize < sizeof(SnapshotHeader)) {
+                throw nn_error("Truncated snapshot file: " + path);
+            }
+            const SnapshotHeader & header = getHeader();
+            if (std::memcmp(header.magic, SnapshotHeader::expectedMagic(), 8)
+                    != 0
+                || header.version != SnapshotHeader::current_version
+                || header.floatSize != sizeof(float_t)) {
+                throw nn_error("Not a compatible snapshot file: " + path);
+            }
+            if (header.fileSize != mSize) {
+                throw nn_error("Truncated snapshot file: " + path);
+            }
+        }
+    };
+
+    /**
+     * Writes snapshots on a background thread. The caller only pays for
+     * copying the state into the writer's buffer; if the previous snapshot
+     * is still being written, it waits for that first.
+     */
+    class CheckpointWriter {
+    public:
+        ~CheckpointWriter() {
+            if (mThread.joinable()) {
+                mThread.join();
+            }
+        }
+
+        /**
+         * Buffer to fill before calling write(). Waits for any write in
+         * progress, since it's that write's buffer.
+         * @return snapshot
+         */
+        Snapshot & buffer() {
+            wait();
+            return mSnapshot;
+        }
+
+        /**
+         * Start writing buffer() to path in the background.
+         * @param path
+         */
+        void write(const std::string & path) {
+            wait();
+            mThread = std::thread([this, path] {
+                try {
+                    writeSnapshot(mSnapshot, path);
+                }
+                catch (...) {
+                    mError = std::current_exception();
+                }
+            });
+        }
+
+        /**
+         * Block until the write in progress is done. Rethrows its error.
+         */
+        void wait() {
+            if (mThread.joinable()) {
+                mThread.join();
+            }
+            if (mError) {
+                std::exception_ptr error = mError;
+                mError = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+
+    private:
+        Snapshot mSnapshot;
+        std::thread mThread;
+        std::exception_ptr mError;
+    };
+}
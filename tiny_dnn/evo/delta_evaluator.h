@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "tiny_dnn/evo/batch_evaluator.h"
+#include "tiny_dnn/evo/eval_scheduler.h"
+#include "tiny_dnn/evo/population.h"
+
+namespace tiny_dnn {
+
+    /**
+     * Incremental evaluation of mutated offspring.
+     *
+     * Reproduction records, for every child made by mutation, its parent and
+     * the genes the mutation touched. Once the generation's minibatch is
+     * known, prepare() computes the first layer pre-activations of every
+     * parent that has at least two such children, and evaluate() scores
+     * each of those children by patching the parent's pre-activations with
+     * the touched first layer weights only.
+     *
+     * The minibatch changes every generation, so a parent's pre-activations
+     * can't be carried over from its own evaluation: the saving is one first
+     * layer pass per extra mutated child of the same parent. Children of
+     * parents with a single mutated child are evaluated normally.
+     */
+    template <typename Error>
+    class DeltaEvaluator {
+    public:
+        static const size_t none = std::numeric_limits<size_t>::max();
+
+        /**
+         * @param evaluator compiled network, must outlive this.
+         * @param size      population size.
+         */
+        DeltaEvaluator(const BatchEvaluator<Error> & evaluator, size_t size)
+            : mEvaluator(evaluator), mParents(size, none),
+              mMutations(size), mSlots(size, none) { }
+
+        bool isSupported() const { return mEvaluator.supportsDelta(); }
+
+        /**
+         * Child was produced by mutating parent. Safe to call concurrently
+         * for different children.
+         * @param child
+         * @param parent index in the generation being replaced.
+         * @return where mutate() should record the touched genes.
+         */
+        std::vector<uint32_t> * recordMutation(size_t child, size_t parent) {
+            mParents[child] = parent;
+            return &mMutations[child];
+        }
+
+        /**
+         * Child wasn't produced by mutation alone.
+         * @param child
+         */
+        void recordOther(size_t child) { mParents[child] = none; }
+
+        /**
+         * Forget every record, e.g. for a freshly randomized population.
+         */
+        void clear() {
+            std::fill(mParents.begin(), mParents.end(), none);
+        }
+
+        /**
+         * Compute the shared parents' pre-activations for this minibatch.
+         * Call after Population::swap(), with the generation's minibatch.
+         * @param population
+         * @param data
+         * @param scheduler
+         */
+        void prepare(const Population & population,
+                     const SampleView & data,
+                     EvalScheduler & scheduler) {
+            mCached.clear();
+            std::fill(mSlots.begin(), mSlots.end(), none);
+            if (!isSupported()) {
+                return;
+            }
+
+            // A slot is reserved on a parent's second mutated child.
+            mChildren.assign(mParents.size(), 0);
+            for (size_t parent : mParents) {
+                if (parent != none && ++mChildren[parent] == 2) {
+                    mSlots[parent] = mCached.size();
+                    mCached.push_back(parent);
+                }
+            }
+
+            if (mActivations.size() < mCached.size()) {
+                mActivations.resize(mCached.size());
+            }
+
+            scheduler.run(mCached.size(), 0,
+                [&](size_t begin, size_t end, size_t) {
+                    for (size_t slot = begin; slot < end; slot++) {
+                        mEvaluator.inputLayer(
+                            population.getPreviousGenome(mCached[slot]),
+                            data, mActivations[slot]);
+                    }
+                });
+        }
+
+        /**
+         * Score child i from its parent's pre-activations, if prepare()
+         * cached them.
+         * @param i
+         * @param population
+         * @param data
+         * @param labels
+         * @param workspace
+         * @param error out.
+         * @return false when i has to be evaluated normally.
+         */
+        bool evaluate(size_t i, const Population & population,
+                      const SampleView & data,
+                      const SampleView & labels,
+                      typename BatchEvaluator<Error>::Workspace & workspace,
+                      float_t * error) const {
+            const size_t parent = mParents[i];
+            if (parent == none || mSlots[parent] == none) {
+                return false;
+            }
+
+            *error = mEvaluator.evaluateDelta(mActivations[mSlots[parent]],
+                                              population.getPreviousGenome(parent),
+                                              population.getGenome(i),
+                                              mMutations[i], data, labels,
+                                              workspace);
+            return true;
+        }
+
+    private:
+        const BatchEvaluator<Error> & mEvaluator;
+
+        /// Per child, its parent when produced by mutation, none otherwise.
+        std::vector<size_t> mParents;
+        /// Per child, the genes its mutation touched.
+        std::vector<std::vector<uint32_t>> mMutations;
+
+        /// Per parent, its slot in mActivations or none.
+        std::vector<size_t> mSlots;
+        std::vector<size_t> mChildren;
+        /// Per slot, the parent cached there.
+        std::vector<size_t> mCached;
+        std::vector<tensor_t> mActivations;
+    };
+
+    template <typename Error>
+    const size_t DeltaEvaluator<Error>::none;
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "tiny_dnn/config.h"
+#include "tiny_dnn/evo/eval_scheduler.h"
+
+namespace tiny_dnn {
+
+    /**
+     * Finds the elite of a population without sorting all of it.
+     *
+     * Fitness is copied into a compact (fitness, index) array and only the
+     * top count entries are brought to the front with nth_element, then
+     * sorted. The pass that fills the array also gathers the generation's
+     * statistics, so reporting needs no extra sweep over the population.
+     *
+     * Large populations are split in blocks, one per scheduler thread:
+     * each block selects its own top entries, then only those candidates
+     * are selected from. Ties are broken by index, so both paths give the
+     * same elite in the same order.
+     */
+    class EliteRanking {
+    public:
+        /// 8 bytes per individual, nothing else is touched while ranking.
+        struct Entry {
+            float fitness;
+            uint32_t index;
+        };
+
+        /// Statistics of the last ranked generation.
+        struct Stats {
+            float bestFitness = 0;
+            double averageFitness = 0;
+            float_t lowestError = 0;
+            double averageError = 0;
+        };
+
+        /**
+         * @param parallel_threshold populations at least this large are
+         *                           ranked on the scheduler.
+         */
+        explicit EliteRanking(size_t parallel_threshold = 1 << 16)
+            : mParallelThreshold(parallel_threshold) { }
+
+        /**
+         * Rank a population.
+         * @param fitness   one value per individual.
+         * @param errors    one value per individual, for the statistics.
+         * @param top       how many elites to bring to the front, in order.
+         * @param ranking   out, population indices: the top best to worst,
+         *                  then the rest in no particular order.
+         * @param scheduler optional, used for large populations.
+         */
+        void rank(const std::vector<float> & fitness,
+                  const std::vector<float_t> & errors, size_t top,
+                  std::vector<size_t> * ranking,
+                  EvalScheduler * scheduler = nullptr) {
+            const size_t count = fitness.size();
+            top = std::min(top, count);
+            mEntries.resize(count);
+
+            const size_t blocks =
+                (scheduler != nullptr && count >= mParallelThreshold)
+                    ? scheduler->getThreadCount() : 1;
+            const size_t per_block = (count + blocks - 1) / blocks;
+            mBlockStats.assign(blocks, Partial());
+            mBlockTop.assign(blocks, 0);
+
+            auto block = [&](size_t b) {
+                const size_t begin = std::min(count, b * per_block);
+                const size_t end = std::min(count, begin + per_block);
+                mBlockStats[b] = fill(fitness, errors, begin, end);
+                mBlockTop[b] = std::min(top, end - begin);
+                select(mEntries.begin() + begin, mEntries.begin() + end,
+                       mBlockTop[b]);
+            };
+
+            ranking->resize(count);
+            if (blocks == 1) {
+                block(0);
+                std::sort(mEntries.begin(), mEntries.begin() + top, better);
+                for (size_t i = 0; i < count; i++) {
+                    (*ranking)[i] = mEntries[i].index;
+                }
+            }
+            else {
+                scheduler->run(blocks, 1, [&](size_t begin, size_t end, size_t) {
+                    for (size_t b = begin; b < end; b++) {
+                        block(b);
+                    }
+                });
+
+                // The elite is among the blocks' own top entries.
+                mCandidates.clear();
+                for (size_t b = 0; b < blocks && b * per_block < count; b++) {
+                    auto first = mEntries.begin() + b * per_block;
+                    mCandidates.insert(mCandidates.end(),
+                                       first, first + mBlockTop[b]);
+                }
+                select(mCandidates.begin(), mCandidates.end(), top);
+                std::sort(mCandidates.begin(), mCandidates.begin() + top,
+                          better);
+
+                size_t next = 0;
+                for (size_t i = 0; i < top; i++) {
+                    (*ranking)[next++] = mCandidates[i].index;
+                }
+                // Everyone worse than the last elite follows, in block order.
+                for (const Entry & entry : mEntries) {
+                    if (top == 0 || better(mCandidates[top - 1], entry)) {
+                        (*ranking)[next++] = entry.index;
+                    }
+                }
+            }
+
+            Partial total;
+            for (const Partial & partial : mBlockStats) {
+                total.merge(partial);
+            }
+            mStats.bestFitness = total.bestFitness;
+            mStats.lowestError = total.lowestError;
+            mStats.averageFitness = count ? total.fitnessSum / count : 0;
+            mStats.averageError = count ? total.errorSum / count : 0;
+        }
+
+        const Stats & getStats() const { return mStats; }
+
+    private:
+        struct Partial {
+            float bestFitness = std::numeric_limits<float>::lowest();
+            float_t lowestError = std::numeric_limits<float_t>::max();
+            double fitnessSum = 0;
+            double errorSum = 0;
+
+            void merge(const Partial & other) {
+                bestFitness = std::max(bestFitness, other.bestFitness);
+                lowestError = std::min(lowestError, other.lowestError);
+                fitnessSum += other.fitnessSum;
+                errorSum += other.errorSum;
+            }
+        };
+
+        size_t mParallelThreshold;
+        std::vector<Entry> mEntries;
+        std::vector<Entry> mCandidates;
+        std::vector<Partial> mBlockStats;
+        std::vector<size_t> mBlockTop;
+        Stats mStats;
+
+        static bool better(const Entry & a, const Entry & b) {
+            return a.fitness > b.fitness
+                || (a.fitness == b.fitness && a.index < b.index);
+        }
+
+        /**
+         * Bring the top entries of [first, last) to its front.
+         */
+        template <typename Iter>
+        static void select(Iter first, Iter last, size_t top) {
+            if (top > 0 && first + top < last) {
+                std::nth_element(first, first + (top - 1), last, better);
+            }
+        }
+
+        Partial fill(const std::vector<float> & fitness,
+                     const std::vector<float_t> & errors,
+                     size_t begin, size_t end) {
+            Partial partial;
+            for (size_t i = begin; i < end; i++) {
+                mEntries[i].fitness = fitness[i];
+                mEntries[i].index = static_cast<uint32_t>(i);
+
+                partial.bestFitness = std::max(partial.bestFitness, fitness[i]);
+                partial.fitnessSum += fitness[i];
+                if (i < errors.size()) {
+                    partial.lowestError = std::min(partial.lowestError,
+                                                   errors[i]);
+                    partial.errorSum += errors[i];
+                }
+            }
+            return partial;
+        }
+    };
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "tiny_dnn/util/concurrency.h"
+#include "tiny_dnn/util/topology.h"
+
+namespace tiny_dnn {
+
+    /**
+     * Persistent worker pool for population evaluation.
+     *
+     * Workers are started once and parked between jobs. A job over [0, count)
+     * is cut into one contiguous range per worker; each worker claims chunks
+     * from its own range first and then steals chunks from the others, so a
+     * slow range doesn't hold up the generation.
+     *
+     * Pinned workers are placed over the NUMA nodes by cpu_topology. A
+     * worker's network replica is built on the worker the first time it
+     * needs one, so its weights and activations are first touched, and
+     * allocated, on that worker's node.
+     */
+    class EvalScheduler {
+    public:
+        /// work(begin, end, worker) evaluates [begin, end) on a worker.
+        typedef std::function<void(size_t, size_t, size_t)> work_t;
+
+        /**
+         * Start the workers.
+         * @param threads number of workers, at least one.
+         * @param pin     pin each worker to a cpu of its own.
+         * @param first   with pin, index of the first worker among total
+         *                placed together, see cpu_topology::placement().
+         * @param total   0 for just these workers.
+         */
+        explicit EvalScheduler(size_t threads, bool pin = false,
+                               size_t first = 0, size_t total = 0)
+            : mRanges(std::max<size_t>(threads, 1)) {
+            for (size_t w = 0; w < mRanges.size(); w++) {
+                mWorkers.emplace_back([this, w] { workerLoop(w); });
+            }
+            if (pin) {
+                // Pinned before their first job, so replicas are still
+                // allocated on the right node.
+                mUnpinned = pin_workers(mWorkers,
+                    cpu_topology::detect().placement(mRanges.size(), first,
+                                                     total));
+            }
+        }
+
+        ~EvalScheduler() {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mStop = true;
+            }
+            mWake.notify_all();
+            for (auto & worker : mWorkers) {
+                worker.join();
+            }
+        }
+
+        EvalScheduler(const EvalScheduler &) = delete;
+        EvalScheduler & operator=(const EvalScheduler &) = delete;
+
+        size_t getThreadCount() const { return mRanges.size(); }
+
+        /// Workers that were to be pinned but couldn't be.
+        size_t getUnpinnedCount() const { return mUnpinned; }
+
+        /**
+         * Run work over [0, count) and wait for it to finish.
+         * The first exception thrown by a worker is rethrown here.
+         * @param count number of items.
+         * @param chunk items claimed at a time, 0 picks one.
+         * @param work
+         */
+        void run(size_t count, size_t chunk, const work_t & work) {
+            if (count == 0) {
+                return;
+            }
+
+            const size_t threads = mRanges.size();
+            if (chunk == 0) {
+                // Enough chunks per worker to balance, few enough to keep
+                // the atomics off the profile.
+                chunk = std::max<size_t>(1, count / (threads * 8));
+            }
+
+            const size_t per_worker = (count + threads - 1) / threads;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                for (size_t w = 0; w < threads; w++) {
+                    size_t begin = std::min(count, w * per_worker);
+                    mRanges[w].next.store(begin);
+                    mRanges[w].end = std::min(count, begin + per_worker);
+                }
+                mWork = &work;
+                mChunk = chunk;
+                mError = nullptr;
+                mBusy = threads;
+                mJob++;
+            }
+            mWake.notify_all();
+
+            std::unique_lock<std::mutex> lock(mMutex);
+            mDone.wait(lock, [this] { return mBusy == 0; });
+            mWork = nullptr;
+
+            if (mError) {
+                std::rethrow_exception(mError);
+            }
+        }
+
+    private:
+        /// A worker's share of the job, padded to a cache line so that
+        /// claims on neighbouring ranges don't contend.
+        struct Range {
+            std::atomic<size_t> next;
+            size_t end;
+            char padding[64 - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+            Range() : next(0), end(0) { }
+        };
+
+        std::vector<Range> mRanges;
+        std::vector<std::thread> mWorkers;
+
+        std::mutex mMutex;
+        std::condition_variable mWake;
+        std::condition_variable mDone;
+        const work_t * mWork = nullptr;
+        size_t mChunk = 1;
+        size_t mBusy = 0;
+        size_t mJob = 0;
+        bool mStop = false;
+        std::exception_ptr mError;
+        size_t mUnpinned = 0;
+
+        /**
+         * Claim the next chunk of a range.
+         * @return false once the range is exhausted.
+         */
+        bool claim(Range & range, size_t chunk, size_t * begin, size_t * end) {
+            size_t b = range.next.fetch_add(chunk);
+            if (b >= range.end) {
+                return false;
+            }
+            *begin = b;
+            *end = std::min(range.end, b + chunk);
+            return true;
+        }
+
+        void workerLoop(size_t id) {
+            // Several workers already keep the cores busy; the layers'
+            // own parallel loops run inline on them.
+            std::unique_ptr<parallel_region> region;
+            if (mRanges.size() > 1) {
+                region.reset(new parallel_region());
+            }
+
+            size_t seen = 0;
+            for (;;) {
+                const work_t * work;
+                size_t chunk;
+                {
+                    std::unique_lock<std::mutex> lock(mMutex);
+                    mWake.wait(lock, [&] { return mStop || mJob != seen; });
+                    if (mStop) {
+                        return;
+                    }
+                    seen = mJob;
+                    work = mWork;
+                    chunk = mChunk;
+                }
+
+                try {
+                    size_t begin, end;
+                    // Own range first, then steal from the others.
+                    for (size_t v = 0; v < mRanges.size(); v++) {
+                        Range & range = mRanges[(id + v) % mRanges.size()];
+                        while (claim(range, chunk, &begin, &end)) {
+                            (*work)(begin, end, id);
+                        }
+                    }
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    if (!mError) {
+                        mError = std::current_exception();
+                    }
+                    // Let the other workers drain quickly.
+                    for (auto & range : mRanges) {
+                        range.next.store(range.end);
+                    }
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    if (--mBusy == 0) {
+                        mDone.notify_all();
+                    }
+                }
+            }
+        }
+    };
+}
@@ -1,7 +1,30 @@
 #pragma once
 
 #include "tiny_dnn/evo/evolver.h"
+#include "tiny_dnn/evo/evolution_strategy.h"
+#include "tiny_dnn/evo/island.h"
+#include "tiny_dnn/evo/migration.h"
+#include "tiny_dnn/evo/minibatch.h"
+#include "tiny_dnn/evo/sample_view.h"
+#include "tiny_dnn/evo/genome_codec.h"
+#include "tiny_dnn/evo/genome_initializer.h"
+#include "tiny_dnn/evo/genome_view.h"
+#include "tiny_dnn/evo/population.h"
+#include "tiny_dnn/evo/batch_evaluator.h"
+#include "tiny_dnn/evo/checkpoint.h"
+#include "tiny_dnn/evo/metrics.h"
+#include "tiny_dnn/evo/delta_evaluator.h"
+#include "tiny_dnn/evo/eval_scheduler.h"
+#include "tiny_dnn/evo/fitness_cache.h"
+#include "tiny_dnn/evo/noise_table.h"
+#include "tiny_dnn/evo/optimizer_factory.h"
+#include "tiny_dnn/evo/replicas.h"
+#include "tiny_dnn/evo/random_stream.h"
+#include "tiny_dnn/evo/rng_service.h"
 #include "tiny_dnn/evo/individual.h"
 #include "tiny_dnn/evo/params.h"
 #include "tiny_dnn/evo/roulette.h"
+#include "tiny_dnn/evo/selector.h"
+#include "tiny_dnn/evo/selection.h"
+#include "tiny_dnn/evo/speciation.h"
 #include "tiny_dnn/evo/random.h"
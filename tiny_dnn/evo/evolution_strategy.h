@@ -0,0 +1,439 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "tiny_dnn/evo/batch_evaluator.h"
+#include "tiny_dnn/evo/eval_scheduler.h"
+#include "tiny_dnn/evo/genome_initializer.h"
+#include "tiny_dnn/evo/genome_view.h"
+#include "tiny_dnn/evo/individual.h"
+#include "tiny_dnn/evo/metrics.h"
+#include "tiny_dnn/evo/minibatch.h"
+#include "tiny_dnn/evo/noise_table.h"
+#include "tiny_dnn/evo/optimizer_factory.h"
+#include "tiny_dnn/evo/params.h"
+#include "tiny_dnn/evo/random.h"
+#include "tiny_dnn/evo/random_stream.h"
+#include "tiny_dnn/evo/replicas.h"
+#include "tiny_dnn/evo/rng_service.h"
+#include "tiny_dnn/evo/sample_view.h"
+#include "tiny_dnn/util/util.h"
+
+namespace tiny_dnn {
+
+    /**
+     * Evolution strategies in the OpenAI-ES style, the alternative to the
+     * Evolver's LEEA (engine = es).
+     *
+     * Only one genome is kept, the centre theta. Every generation
+     * population_size / 2 antithetic pairs theta + sigma e, theta - sigma e
+     * are scored on the minibatch, e being the slice of a shared NoiseTable
+     * picked by RandomStream(seed, generation, pair). The errors are
+     * replaced by centred ranks u in [-0.5, 0.5] and the gradient estimate
+     *
+     *     sum over pairs of (u+ - u-) e / (population * sigma)
+     *
+     * is handed to a tiny_dnn optimizer (es_optimizer), which moves theta.
+     *
+     * Memory is theta, the gradient, one scratch genome per thread and the
+     * noise table, whatever the population size. Pairs are evaluated and
+     * gradient slices summed in parallel; both only depend on their keys,
+     * so a run doesn't depend on the number of threads.
+     */
+    template <typename Error>
+    class EvolutionStrategy {
+    public:
+        /**
+         * @param net describes the architecture; the evaluation threads get
+         *            replicas of it when the BatchEvaluator can't be used.
+         * @param train_labels, one-hot encodings.
+         * @param train_data
+         * @param random initial theta and seeds.
+         * @param params
+         */
+        EvolutionStrategy(std::shared_ptr<network<sequential>> net,
+                          std::shared_ptr<std::vector<vec_t>> train_labels,
+                          std::shared_ptr<std::vector<vec_t>> train_data,
+                          Random * random, const EvoParams & params)
+            : EvolutionStrategy(
+                  std::vector<std::shared_ptr<network<sequential>>>(1, net),
+                  train_labels, train_data, random, params) { }
+
+        /**
+         * @param networks replicas of the same network, more are built for
+         *                 threads beyond them.
+         * @param train_labels, one-hot encodings.
+         * @param train_data
+         * @param random initial theta and seeds.
+         * @param params
+         */
+        EvolutionStrategy(
+            const std::vector<std::shared_ptr<network<sequential>>> & networks,
+            std::shared_ptr<std::vector<vec_t>> train_labels,
+            std::shared_ptr<std::vector<vec_t>> train_data,
+            Random * random, const EvoParams & params)
+            : mParams(validated(params)),
+              mScheduler(params.threads != 0
+                             ? params.threads
+                             : std::thread::hardware_concurrency(),
+                         params.pin_threads, params.pin_first,
+                         params.pin_total),
+              mReplicas(networks, mScheduler.getThreadCount()),
+              mWeightCount(NetworkReplicas::countWeights(*networks[0])),
+              mEvaluator(*networks[0]),
+              mOptimizer(makeOptimizer(params.es_optimizer,
+                                       params.es_learning_rate)),
+              mHandler(train_labels, train_data, params.sample_count,
+                       params.batch_order, params.prefetch_batches) {
+            mRng = RngService::fromRandom(random);
+            mHandler.setSeed(mRng.split(RngService::minibatch).getSeed());
+            mNoise = std::make_shared<NoiseTable>(
+                mParams.noise_table_size,
+                mRng.split(RngService::noise).getSeed());
+            if (mNoise->size() < mWeightCount) {
+                throw nn_error("noise_table_size is smaller than the genome");
+            }
+
+            const size_t pairs = std::max<size_t>(mParams.population_size / 2,
+                                                  1);
+            mOffsets.resize(pairs);
+            mCoefficients.resize(pairs);
+            mErrors.resize(2 * pairs);
+            mUtilities.resize(2 * pairs);
+            mOrder.resize(2 * pairs);
+            mWorkspaces.resize(mScheduler.getThreadCount());
+            mScratch.resize(mScheduler.getThreadCount());
+
+            mTheta.resize(mWeightCount);
+            RandomStream init =
+                mRng.split(RngService::initialization).stream();
+            GenomeInitializer(mParams.weight_init,
+                              mParams.initial_weights_delta, *networks[0])
+                .fill(MutableGenomeView(mTheta.data(), mTheta.size()), init);
+            mGradient.assign(mWeightCount, 0);
+        }
+
+        /**
+         * Run max_generations generations.
+         */
+        void evolve() {
+            evolve(mParams.max_generations);
+        }
+
+        /**
+         * Run up to generations more generations, stopping at
+         * max_generations.
+         * @param generations
+         */
+        void evolve(size_t generations) {
+            for (size_t g = 0; g < generations && !isFinished(); g++) {
+                step();
+            }
+            if (mMetrics) {
+                mMetrics->flush();
+            }
+        }
+
+        /**
+         * One generation: score the perturbations on the next minibatch,
+         * estimate the gradient and move theta.
+         */
+        void step() {
+            typedef std::chrono::steady_clock clock;
+            typedef std::chrono::duration<double> seconds;
+
+            const clock::time_point start = clock::now();
+            mHandler.next();
+            const SampleView mini_data = mHandler.getData();
+            const SampleView mini_labels = mHandler.getLabels();
+            mScheduler.run(mOffsets.size(), 0,
+                [&](size_t begin, size_t end, size_t id) {
+                    evaluateRange(begin, end, id, mini_data, mini_labels);
+                });
+            const clock::time_point evaluated = clock::now();
+
+            shapeFitness();
+            const clock::time_point shaped = clock::now();
+
+            estimateGradient();
+            mOptimizer->update(mGradient, mTheta, true);
+            const clock::time_point updated = clock::now();
+
+            if (isTracked()) {
+                GenerationMetrics metrics = measure(mini_data.size());
+                metrics.evalSeconds = seconds(evaluated - start).count();
+                metrics.sortSeconds = seconds(shaped - evaluated).count();
+                metrics.reproduceSeconds = seconds(updated - shaped).count();
+                mMetrics->record(metrics);
+            }
+            mCurrentGeneration++;
+        }
+
+        /**
+         * Error of theta on some samples, summed like network::get_loss.
+         * @param data
+         * @param labels
+         * @return error
+         */
+        float_t evaluate(const SampleView & data, const SampleView & labels) {
+            std::vector<vec_t> gathered_data;
+            std::vector<vec_t> gathered_labels;
+            gatherForNetwork(data, labels, &gathered_data, &gathered_labels);
+            return errorOf(getParameters(), 0, data, labels, gathered_data,
+                           gathered_labels);
+        }
+
+        /**
+         * The first network, loaded with theta.
+         * @return network
+         */
+        std::shared_ptr<network<sequential>> getNetwork() {
+            mReplicas.load(getParameters(), 0);
+            return mReplicas.get(0);
+        }
+
+        /// Current centre of the search distribution.
+        GenomeView getParameters() const {
+            return GenomeView(mTheta.data(), mTheta.size());
+        }
+
+        /**
+         * Start the search from given weights.
+         * @param parameters getWeightCount() genes.
+         */
+        void setParameters(GenomeView parameters) {
+            if (parameters.size() != mWeightCount) {
+                throw nn_error("Parameter count mismatch");
+            }
+            std::copy(parameters.begin(), parameters.end(), mTheta.begin());
+        }
+
+        /**
+         * Send per-generation metrics to a sink, every tracking_stride
+         * generations. Fitness describes the generation's perturbations,
+         * mutation power is sigma.
+         * @param sink nullptr to stop recording.
+         */
+        void setMetricsSink(std::shared_ptr<MetricsSink> sink) {
+            mMetrics = sink;
+        }
+
+        bool isFinished() const {
+            return mCurrentGeneration >= mParams.max_generations;
+        }
+
+        size_t getCurrentGeneration() const { return mCurrentGeneration; }
+
+        size_t getWeightCount() const { return mWeightCount; }
+
+        size_t getThreadCount() const { return mScheduler.getThreadCount(); }
+
+        const EvoParams & getParams() const { return mParams; }
+
+        /// Shared by every perturbation of the run.
+        std::shared_ptr<const NoiseTable> getNoiseTable() const {
+            return mNoise;
+        }
+
+    private:
+        /// Gradient elements each thread claims at a time.
+        static const size_t gradientChunk = 4096;
+
+        EvoParams mParams;
+        size_t mCurrentGeneration = 0;
+
+        EvalScheduler mScheduler;
+        NetworkReplicas mReplicas;
+        size_t mWeightCount;
+        BatchEvaluator<Error> mEvaluator;
+        std::vector<typename BatchEvaluator<Error>::Workspace> mWorkspaces;
+
+        std::unique_ptr<optimizer> mOptimizer;
+        MiniBatchHandler mHandler;
+        /// Root of the per pair RandomStreams.
+        RngService mRng;
+        std::shared_ptr<NoiseTable> mNoise;
+
+        vec_t mTheta;
+        vec_t mGradient;
+        /// Per thread, where perturbed genomes are built.
+        std::vector<vec_t> mScratch;
+
+        /// Per pair, where its noise starts, and its weight in the estimate.
+        std::vector<size_t> mOffsets;
+        std::vector<float_t> mCoefficients;
+        /// Per perturbation, 2p is theta + sigma e, 2p + 1 theta - sigma e.
+        std::vector<float_t> mErrors;
+        std::vector<float> mUtilities;
+        /// Perturbations, worst first.
+        std::vector<size_t> mOrder;
+
+        std::shared_ptr<MetricsSink> mMetrics;
+
+        static const EvoParams & validated(const EvoParams & params) {
+            params.validate();
+            return params;
+        }
+
+        /**
+         * Score pairs [begin, end) with thread id.
+         */
+        void evaluateRange(size_t begin, size_t end, size_t id,
+                           const SampleView & mini_data,
+                           const SampleView & mini_labels) {
+            std::vector<vec_t> gathered_data;
+            std::vector<vec_t> gathered_labels;
+            gatherForNetwork(mini_data, mini_labels, &gathered_data,
+                             &gathered_labels);
+
+            vec_t & genome = mScratch[id];
+            genome.resize(mWeightCount);
+            for (size_t p = begin; p < end; p++) {
+                RandomStream stream = mRng.stream(mCurrentGeneration, p);
+                mOffsets[p] = mNoise->sampleOffset(stream, mWeightCount);
+                const float_t * noise =
+                    mNoise->get(mOffsets[p], mWeightCount).data();
+
+                for (size_t side = 0; side < 2; side++) {
+                    const float_t scale = side == 0 ? mParams.es_sigma
+                                                    : -mParams.es_sigma;
+                    for (size_t k = 0; k < mWeightCount; k++) {
+                        genome[k] = mTheta[k] + scale * noise[k];
+                    }
+                    mErrors[2 * p + side] = errorOf(
+                        GenomeView(genome.data(), genome.size()), id,
+                        mini_data, mini_labels, gathered_data,
+                        gathered_labels);
+                }
+            }
+        }
+
+        /**
+         * Networks only take whole vectors: copy the batch out once when
+         * the batch evaluator can't be used.
+         */
+        void gatherForNetwork(const SampleView & mini_data,
+                              const SampleView & mini_labels,
+                              std::vector<vec_t> * data,
+                              std::vector<vec_t> * labels) const {
+            if (!mEvaluator.isSupported()) {
+                mini_data.gather(data);
+                mini_labels.gather(labels);
+            }
+        }
+
+        float_t errorOf(GenomeView genome, size_t id,
+                        const SampleView & mini_data,
+                        const SampleView & mini_labels,
+                        const std::vector<vec_t> & data,
+                        const std::vector<vec_t> & labels) {
+            if (mEvaluator.isSupported()) {
+                return mEvaluator.evaluate(genome, mini_data, mini_labels,
+                                           mWorkspaces[id]);
+            }
+            mReplicas.load(genome, id);
+            return mReplicas.get(id)->template get_loss<Error>(data, labels);
+        }
+
+        /**
+         * Centred ranks: the worst perturbation gets -0.5, the best 0.5,
+         * whatever the scale of the errors.
+         */
+        void shapeFitness() {
+            for (size_t i = 0; i < mOrder.size(); i++) {
+                mOrder[i] = i;
+            }
+            const std::vector<float_t> & errors = mErrors;
+            std::sort(mOrder.begin(), mOrder.end(),
+                      [&errors](size_t a, size_t b) {
+                          return errors[a] > errors[b]
+                              || (errors[a] == errors[b] && a < b);
+                      });
+
+            const size_t last = mOrder.size() - 1;
+            for (size_t r = 0; r < mOrder.size(); r++) {
+                mUtilities[mOrder[r]] = float(r) / last - 0.5f;
+            }
+            for (size_t p = 0; p < mCoefficients.size(); p++) {
+                mCoefficients[p] = mUtilities[2 * p] - mUtilities[2 * p + 1];
+            }
+        }
+
+        /**
+         * mGradient = -sum of coefficient e / (population * sigma), the
+         * descent direction of the error. Each thread sums its slices over
+         * every pair, in pair order.
+         */
+        void estimateGradient() {
+            const float_t scale =
+                -1 / (mErrors.size() * float_t(mParams.es_sigma));
+            mScheduler.run(mWeightCount, gradientChunk,
+                [this, scale](size_t begin, size_t end, size_t) {
+                    std::fill(mGradient.begin() + begin,
+                              mGradient.begin() + end, float_t(0));
+                    for (size_t p = 0; p < mOffsets.size(); p++) {
+                        const float_t coefficient = mCoefficients[p];
+                        if (coefficient == 0) {
+                            continue;
+                        }
+                        const float_t * noise =
+                            mNoise->get(mOffsets[p], mWeightCount).data();
+                        for (size_t k = begin; k < end; k++) {
+                            mGradient[k] += coefficient * noise[k];
+                        }
+                    }
+                    for (size_t k = begin; k < end; k++) {
+                        mGradient[k] *= scale;
+                    }
+                });
+        }
+
+        bool isTracked() const {
+            return mMetrics
+                && mCurrentGeneration
+                       % std::max<size_t>(mParams.tracking_stride, 1) == 0;
+        }
+
+        /**
+         * Statistics of the generation's perturbations, fitness being
+         * samples - error as for the Evolver.
+         * @param samples minibatch size.
+         * @return metrics, timings left for the caller.
+         */
+        GenerationMetrics measure(size_t samples) const {
+            GenerationMetrics metrics;
+            metrics.generation = mCurrentGeneration;
+
+            // mOrder runs from the highest error to the lowest.
+            auto fitnessAt = [&](size_t r) {
+                return std::max<float>(samples - mErrors[mOrder[r]],
+                                       mParams.min_fitness);
+            };
+            const size_t last = mOrder.size() - 1;
+            metrics.bestFitness = fitnessAt(last);
+            metrics.p10Fitness = fitnessAt(last / 10);
+            metrics.medianFitness = fitnessAt(last / 2);
+            metrics.p90Fitness = fitnessAt(last * 9 / 10);
+            metrics.lowestError = mErrors[mOrder[last]];
+
+            double fitness = 0;
+            double error = 0;
+            for (size_t r = 0; r < mOrder.size(); r++) {
+                fitness += fitnessAt(r);
+                error += mErrors[r];
+            }
+            metrics.meanFitness = fitness / mOrder.size();
+            metrics.meanError = error / mOrder.size();
+
+            metrics.mutationPower = mParams.es_sigma;
+            metrics.mutationRate = 1;
+            metrics.speciesCount = 0;
+            metrics.largestSpecies = 0;
+            return metrics;
+        }
+    };
+}
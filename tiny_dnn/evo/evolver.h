@@ -1,17 +1,41 @@
 #pragma once
 
 #include <array>
+#include <chrono>
 #include <memory>
 #include <vector>
 #include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <utility>
 #include <thread>
 #include <limits>
+#include <string>
+#include <unordered_map>
 #include "tiny_dnn/evo/params.h"
 #include "tiny_dnn/evo/individual.h"
+#include "tiny_dnn/evo/genome_view.h"
+#include "tiny_dnn/evo/population.h"
+#include "tiny_dnn/evo/batch_evaluator.h"
+#include "tiny_dnn/evo/checkpoint.h"
+#include "tiny_dnn/evo/delta_evaluator.h"
+#include "tiny_dnn/evo/eval_scheduler.h"
+#include "tiny_dnn/evo/elite_ranking.h"
+#include "tiny_dnn/evo/fitness_cache.h"
+#include "tiny_dnn/evo/genome_initializer.h"
+#include "tiny_dnn/evo/metrics.h"
+#include "tiny_dnn/evo/migration.h"
+#include "tiny_dnn/evo/minibatch.h"
+#include "tiny_dnn/evo/optimizer_factory.h"
+#include "tiny_dnn/evo/random_stream.h"
+#include "tiny_dnn/evo/replicas.h"
+#include "tiny_dnn/evo/rng_service.h"
 #include "tiny_dnn/evo/roulette.h"
+#include "tiny_dnn/evo/sample_view.h"
+#include "tiny_dnn/evo/selection.h"
+#include "tiny_dnn/evo/speciation.h"
 #include "tiny_dnn/util/util.h"
 
 namespace tiny_dnn {
@@ -20,95 +44,153 @@ typedef std::shared_ptr<std::vector<std::shared_ptr<Individual>>> population_t;
 
     /**
      * Evolver class. Aims to minimize the weights of the network using LEEA.
+     * N is the number of network replicas handed to the constructor, the
+     * number of evaluation threads is chosen at run time.
      */
-    template <typename Error, size_t N>
+    template <typename Error, size_t N = 1>
     class Evolver {
     public:
 
-        /**
-         * Utility class to take care of dipatching minibatches.
-         * @param labels training labels.
-         * @param data training data.
-         */
-        struct MiniBatchHandler {
-            MiniBatchHandler(std::shared_ptr<std::vector<vec_t>> labels,
-                             std::shared_ptr<std::vector<vec_t>> data) :
-                             mTrainLabels(labels),
-                             mTrainData(data)
-                             { }
-
-            /**
-             * Copy the next mini batch into the provided vector pointers.
-             * @param mini_data
-             * @param mini_label
-             */
-            inline void nextBatch(std::vector<vec_t> *mini_labels,
-                                  std::vector<vec_t> *mini_data) {
-                mini_labels->resize(Params::sample_count);
-                mini_data->resize(Params::sample_count);
-
-                for (size_t i = 0; i < Params::sample_count; i++) {
-                    if (mIndex >= mTrainLabels->size()) {
-                        // We've rolled into the new epoch.
-                        mEpoch++;
-                        mIndex = 0;
-                    }
-
-                    (*mini_labels)[i] = (*mTrainLabels)[mIndex];
-                    (*mini_data)[i] = (*mTrainData)[mIndex];
-                    mIndex++;
-                }
-            }
-
-            size_t getEpoch() { return mEpoch; }
-
-        private:
-            size_t mIndex = 0;
-            size_t mEpoch = 0;
-            std::shared_ptr<std::vector<vec_t>> mTrainLabels;
-            std::shared_ptr<std::vector<vec_t>> mTrainData;
-        };
-
+        /// Dispatches minibatches, see minibatch.h.
+        typedef tiny_dnn::MiniBatchHandler MiniBatchHandler;
 
         /**
          * Evolver constructor.
          * @param networks, multiple of the same network for parallelization.
          * @param train_labels, one-hot encodings.
          * @param train_data, some data!
-         * @param initialize, should we initalize the population?
-         *                    If no, be sure to on your own!
+         * @param random
+         * @param threads, evaluation threads. Threads beyond N get a replica
+         *                 of their own the first time they need one.
          */
         Evolver(std::array<std::shared_ptr<network<sequential>>, N> * networks,
                 std::shared_ptr<std::vector<vec_t>> train_labels,
                 std::shared_ptr<std::vector<vec_t>> train_data,
-                Random * random)
-                : mNetworks(networks), mHandler(train_labels, train_data) {
-            mRandom = random;
+                Random * random, size_t threads = N)
+                : Evolver(networks, train_labels, train_data, random,
+                          withThreads(threads)) { }
+
+        /**
+         * Evolver constructor with run time parameters.
+         * @param networks, multiple of the same network for parallelization.
+         * @param train_labels, one-hot encodings.
+         * @param train_data, some data!
+         * @param random
+         * @param params, e.g. from EvoParams::fromFile.
+         */
+        Evolver(std::array<std::shared_ptr<network<sequential>>, N> * networks,
+                std::shared_ptr<std::vector<vec_t>> train_labels,
+                std::shared_ptr<std::vector<vec_t>> train_data,
+                Random * random, const EvoParams & params)
+                : Evolver(std::vector<std::shared_ptr<network<sequential>>>(
+                              networks->begin(), networks->end()),
+                          train_labels, train_data, random, params) { }
+
+        /**
+         * Evolver constructor from a single network.
+         * When the BatchEvaluator supports the network it only describes the
+         * architecture and no replicas are ever made. Otherwise each thread
+         * but the first lazily builds its own replica from it.
+         * @param net
+         * @param train_labels, one-hot encodings.
+         * @param train_data, some data!
+         * @param random
+         * @param threads, evaluation threads.
+         */
+        Evolver(std::shared_ptr<network<sequential>> net,
+                std::shared_ptr<std::vector<vec_t>> train_labels,
+                std::shared_ptr<std::vector<vec_t>> train_data,
+                Random * random, size_t threads = N)
+                : Evolver(net, train_labels, train_data, random,
+                          withThreads(threads)) { }
+
+        /**
+         * Evolver constructor from a single network, with run time
+         * parameters.
+         * @param net
+         * @param train_labels, one-hot encodings.
+         * @param train_data, some data!
+         * @param random
+         * @param params, e.g. from EvoParams::fromFile.
+         */
+        Evolver(std::shared_ptr<network<sequential>> net,
+                std::shared_ptr<std::vector<vec_t>> train_labels,
+                std::shared_ptr<std::vector<vec_t>> train_data,
+                Random * random, const EvoParams & params)
+                : Evolver(std::vector<std::shared_ptr<network<sequential>>>(
+                              1, net),
+                          train_labels, train_data, random, params) { }
 
-            for (size_t i = 0; i < Params::population_size; i++) {
-                mPopulation.push_back(nullptr);
-                mGenerationErrors.push_back(0.0);
+    private:
+        Evolver(const std::vector<std::shared_ptr<network<sequential>>> &
+                    networks,
+                std::shared_ptr<std::vector<vec_t>> train_labels,
+                std::shared_ptr<std::vector<vec_t>> train_data,
+                Random * random, const EvoParams & params)
+                : mParams(validated(params)),
+                  mScheduler(params.threads != 0
+                                 ? params.threads
+                                 : std::thread::hardware_concurrency(),
+                             params.pin_threads, params.pin_first,
+                             params.pin_total),
+                  mReplicas(networks, mScheduler.getThreadCount()),
+                  mWeightCount(NetworkReplicas::countWeights(*networks[0])),
+                  mEvaluator(*networks[0]),
+                  mPopulation(params.population_size, mWeightCount,
+                              makeCodec(params, *networks[0])),
+                  mDelta(mEvaluator, params.population_size),
+                  mCache(params.fitness_cache ? 4 * params.population_size
+                                              : 1),
+                  mSpecies(params.speciation ? params.population_size : 0,
+                           mWeightCount, params.species_threshold,
+                           params.species_target, params.max_species),
+                  mSelector(makeSelector(params, random)),
+                  mHandler(train_labels, train_data, params.sample_count,
+                           params.batch_order, params.prefetch_batches) {
+            if (mPopulation.isCompressed()) {
+                // Parents are only ever widened into scratch, there's no
+                // stored first layer input to patch.
+                mParams.delta_evaluation = false;
             }
 
-            mMutationPower = Params::mutation_power;
-            mMutationDecayRate = Params::mutation_rate_decay;
-            mDecayRate = pow(1 - Params::mutation_power_decay,
-                            1.0f / Params::max_generations);
-            mRateDecayRate = pow(1 - Params::mutation_rate_decay,
-                            1.0f / Params::max_generations);
-            mMutationRate = Params::mutation_rate;
+            mRandom = random;
+            mRng = RngService::fromRandom(random);
+            mHandler.setSeed(batchSeed());
+
+            mWorkspaces.resize(mScheduler.getThreadCount());
+            mScratch.resize(mScheduler.getThreadCount());
+
+            mGenerationErrors.resize(mParams.population_size, 0.0);
+            mHashes.resize(mParams.population_size);
+            mOffspringHashes.resize(mParams.population_size);
+            mHashKnown.resize(mParams.population_size, 0);
+            mOffspringHashKnown.resize(mParams.population_size, 0);
+            mSources.resize(mParams.population_size);
+            mRanking.resize(mParams.population_size);
+            resetRanking();
 
-            mWeightCount = calculateWeightCount();
-            initializePopulation(mWeightCount);
+            const float generations =
+                std::max<size_t>(mParams.max_generations, 1);
+            mMutationPower = mParams.mutation_power;
+            mMutationDecayRate = mParams.mutation_rate_decay;
+            mDecayRate = pow(1 - mParams.mutation_power_decay,
+                            1.0f / generations);
+            mRateDecayRate = pow(1 - mParams.mutation_rate_decay,
+                            1.0f / generations);
+            mMutationRate = mParams.mutation_rate;
+
+            initializePopulation();
         }
 
+    public:
+
         /**
          * Get a pointer to the current network weights.
          * @return shared_ptr
          */
         std::shared_ptr<std::vector<float>> getCurrentNetworkWeights(size_t idx) {
             auto network_weights = std::make_shared<std::vector<float>>();
-            for (auto & layer : *((*mNetworks)[idx])) {
+            for (auto & layer : *mReplicas.get(idx)) {
                 for (auto & weights : layer->weights()) {
                     for (float weight : *weights) {
                         network_weights->push_back(weight);
@@ -124,10 +206,18 @@ typedef std::shared_ptr<std::vector<std::shared_ptr<Individual>>> population_t;
          * @param individual
          */
         void loadWeights(std::shared_ptr<Individual> individual, size_t id) {
-            int idx = 0;
-            for (auto & layer : *((*mNetworks)[id])) {
-                layer->load(*(individual->getGenome()), idx);
-            }
+            loadWeights(individual->getGenomeView(), id);
+        }
+
+        /**
+         * Loads a network's weights straight from a genome view.
+         * No intermediate copy of the genome is made, each weight vector of
+         * the bound network is filled with a single block copy.
+         * @param genome view of mWeightCount genes.
+         * @param id     which network to load into.
+         */
+        void loadWeights(GenomeView genome, size_t id) {
+            mReplicas.load(genome, id);
         }
 
         /**
@@ -135,204 +225,519 @@ typedef std::shared_ptr<std::vector<std::shared_ptr<Individual>>> population_t;
          * Evaluate to find best individuals and reproduce best.
          */
         void evolve() {
-            while (mCurrentGeneration < Params::max_generations) {
-                sortPopulation();
-                printInfo();
-                reproducePopulation();
+            evolve(mParams.max_generations);
+        }
 
-                evaluatePopulation();
+        /**
+         * Run up to generations more generations, stopping at
+         * max_generations.
+         * @param generations
+         */
+        void evolve(size_t generations) {
+            for (size_t g = 0; g < generations && !isFinished(); g++) {
+                if (isTracked()) {
+                    trackedGeneration();
+                }
+                else {
+                    sortPopulation();
+                    reproducePopulation();
+                    evaluatePopulation();
+                }
+                refineElites();
                 mCurrentGeneration++;
 
                 mMutationPower *= mDecayRate;
                 mMutationRate *= mRateDecayRate;
+
+                if (mParams.checkpoint_interval != 0
+                    && !mParams.checkpoint_path.empty()
+                    && mCurrentGeneration % mParams.checkpoint_interval == 0) {
+                    checkpoint(&mCheckpointWriter.buffer());
+                    mCheckpointWriter.write(mParams.checkpoint_path);
+                }
+            }
+            mCheckpointWriter.wait();
+            if (mMetrics) {
+                mMetrics->flush();
+            }
+        }
+
+        /**
+         * Send per-generation metrics to a sink, every tracking_stride
+         * generations. Without a sink nothing is measured.
+         * @param sink nullptr to stop recording.
+         */
+        void setMetricsSink(std::shared_ptr<MetricsSink> sink) {
+            mMetrics = sink;
+        }
+
+        /**
+         * Copy the whole state of the run, as it stands between two
+         * generations, into a snapshot.
+         * @param snapshot
+         */
+        void checkpoint(Snapshot * snapshot) {
+            SnapshotHeader & header = snapshot->header;
+            std::memset(&header, 0, sizeof(header));
+            header.populationSize = mPopulation.size();
+            header.genomeLength = mWeightCount;
+            header.generation = mCurrentGeneration;
+            header.batchIndex = mHandler.getIndex();
+            header.batchEpoch = mHandler.getEpoch();
+            header.seed = mRng.getSeed();
+            header.mutationPower = mMutationPower;
+            header.mutationRate = mMutationRate;
+            header.random = mRandom->getState();
+            header.genomePrecision = static_cast<uint32_t>(
+                mPopulation.getCodec().getPrecision());
+            header.rangeCount = mPopulation.getCodec().getRangeCount();
+
+            snapshot->fitness = mPopulation.getFitnesses();
+            snapshot->errors.assign(mGenerationErrors.begin(),
+                                    mGenerationErrors.end());
+
+            snapshot->species.clear();
+            if (mParams.speciation) {
+                header.speciesCount = mSpecies.getRepresentativeCount();
+                header.speciesThreshold = mSpecies.getThreshold();
+                mSpecies.getState(&snapshot->species);
             }
+
+            // int8 children sit on grids inherited from their parents, not
+            // on their own min and max, so the grids are saved with them.
+            const size_t range_count = header.rangeCount;
+            snapshot->ranges.resize(mPopulation.size() * range_count);
+            snapshot->genomes.resize(mPopulation.size() * mWeightCount);
+            float * ranges = snapshot->ranges.data();
+            float_t * genomes = snapshot->genomes.data();
+            for_i(true, mPopulation.size(), [&](size_t i) {
+                vec_t scratch;
+                GenomeView genome = mPopulation.readGenome(i, scratch);
+                std::copy(genome.begin(), genome.end(),
+                          genomes + i * mWeightCount);
+                const float * row_ranges = mPopulation.getRanges(i);
+                std::copy(row_ranges, row_ranges + range_count,
+                          ranges + i * range_count);
+            });
+        }
+
+        /**
+         * Write a snapshot now, without going through the background writer.
+         * @param path
+         */
+        void saveCheckpoint(const std::string & path) {
+            Snapshot snapshot;
+            checkpoint(&snapshot);
+            writeSnapshot(snapshot, path);
+        }
+
+        /**
+         * Continue a run from a snapshot. The Evolver must have been built
+         * with the same network, data and parameters as the one that wrote
+         * it; evolve() then follows the original run exactly.
+         * @param snapshot
+         */
+        void restore(const SnapshotReader & snapshot) {
+            const SnapshotHeader & header = snapshot.getHeader();
+            if (header.populationSize != mPopulation.size()
+                || header.genomeLength != mWeightCount) {
+                throw nn_error("Snapshot doesn't match this population");
+            }
+            const GenomeCodec & codec = mPopulation.getCodec();
+            if (header.genomePrecision
+                    != static_cast<uint32_t>(codec.getPrecision())
+                || header.rangeCount != codec.getRangeCount()) {
+                throw nn_error("Snapshot was written with another "
+                               "genome_precision");
+            }
+
+            mCurrentGeneration = static_cast<int>(header.generation);
+            mHandler.setPosition(header.batchIndex, header.batchEpoch);
+            mRng.setSeed(header.seed);
+            mHandler.setSeed(batchSeed());
+            mMutationPower = header.mutationPower;
+            mMutationRate = header.mutationRate;
+            mRandom->setState(header.random);
+
+            const float * fitness = snapshot.getFitness();
+            const float_t * errors = snapshot.getErrors();
+            for_i(true, mPopulation.size(), [&](size_t i) {
+                GenomeView genome = snapshot.getGenome(i);
+                vec_t scratch(genome.begin(), genome.end());
+                mPopulation.restoreGenome(i, viewOf(scratch),
+                                          snapshot.getRanges(i));
+                mPopulation.setFitness(i, fitness[i]);
+                mGenerationErrors[i] = errors[i];
+            });
+
+            mDelta.clear();
+            // Species carry over generations: the representatives and the
+            // adaptive threshold pick up where the original run left them.
+            if (mParams.speciation && header.speciesCount > 0) {
+                if (header.speciesOffset + header.speciesCount
+                        * (Speciation::sketchSize + 1) * sizeof(float_t)
+                    > header.rangesOffset) {
+                    throw nn_error("Snapshot has no species to resume");
+                }
+                mSpecies.setState(header.speciesThreshold,
+                                  snapshot.getSpecies(),
+                                  header.speciesCount);
+            }
+            else {
+                mSpecies.clear();
+            }
+            std::fill(mHashKnown.begin(), mHashKnown.end(), 0);
+            resetRanking();
+            mRanked = false;
+        }
+
+        /**
+         * Continue a run from a snapshot file.
+         * @param path
+         */
+        void resume(const std::string & path) {
+            restore(SnapshotReader(path));
+        }
+
+        /**
+         * Has the run reached max_generations?
+         * @return finished
+         */
+        bool isFinished() const {
+            return size_t(mCurrentGeneration) >= mParams.max_generations;
+        }
+
+        size_t getCurrentGeneration() const { return mCurrentGeneration; }
+
+        /**
+         * Copies of the fittest individuals, best first.
+         * @param count
+         * @return migrants
+         */
+        std::vector<Migrant> getElites(size_t count) {
+            rankTop(count);
+
+            std::vector<Migrant> elites(std::min(count, mPopulation.size()));
+            vec_t scratch;
+            for (size_t k = 0; k < elites.size(); k++) {
+                GenomeView genome = mPopulation.readGenome(mRanking[k],
+                                                           scratch);
+                elites[k].genome.assign(genome.begin(), genome.end());
+                elites[k].fitness = mPopulation.getFitness(mRanking[k]);
+                elites[k].source = 0;
+            }
+            return elites;
+        }
+
+        /**
+         * Replace the least fit individuals with migrants.
+         * @param migrants genomes of getWeightCount() genes.
+         */
+        void immigrate(const std::vector<Migrant> & migrants) {
+            const size_t count = std::min(migrants.size(), mPopulation.size());
+            if (count == 0) {
+                return;
+            }
+
+            std::vector<size_t> worst(mPopulation.size());
+            for (size_t i = 0; i < worst.size(); i++) {
+                worst[i] = i;
+            }
+            const Population & population = mPopulation;
+            std::nth_element(worst.begin(), worst.begin() + (count - 1),
+                             worst.end(), [&population](size_t a, size_t b) {
+                                 return population.getFitness(a)
+                                      < population.getFitness(b);
+                             });
+
+            for (size_t k = 0; k < count; k++) {
+                if (migrants[k].genome.size() != mWeightCount) {
+                    throw nn_error("Migrant genome length mismatch");
+                }
+                vec_t genome(migrants[k].genome.begin(),
+                             migrants[k].genome.end());
+                mPopulation.writeGenome(worst[k], viewOf(genome));
+                mPopulation.setFitness(worst[k], migrants[k].fitness);
+                mDelta.recordOther(worst[k]);
+                mHashKnown[worst[k]] = 0;
+            }
+            mRanked = false;
         }
 
         /**
          * Print out some info for the current state of the run.
          */
         void printInfo() {
+            if (!mRanked) {
+                sortPopulation();
+            }
+            const EliteRanking::Stats & stats = mElites.getStats();
+
             std::cout << "Best fitness of generation "
                     << mCurrentGeneration
-                    << ": " << mPopulation[0]->getFitness()
-                    << std::endl;
+                    << ": " << stats.bestFitness
+                    << '\n';
 
             std::cout << "Average fitness of generation "
                     << mCurrentGeneration
-                    << ": " << getAverageFitness()
-                    << std::endl;
-
-            float_t lowest_error = std::numeric_limits<float_t>::max();
-            float_t average_error = 0;
-
-            for (float_t error : mGenerationErrors) {
-                if (error < lowest_error) {
-                    lowest_error = error;
-                }
-                average_error += error;
-            }
-
-            average_error /= mGenerationErrors.size();
+                    << ": " << stats.averageFitness
+                    << '\n';
 
             std::cout << "Lowest error of generation "
                     << mCurrentGeneration
-                    << ": " << lowest_error
-                    << std::endl;
+                    << ": " << stats.lowestError
+                    << '\n';
 
             std::cout << "Average error of generation "
                     << mCurrentGeneration
-                    << ": " << average_error
-                    << std::endl;
+                    << ": " << stats.averageError
+                    << '\n';
 
             std::cout << "- - - - - - - - - - - - - - - - - - - - - - - - -"
-                      << std::endl;
+                      << '\n';
         }
 
         /**
          * Assign a fitness to each Individual by evaluating the network and
          * getting the value of the loss function for a minibatch.
+         * The minibatch is read in place from the training set, shared
+         * read-only by every evaluation thread.
          */
         void evaluatePopulation() {
-            std::vector<vec_t> mini_data;
-            std::vector<vec_t> mini_labels;
-
-            mHandler.nextBatch(&mini_labels, &mini_data);
-
-            // Inspired by code from tiny_dnn/util/parallel_for.h
-            size_t range_size = mPopulation.size() / N;
-
-            if (range_size * N < (mPopulation.size())) {
-                range_size++;
-            }
-
-            size_t begin = 0;
-            size_t end = begin + range_size;
-            std::vector<std::thread> threads;
-
-            for (size_t i = 0; i < N; i++) {
-                threads.push_back(
-                    std::move(
-                        std::thread(
-                            [this, begin, end, i, mini_data, mini_labels] {
-                                this->evaluateRange(
-                                    begin, end, i, mini_data, mini_labels
-                                );
-                            }
-                        )
-                    )
-                );
-
-                begin += range_size;
-                end = begin + range_size;
-                if (begin >= mPopulation.size()) {
-                    break;
-                }
+            const std::vector<uint32_t> & batch = mHandler.next();
+            const SampleView mini_data = mHandler.getData();
+            const SampleView mini_labels = mHandler.getLabels();
+            mRanked = false;
 
-                if (end > mPopulation.size()) {
-                    end = mPopulation.size();
-                }
+            if (mParams.delta_evaluation) {
+                mDelta.prepare(mPopulation, mini_data, mScheduler);
             }
 
-            for (auto &thread_ : threads) {
-                thread_.join();
+            if (mParams.fitness_cache) {
+                evaluateCached(GenomeHash::ofBatch(batch), mini_data,
+                               mini_labels);
+                return;
             }
+
+            mScheduler.run(mPopulation.size(), 0,
+                [&](size_t begin, size_t end, size_t id) {
+                    evaluateRange(begin, end, id, mini_data, mini_labels);
+                });
         }
 
         /**
-         * Evaluates a range of the population using a particula
+         * Evaluates a range of the population using a particular network.
          * @param start starting index of evaluation.
          * @param end   ending index of evaluation.
-         * @param id    which network to evaluate with.
-         * @param mini_data copy of data to use.
-         * @param mini_labels copy of labels to use.
+         * @param id    which thread (and so network) to evaluate with.
+         * @param mini_data data to use.
+         * @param mini_labels labels to use.
          */
         void evaluateRange(size_t start, size_t end, size_t id,
-            std::vector<vec_t> mini_data, std::vector<vec_t> mini_labels) {
+                           const SampleView & mini_data,
+                           const SampleView & mini_labels) {
+            if (mEvaluator.isSupported()) {
+                evaluateBlocks(start, end, id, mini_data, mini_labels);
+                return;
+            }
+
+            std::vector<vec_t> gathered_data;
+            std::vector<vec_t> gathered_labels;
+            gatherForNetwork(mini_data, mini_labels, &gathered_data,
+                             &gathered_labels);
 
-            float fitness = mini_data.size();
-            float previous_fitness;
-            float_t error;
             for (size_t i = start; i < end; i++) {
-                previous_fitness = mPopulation[i]->getFitness();
-                previous_fitness *= 1 - Params::fitness_decay_rate;
+                assignError(i, errorOf(i, id, mini_data, mini_labels,
+                                       gathered_data, gathered_labels),
+                            mini_data.size());
+            }
+        }
 
-                loadWeights(mPopulation[i], id);
-                error = (*mNetworks)[id]->template get_loss<Error>(mini_data, mini_labels);
-                fitness -= error;
-                mGenerationErrors[i] = error;
+        /**
+         * evaluateRange() through the BatchEvaluator. Children the delta
+         * evaluator can score from their parent are scored that way; the
+         * rest are gathered into blocks that share each pass over the
+         * minibatch.
+         * @param start
+         * @param end
+         * @param id
+         * @param mini_data
+         * @param mini_labels
+         */
+        void evaluateBlocks(size_t start, size_t end, size_t id,
+                            const SampleView & mini_data,
+                            const SampleView & mini_labels) {
+            const size_t block = BatchEvaluator<Error>::blockSize;
+            GenomeScratch & scratch = mScratch[id];
+            scratch.block.resize(block);
+            GenomeView genomes[block];
+            size_t indices[block];
+            float_t errors[block];
+            size_t count = 0;
 
-                fitness = (fitness < Params::min_fitness) ? Params::min_fitness
-                                                          : fitness;
+            auto flush = [&] {
+                mEvaluator.evaluate(genomes, count, mini_data, mini_labels,
+                                    errors, mWorkspaces[id]);
+                for (size_t k = 0; k < count; k++) {
+                    assignError(indices[k], errors[k], mini_data.size());
+                }
+                count = 0;
+            };
 
-                mPopulation[i]->setFitness(fitness + previous_fitness);
+            for (size_t i = start; i < end; i++) {
+                float_t error;
+                if (mParams.delta_evaluation
+                    && mDelta.evaluate(i, mPopulation, mini_data,
+                                       mini_labels, mWorkspaces[id],
+                                       &error)) {
+                    assignError(i, error, mini_data.size());
+                    continue;
+                }
+                indices[count] = i;
+                genomes[count] = mPopulation.readGenome(i,
+                                                        scratch.block[count]);
+                if (++count == block) {
+                    flush();
+                }
+            }
+            if (count > 0) {
+                flush();
             }
         }
 
         /**
-         * Sort the population by fitness.
+         * Lamarckian local search: train the refine_elites fittest
+         * individuals for refine_steps gradient steps on the minibatch last
+         * evaluated, through the network's bprop and update_weights, and
+         * write the trained weights back into their genomes. Each thread
+         * trains elites on its own replica.
+         * Fitness is left as evaluated, the refined genomes earn theirs on
+         * the next minibatch.
+         */
+        void refineElites() {
+            const size_t count = std::min(mParams.refine_elites,
+                                          mPopulation.size());
+            const SampleView mini_data = mHandler.getData();
+            if (count == 0 || mini_data.size() == 0) {
+                return;
+            }
+            rankTop(count);
+
+            // fit() wants whole vectors, shared read-only by the threads.
+            mini_data.gather(&mRefineData);
+            mHandler.getLabels().gather(&mRefineLabels);
+
+            mScheduler.run(count, 1,
+                [this](size_t begin, size_t end, size_t id) {
+                    for (size_t k = begin; k < end; k++) {
+                        refineOne(mRanking[k], id);
+                    }
+                });
+        }
+
+        /**
+         * Evaluations the fitness cache saved so far.
+         * @return count
+         */
+        size_t getSkippedEvaluations() const { return mSkippedEvaluations; }
+
+        /**
+         * Rank the population by fitness, fittest first.
+         * Only the top selection_proportion is put in order, the rest of the
+         * ranking is unordered. Genomes stay where they are in the arena.
+         * Also gathers the generation's statistics.
          */
         inline void sortPopulation() {
-            std::sort(mPopulation.begin(), mPopulation.end(),
-                    [](const std::shared_ptr<Individual> a,
-                       const std::shared_ptr<Individual> b) -> bool
-                   {
-                       return a->getFitness() < b->getFitness();
-                   });
+            mElites.rank(mPopulation.getFitnesses(), mGenerationErrors,
+                         getSelectionCount(), &mRanking, &mScheduler);
+            mRanked = true;
         }
 
         /**
-         * Reproduce the best individuals based on Params::selection_proportion.
+         * Number of individuals reproduction picks parents from.
+         * @return count
          */
-        void reproducePopulation() {
-            std::vector<std::shared_ptr<Individual>> newPopulation;
+        size_t getSelectionCount() const {
+            return (size_t)(mParams.population_size
+                            * mParams.selection_proportion);
+        }
 
-            // At this point, population will (should) be sorted.
-            std::vector<std::shared_ptr<Individual>> top_individuals;
-            for (size_t i = 0;
-                i < (size_t)(Params::population_size * Params::selection_proportion);
-                i++) {
-                top_individuals.push_back(mPopulation[i]);
+        /**
+         * Reproduce the best individuals based on selection_proportion.
+         * Offspring are written into the population's second arena, which is
+         * then swapped in, so no genome storage is allocated here.
+         * Offspring are produced in parallel. Each one draws from its own
+         * RandomStream keyed by (seed, generation, index), so the result
+         * doesn't depend on the number of threads.
+         * With speciation on, parents are picked by fitness shared within
+         * their species instead, so small species aren't crowded out.
+         */
+        void reproducePopulation() {
+            if (!mRanked) {
+                sortPopulation();
             }
+            const size_t top_count = getSelectionCount();
 
-            Roulette wheel(top_individuals, mRandom);
-
-            size_t index;
-            for (size_t i = 0; i < Params::population_size; i++) {
-                index = wheel.spin();
+            mParents = &mRanking;
+            const std::vector<float> * fitness = &mPopulation.getFitnesses();
+            if (mParams.speciation) {
+                speciate();
+                mParents = &mSharedRanking;
+                fitness = &mSpecies.getSharedFitness();
+            }
 
-                // Should we do sexual reproduction?
-                if (mRandom->getDouble() < Params::sex_proportion) {
-                    newPopulation.push_back(mPopulation[index]->createOffspring(
-                        mPopulation[wheel.spin()]));
-                }
-                else {
-                    newPopulation.push_back(mPopulation[index]->createOffspring(
-                        mMutationPower, mMutationRate));
-                }
+            mSelectionFitness.resize(top_count);
+            for (size_t i = 0; i < top_count; i++) {
+                mSelectionFitness[i] = (*fitness)[(*mParents)[i]];
             }
+            mSelector->reset(mSelectionFitness);
+
+            mScheduler.run(mParams.population_size, 0,
+                [this](size_t begin, size_t end, size_t id) {
+                    for (size_t i = begin; i < end; i++) {
+                        reproduceOne(i, id);
+                    }
+                });
 
-            mPopulation = newPopulation;
+            mPopulation.swap();
+            mHashes.swap(mOffspringHashes);
+            mHashKnown.swap(mOffspringHashKnown);
+            resetRanking();
+            mRanked = false;
         }
 
         /**
          * Average fitness of the population.
+         * Free once the population is ranked.
          * @return float_t
          */
         float_t getAverageFitness() {
+            if (mRanked) {
+                return mElites.getStats().averageFitness;
+            }
+
             float_t sum(0);
-            for (auto individual : mPopulation) {
-                sum += individual->getFitness();
+            for (float fitness : mPopulation.getFitnesses()) {
+                sum += fitness;
             }
             return sum / mPopulation.size();
         }
 
         /**
          * Mostly for testing or gathering stats.
+         * Copies every genome out of the arena, in ranking order.
          * @return shared pointer to the population.
          */
         population_t getPopulation() {
-            return std::make_shared<std::vector<std::shared_ptr<Individual>>>
-                    (mPopulation);
+            auto population =
+                std::make_shared<std::vector<std::shared_ptr<Individual>>>();
+            vec_t scratch;
+            for (size_t i : mRanking) {
+                population->push_back(std::make_shared<Individual>(
+                    mPopulation.readGenome(i, scratch), mRandom,
+                    mPopulation.getFitness(i)));
+            }
+            return population;
         }
 
         /**
@@ -341,6 +746,18 @@ typedef std::shared_ptr<std::vector<std::shared_ptr<Individual>>> population_t;
          */
         size_t getWeightCount() { return mWeightCount; }
 
+        /**
+         * Number of threads evaluating the population.
+         * @return count
+         */
+        size_t getThreadCount() const { return mScheduler.getThreadCount(); }
+
+        /**
+         * Parameters this run was started with.
+         * @return params
+         */
+        const EvoParams & getParams() const { return mParams; }
+
         /**
          * Get pointer to the minibatch handler (testing).
          * @return pointer to handler.
@@ -349,15 +766,65 @@ typedef std::shared_ptr<std::vector<std::shared_ptr<Individual>>> population_t;
             return std::make_shared<MiniBatchHandler>(mHandler);
         }
     protected:
+        EvoParams mParams;
         int mCurrentGeneration = 0;
-        std::vector<std::shared_ptr<Individual>> mPopulation;
-        std::vector<float_t> mGenerationErrors;
 
+        EvalScheduler mScheduler;
 
-        std::array<std::shared_ptr<network<sequential>>, N> * mNetworks;
+        /// One network per thread, see replicas.h.
+        NetworkReplicas mReplicas;
 
         size_t mWeightCount;
 
+        /// Scores genomes without the replicas when the network allows it.
+        BatchEvaluator<Error> mEvaluator;
+        std::vector<typename BatchEvaluator<Error>::Workspace> mWorkspaces;
+
+        Population mPopulation;
+        DeltaEvaluator<Error> mDelta;
+        /// Errors of recently evaluated (genome, minibatch) pairs.
+        FitnessCache mCache;
+        /// Species of the population, when speciation is on.
+        Speciation mSpecies;
+        /// Population indices by shared fitness, the parents first.
+        std::vector<size_t> mSharedRanking;
+        EliteRanking mSharedElites;
+        /// Ranking parents are picked from: mRanking or mSharedRanking.
+        const std::vector<size_t> * mParents = &mRanking;
+        /// Per individual, its genome's GenomeHash when mHashKnown.
+        std::vector<uint64_t> mHashes;
+        std::vector<uint64_t> mOffspringHashes;
+        std::vector<char> mHashKnown;
+        std::vector<char> mOffspringHashKnown;
+        /// Per individual, whose error it takes this generation.
+        std::vector<size_t> mSources;
+        /// Individuals the cache couldn't answer for.
+        std::vector<size_t> mPending;
+        std::vector<float_t> mCachedErrors;
+        std::unordered_map<uint64_t, size_t> mFirstOf;
+        size_t mSkippedEvaluations = 0;
+        /// Population indices, the elite first, best to worst, once ranked.
+        std::vector<size_t> mRanking;
+        EliteRanking mElites;
+        /// Whether mRanking and the statistics match the current fitness.
+        bool mRanked = false;
+        std::vector<float_t> mGenerationErrors;
+        /// Per thread, where packed genomes are widened to.
+        struct GenomeScratch {
+            vec_t first;
+            vec_t second;
+            vec_t child;
+            /// evaluateBlocks() genomes.
+            std::vector<vec_t> block;
+        };
+        std::vector<GenomeScratch> mScratch;
+        /// Minibatch copied out for refineElites().
+        std::vector<vec_t> mRefineData;
+        std::vector<vec_t> mRefineLabels;
+        /// Picks parents among the top of the ranking.
+        std::unique_ptr<Selector> mSelector;
+        std::vector<float> mSelectionFitness;
+
         float mMutationPower;
         float mMutationDecayRate;
         float mMutationRate;
@@ -366,29 +833,421 @@ typedef std::shared_ptr<std::vector<std::shared_ptr<Individual>>> population_t;
 
         MiniBatchHandler mHandler;
         Random * mRandom;
+        /// Root of every RandomStream the evolver draws from.
+        RngService mRng;
+        CheckpointWriter mCheckpointWriter;
+        std::shared_ptr<MetricsSink> mMetrics;
+        /// Scratch copy of the fitness for the percentiles.
+        std::vector<float> mMetricsFitness;
     private:
         /**
-         * Calculate how many weights are in the network.
-         * @return count
+         * Default parameters running on a given number of threads.
+         * @param threads
+         * @return params
          */
-        size_t calculateWeightCount() {
-            size_t count = 0;
-            for (auto layer : *((*mNetworks)[0])) {
+        static EvoParams withThreads(size_t threads) {
+            EvoParams params;
+            params.threads = threads;
+            return params;
+        }
+
+        static const EvoParams & validated(const EvoParams & params) {
+            params.validate();
+            return params;
+        }
+
+        static MutableGenomeView viewOf(vec_t & genome) {
+            return MutableGenomeView(genome.data(), genome.size());
+        }
+
+        /**
+         * Storage for the population's genes, per genome_precision. int8
+         * gets one range per weight vector of the network.
+         */
+        static GenomeCodec makeCodec(const EvoParams & params,
+                                     network<sequential> & net) {
+            std::vector<size_t> segments;
+            for (auto layer : net) {
                 for (auto & weights : layer->weights()) {
-                    count += weights->size();
+                    segments.push_back(weights->size());
                 }
             }
-            return count;
+            return GenomeCodec(GenomeCodec::parse(params.genome_precision),
+                               segments);
+        }
+
+        /**
+         * Seed of the minibatch order, kept apart from the (generation,
+         * offspring) streams.
+         * @return seed
+         */
+        uint64_t batchSeed() const {
+            return mRng.split(RngService::minibatch).getSeed();
+        }
+
+        /**
+         * Make sure the count fittest individuals lead the ranking, best
+         * first.
+         * @param count
+         */
+        void rankTop(size_t count) {
+            if (!mRanked || count > getSelectionCount()) {
+                mElites.rank(mPopulation.getFitnesses(), mGenerationErrors,
+                             std::max(count, getSelectionCount()), &mRanking,
+                             &mScheduler);
+                mRanked = true;
+            }
+        }
+
+        /**
+         * A fresh optimizer for one refinement, per refine_optimizer.
+         * Fresh, since adam's step count isn't cleared by reset().
+         * @return optimizer
+         */
+        std::unique_ptr<optimizer> makeRefineOptimizer() const {
+            return makeOptimizer(mParams.refine_optimizer,
+                                 mParams.refine_learning_rate);
         }
 
         /**
-         * Initialize the population in parallel.
-         * @param genome_length
+         * Train individual i on thread id's network and store the result.
+         * @param i
+         * @param id
          */
-        void initializePopulation(size_t genome_length) {
-            for (size_t i = 0; i < mPopulation.size(); i++) {
-                mPopulation[i] = std::make_shared<Individual>(genome_length, mRandom);
+        void refineOne(size_t i, size_t id) {
+            std::shared_ptr<network<sequential>> net = mReplicas.get(id);
+            loadWeights(mPopulation.readGenome(i, mScratch[id].first), id);
+
+            std::unique_ptr<optimizer> opt = makeRefineOptimizer();
+            net->template fit<Error>(*opt, mRefineData, mRefineLabels,
+                                     mRefineData.size(),
+                                     static_cast<int>(mParams.refine_steps));
+
+            vec_t & genome = mScratch[id].child;
+            genome.resize(mWeightCount);
+            mReplicas.read(id, viewOf(genome));
+            mPopulation.writeGenome(i, viewOf(genome));
+            mHashKnown[i] = 0;
+        }
+
+        /**
+         * Produce offspring i into the offspring arena. Packed genomes are
+         * bred in the thread's scratch and packed at the end.
+         * @param i
+         * @param id thread.
+         */
+        void reproduceOne(size_t i, size_t id) {
+            RandomStream stream = mRng.stream(mCurrentGeneration, i);
+            GenomeScratch & scratch = mScratch[id];
+            const bool packed = mPopulation.isCompressed();
+
+            const size_t parent = (*mParents)[mSelector->select(stream)];
+            GenomeView parent_genome = mPopulation.readGenome(parent,
+                                                              scratch.first);
+            if (packed) {
+                scratch.child.resize(mWeightCount);
+            }
+            MutableGenomeView child = packed ? viewOf(scratch.child)
+                                             : mPopulation.getOffspring(i);
+
+            // Should we do sexual reproduction?
+            if (stream.getDouble() < mParams.sex_proportion) {
+                const size_t other = (*mParents)[mSelector->select(stream)];
+
+                Individual::crossover(parent_genome,
+                                      mPopulation.readGenome(other,
+                                                             scratch.second),
+                                      child, stream);
+                mPopulation.setOffspringFitness(i,
+                    (mPopulation.getFitness(parent)
+                     + mPopulation.getFitness(other)) / 2);
+                mDelta.recordOther(i);
+
+                // Crossing a genome with itself is a clone.
+                mOffspringHashes[i] = mHashes[parent];
+                mOffspringHashKnown[i] = parent == other && mHashKnown[parent];
             }
+            else {
+                std::vector<uint32_t> * touched = nullptr;
+                if (mParams.delta_evaluation || mParams.fitness_cache) {
+                    touched = mDelta.recordMutation(i, parent);
+                }
+                else {
+                    mDelta.recordOther(i);
+                }
+
+                Individual::mutate(parent_genome, child,
+                                   mMutationPower, mMutationRate, stream,
+                                   touched);
+                mPopulation.setOffspringFitness(i,
+                    mPopulation.getFitness(parent));
+
+                mOffspringHashKnown[i] = mParams.fitness_cache
+                                      && mHashKnown[parent];
+                if (mOffspringHashKnown[i]) {
+                    mOffspringHashes[i] = GenomeHash::update(
+                        mHashes[parent], parent_genome, child, *touched);
+                }
+            }
+
+            if (packed) {
+                mPopulation.writeOffspring(i, child, parent);
+                // Packing rounded the genes the parent didn't pass on as
+                // they were, and all of a segment whose int8 range grew.
+                if (mParams.fitness_cache) {
+                    mOffspringHashes[i] = GenomeHash::of(child);
+                    mOffspringHashKnown[i] = 1;
+                }
+            }
+        }
+
+        /**
+         * Sketch every genome, sort the population into species and rank it
+         * by shared fitness, for reproduction to pick parents from.
+         */
+        void speciate() {
+            mScheduler.run(mPopulation.size(), 0,
+                [this](size_t begin, size_t end, size_t id) {
+                    for (size_t i = begin; i < end; i++) {
+                        mSpecies.sketch(i, mPopulation.readGenome(
+                                               i, mScratch[id].first));
+                    }
+                });
+            mSpecies.speciate(mPopulation.getFitnesses(), mScheduler);
+            mSharedElites.rank(mSpecies.getSharedFitness(), mGenerationErrors,
+                               getSelectionCount(), &mSharedRanking,
+                               &mScheduler);
+        }
+
+        /**
+         * Is this generation recorded?
+         * @return tracked
+         */
+        bool isTracked() const {
+            return mMetrics
+                && mCurrentGeneration
+                       % std::max<size_t>(mParams.tracking_stride, 1) == 0;
+        }
+
+        /**
+         * One generation, timing each phase and recording the metrics.
+         */
+        void trackedGeneration() {
+            typedef std::chrono::steady_clock clock;
+            typedef std::chrono::duration<double> seconds;
+
+            const clock::time_point start = clock::now();
+            sortPopulation();
+            const clock::time_point sorted = clock::now();
+
+            GenerationMetrics metrics;
+            const EliteRanking::Stats & stats = mElites.getStats();
+            metrics.generation = mCurrentGeneration;
+            metrics.bestFitness = stats.bestFitness;
+            metrics.meanFitness = stats.averageFitness;
+            metrics.lowestError = stats.lowestError;
+            metrics.meanError = stats.averageError;
+            metrics.mutationPower = mMutationPower;
+            metrics.mutationRate = mMutationRate;
+
+            // Successive selections on the same scratch copy, each in the
+            // part of the range left above the previous one.
+            const std::vector<float> & fitness = mPopulation.getFitnesses();
+            mMetricsFitness.assign(fitness.begin(), fitness.end());
+            const size_t last = mMetricsFitness.size() - 1;
+            auto p10 = mMetricsFitness.begin() + last / 10;
+            auto p50 = mMetricsFitness.begin() + last / 2;
+            auto p90 = mMetricsFitness.begin() + last * 9 / 10;
+            std::nth_element(mMetricsFitness.begin(), p10,
+                             mMetricsFitness.end());
+            std::nth_element(p10, p50, mMetricsFitness.end());
+            std::nth_element(p50, p90, mMetricsFitness.end());
+            metrics.p10Fitness = *p10;
+            metrics.medianFitness = *p50;
+            metrics.p90Fitness = *p90;
+
+            const clock::time_point measured = clock::now();
+            reproducePopulation();
+            const clock::time_point reproduced = clock::now();
+            metrics.speciesCount =
+                static_cast<uint32_t>(mSpecies.getSpeciesCount());
+            metrics.largestSpecies =
+                static_cast<uint32_t>(mSpecies.getLargestSpecies());
+            evaluatePopulation();
+            const clock::time_point evaluated = clock::now();
+
+            metrics.sortSeconds = seconds(sorted - start).count();
+            metrics.reproduceSeconds = seconds(reproduced - measured).count();
+            metrics.evalSeconds = seconds(evaluated - reproduced).count();
+            mMetrics->record(metrics);
+        }
+
+        /**
+         * Networks only take whole vectors: copy the batch out once when
+         * the batch evaluator can't be used.
+         */
+        void gatherForNetwork(const SampleView & mini_data,
+                              const SampleView & mini_labels,
+                              std::vector<vec_t> * data,
+                              std::vector<vec_t> * labels) const {
+            if (!mEvaluator.isSupported()) {
+                mini_data.gather(data);
+                mini_labels.gather(labels);
+            }
+        }
+
+        /**
+         * Error of individual i on the minibatch.
+         * @param i
+         * @param id which thread (and so network) to evaluate with.
+         * @param mini_data
+         * @param mini_labels
+         * @param data   gatherForNetwork() copy of mini_data.
+         * @param labels gatherForNetwork() copy of mini_labels.
+         * @return error
+         */
+        float_t errorOf(size_t i, size_t id, const SampleView & mini_data,
+                        const SampleView & mini_labels,
+                        const std::vector<vec_t> & data,
+                        const std::vector<vec_t> & labels) {
+            float_t error;
+            if (mParams.delta_evaluation
+                && mDelta.evaluate(i, mPopulation, mini_data, mini_labels,
+                                   mWorkspaces[id], &error)) {
+                // Scored from the parent's first layer.
+                return error;
+            }
+            // Packed genomes are widened once here, on their way into the
+            // evaluator or the network's weights.
+            GenomeView genome = mPopulation.readGenome(i, mScratch[id].first);
+            if (mEvaluator.isSupported()) {
+                return mEvaluator.evaluate(genome, mini_data, mini_labels,
+                                           mWorkspaces[id]);
+            }
+            loadWeights(genome, id);
+            return mReplicas.get(id)->template get_loss<Error>(data, labels);
+        }
+
+        /**
+         * Record individual i's error and fold it into its fitness.
+         * @param i
+         * @param error
+         * @param samples minibatch size.
+         */
+        void assignError(size_t i, float_t error, size_t samples) {
+            float previous_fitness = mPopulation.getFitness(i);
+            previous_fitness *= 1 - mParams.fitness_decay_rate;
+
+            mGenerationErrors[i] = error;
+
+            float fitness = samples - error;
+            fitness = (fitness < mParams.min_fitness) ? mParams.min_fitness
+                                                      : fitness;
+
+            mPopulation.setFitness(i, fitness + previous_fitness);
+        }
+
+        /**
+         * evaluatePopulation() through the fitness cache. Only the first
+         * individual carrying a given genome is run, the others take its
+         * error, and genomes already scored on this minibatch aren't run at
+         * all. Hashes come from the lineage where possible; crossover
+         * children and immigrants are hashed here.
+         * @param batch minibatch id.
+         * @param mini_data
+         * @param mini_labels
+         */
+        void evaluateCached(uint64_t batch, const SampleView & mini_data,
+                            const SampleView & mini_labels) {
+            const size_t size = mPopulation.size();
+            mScheduler.run(size, 0,
+                [this](size_t begin, size_t end, size_t id) {
+                for (size_t i = begin; i < end; i++) {
+                    if (!mHashKnown[i]) {
+                        mHashes[i] = GenomeHash::of(
+                            mPopulation.readGenome(i, mScratch[id].first));
+                        mHashKnown[i] = 1;
+                    }
+                }
+            });
+
+            mPending.clear();
+            mFirstOf.clear();
+            std::vector<float_t> & cached = mCachedErrors;
+            cached.resize(size);
+            for (size_t i = 0; i < size; i++) {
+                mSources[i] = i;
+                if (mCache.find(mHashes[i], batch, &cached[i])) {
+                    continue;
+                }
+                auto first = mFirstOf.emplace(mHashes[i], i);
+                if (first.second) {
+                    mPending.push_back(i);
+                }
+                else {
+                    mSources[i] = first.first->second;
+                }
+            }
+            mSkippedEvaluations += size - mPending.size();
+
+            mScheduler.run(mPending.size(), 0,
+                [&](size_t begin, size_t end, size_t id) {
+                    std::vector<vec_t> data;
+                    std::vector<vec_t> labels;
+                    gatherForNetwork(mini_data, mini_labels, &data, &labels);
+                    for (size_t k = begin; k < end; k++) {
+                        const size_t i = mPending[k];
+                        cached[i] = errorOf(i, id, mini_data, mini_labels,
+                                            data, labels);
+                    }
+                });
+
+            for (size_t i : mPending) {
+                mCache.insert(mHashes[i], batch, cached[i]);
+            }
+
+            mScheduler.run(size, 0, [&](size_t begin, size_t end, size_t) {
+                for (size_t i = begin; i < end; i++) {
+                    assignError(i, cached[mSources[i]], mini_data.size());
+                }
+            });
+        }
+
+        /**
+         * Identity ranking, population order.
+         */
+        void resetRanking() {
+            for (size_t i = 0; i < mRanking.size(); i++) {
+                mRanking[i] = i;
+            }
+        }
+
+        /**
+         * Randomize every genome in the arena, in parallel, and evaluate
+         * them. Genome i comes from its own stream, whatever the thread,
+         * and is drawn straight into its row unless the arena is
+         * compressed.
+         */
+        void initializePopulation() {
+            const GenomeInitializer initializer(mParams.weight_init,
+                                                mParams.initial_weights_delta,
+                                                *mReplicas.get(0));
+            const RngService init = mRng.split(RngService::initialization);
+            mScheduler.run(mPopulation.size(), 0,
+                           [&](size_t begin, size_t end, size_t id) {
+                vec_t & scratch = mScratch[id].child;
+                for (size_t i = begin; i < end; i++) {
+                    RandomStream stream = init.stream(i);
+                    if (!mPopulation.isCompressed()) {
+                        initializer.fill(mPopulation.getMutableGenome(i),
+                                         stream);
+                        continue;
+                    }
+                    scratch.resize(mWeightCount);
+                    initializer.fill(viewOf(scratch), stream);
+                    mPopulation.writeGenome(i, viewOf(scratch));
+                }
+            });
 
             evaluatePopulation();
         }
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "tiny_dnn/config.h"
+#include "tiny_dnn/evo/genome_view.h"
+
+namespace tiny_dnn {
+
+    /**
+     * Content hash of a genome: the sum, modulo 2^64, of a mixed hash of
+     * every (position, gene) pair. Being a sum, it is updated for a mutation
+     * from the touched genes alone instead of rehashing the whole genome.
+     */
+    class GenomeHash {
+    public:
+        /**
+         * Contribution of one gene.
+         * @param k     position.
+         * @param value
+         * @return hash
+         */
+        static uint64_t gene(size_t k, float_t value) {
+            uint64_t bits = 0;
+            std::memcpy(&bits, &value, sizeof(value));
+            return mix(bits ^ (uint64_t(k) * 0x9e3779b97f4a7c15ULL));
+        }
+
+        /**
+         * Hash a whole genome.
+         * @param genome
+         * @return hash
+         */
+        static uint64_t of(GenomeView genome) {
+            uint64_t hash = 0;
+            for (size_t k = 0; k < genome.size(); k++) {
+                hash += gene(k, genome[k]);
+            }
+            return hash;
+        }
+
+        /**
+         * Hash of child, given the hash of the parent it differs from in
+         * the touched genes only.
+         * @param hash    of parent.
+         * @param parent
+         * @param child
+         * @param touched distinct positions.
+         * @return hash
+         */
+        static uint64_t update(uint64_t hash, GenomeView parent,
+                               GenomeView child,
+                               const std::vector<uint32_t> & touched) {
+            for (uint32_t k : touched) {
+                hash += gene(k, child[k]) - gene(k, parent[k]);
+            }
+            return hash;
+        }
+
+        /**
+         * Identify a minibatch by the samples it holds.
+         * @param indices
+         * @return hash
+         */
+        static uint64_t ofBatch(const std::vector<uint32_t> & indices) {
+            uint64_t hash = indices.size();
+            for (uint32_t i : indices) {
+                hash = mix(hash ^ i);
+            }
+            return hash;
+        }
+
+    private:
+        static uint64_t mix(uint64_t z) {
+            z += 0x9e3779b97f4a7c15ULL;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+    };
+
+    /**
+     * Remembers the error of (genome hash, minibatch id) pairs.
+     *
+     * Direct mapped: each key has one slot, and a newer entry simply
+     * replaces whatever was there. Genomes are known by their 64-bit hash
+     * only, a collision returning the wrong error is taken as practically
+     * impossible.
+     *
+     * Not thread-safe; the Evolver looks up and inserts between parallel
+     * phases.
+     */
+    class FitnessCache {
+    public:
+        /**
+         * @param capacity entries, rounded up to a power of two.
+         */
+        explicit FitnessCache(size_t capacity) {
+            size_t slots = 1;
+            while (slots < capacity) {
+                slots <<= 1;
+            }
+            mSlots.resize(slots);
+            mMask = slots - 1;
+        }
+
+        /**
+         * @param genome hash.
+         * @param batch  minibatch id.
+         * @param error  out, set on a hit.
+         * @return hit
+         */
+        bool find(uint64_t genome, uint64_t batch, float_t * error) const {
+            const Slot & slot = mSlots[index(genome, batch)];
+            if (slot.used && slot.genome == genome && slot.batch == batch) {
+                *error = slot.error;
+                return true;
+            }
+            return false;
+        }
+
+        void insert(uint64_t genome, uint64_t batch, float_t error) {
+            Slot & slot = mSlots[index(genome, batch)];
+            slot.genome = genome;
+            slot.batch = batch;
+            slot.error = error;
+            slot.used = true;
+        }
+
+        void clear() {
+            for (Slot & slot : mSlots) {
+                slot.used = false;
+            }
+        }
+
+    private:
+        struct Slot {
+            uint64_t genome = 0;
+            uint64_t batch = 0;
+            float_t error = 0;
+            bool used = false;
+        };
+
+        std::vector<Slot> mSlots;
+        size_t mMask;
+
+        size_t index(uint64_t genome, uint64_t batch) const {
+            return static_cast<size_t>((genome ^ (batch * 0xff51afd7ed558ccdULL))
+                                       & mMask);
+        }
+    };
+}
@@ -0,0 +1,375 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+#include "tiny_dnn/config.h"
+#include "tiny_dnn/evo/genome_view.h"
+#include "tiny_dnn/util/nn_error.h"
+#include "tiny_dnn/util/util.h"
+#include "tiny_dnn/core/kernels/tiny_quantization_kernel.h"
+
+namespace tiny_dnn {
+
+    /**
+     * How a Population stores its genes.
+     */
+    enum class GenomePrecision {
+        full,  //< float_t, genomes are used in place.
+        fp16,  //< IEEE half precision.
+        bf16,  //< bfloat16, float's exponent with a 7 bit mantissa.
+        int8   //< 8 bit, linear over each segment's [min, max].
+    };
+
+    /**
+     * Packs genomes into reduced precision rows and widens them back.
+     *
+     * Encoding rounds, so encode() writes the rounded genes back into its
+     * input: afterwards the float genome is exactly what decode() returns,
+     * and anything computed from it (hashes, evaluations) matches the
+     * stored individual.
+     *
+     * int8 rows are quantized per segment, a segment being one weight
+     * vector of the network, with the kernels of tiny_quantization_kernel.h.
+     * Each segment keeps its own [min, max], so small bias vectors aren't
+     * crushed by the range of large weight matrices.
+     */
+    class GenomeCodec {
+    public:
+        /// How many times wider than a segment's genes an inherited int8
+        /// range may be before the segment is refit.
+        static constexpr float maxKeptSpread = 2;
+
+        GenomeCodec() : mPrecision(GenomePrecision::full) { }
+
+        /**
+         * @param precision
+         * @param segments lengths of the genome's segments, in order. Only
+         *                 int8 uses them; empty means one segment.
+         */
+        GenomeCodec(GenomePrecision precision, std::vector<size_t> segments)
+            : mPrecision(precision), mSegments(segments) { }
+
+        /**
+         * @param name float, fp16, bf16 or int8.
+         * @return precision
+         */
+        static GenomePrecision parse(const std::string & name) {
+            if (name == "float") return GenomePrecision::full;
+            if (name == "fp16") return GenomePrecision::fp16;
+            if (name == "bf16") return GenomePrecision::bf16;
+            if (name == "int8") return GenomePrecision::int8;
+            throw nn_error("Unknown genome precision: " + name);
+        }
+
+        GenomePrecision getPrecision() const { return mPrecision; }
+
+        bool isCompressed() const {
+            return mPrecision != GenomePrecision::full;
+        }
+
+        size_t getBytesPerGene() const {
+            switch (mPrecision) {
+                case GenomePrecision::fp16:
+                case GenomePrecision::bf16: return 2;
+                case GenomePrecision::int8: return 1;
+                default: return sizeof(float_t);
+            }
+        }
+
+        /**
+         * Floats of range data each row carries besides its genes.
+         * @return count
+         */
+        size_t getRangeCount() const {
+            if (mPrecision != GenomePrecision::int8) {
+                return 0;
+            }
+            return 2 * std::max<size_t>(mSegments.size(), 1);
+        }
+
+        /**
+         * Pack a genome, rounding it in place to the stored values.
+         * @param genome
+         * @param row    getBytesPerGene() bytes per gene.
+         * @param ranges getRangeCount() floats.
+         * @param keep   ranges of the row genome was bred from, or nullptr.
+         *               int8 segments stay on that grid, grown as far as
+         *               their genes need, so genes carried over unchanged
+         *               keep their exact values instead of drifting every
+         *               time the segment's extremes move. A segment whose
+         *               genes span less than 1 / maxKeptSpread of the kept
+         *               range is refit to them instead, so an outlier bred
+         *               out of a lineage doesn't coarsen its grid forever.
+         */
+        void encode(MutableGenomeView genome, uint8_t * row,
+                    float * ranges, const float * keep = nullptr) const {
+            switch (mPrecision) {
+                case GenomePrecision::fp16: {
+                    uint16_t * out = reinterpret_cast<uint16_t *>(row);
+                    for (size_t k = 0; k < genome.size(); k++) {
+                        out[k] = toHalf(static_cast<float>(genome[k]));
+                        genome[k] = fromHalf(out[k]);
+                    }
+                    break;
+                }
+                case GenomePrecision::bf16: {
+                    uint16_t * out = reinterpret_cast<uint16_t *>(row);
+                    for (size_t k = 0; k < genome.size(); k++) {
+                        out[k] = toBfloat(static_cast<float>(genome[k]));
+                        genome[k] = fromBfloat(out[k]);
+                    }
+                    break;
+                }
+                case GenomePrecision::int8:
+                    forEachSegment(genome.size(),
+                        [&](size_t begin, size_t end, size_t s) {
+                            encodeInt8(genome, begin, end,
+                                       reinterpret_cast<int8_t *>(row),
+                                       ranges + 2 * s,
+                                       keep ? keep + 2 * s : nullptr);
+                        });
+                    break;
+                default:
+                    std::memcpy(row, genome.data(),
+                                genome.size() * sizeof(float_t));
+            }
+        }
+
+        /**
+         * Pack a genome decoded before from ranges back onto those same
+         * ranges, so the row comes out exactly as it was stored.
+         * @param genome
+         * @param row
+         * @param ranges getRangeCount() floats, read only for int8.
+         */
+        void encodeOnto(MutableGenomeView genome, uint8_t * row,
+                        const float * ranges) const {
+            if (mPrecision != GenomePrecision::int8) {
+                encode(genome, row, nullptr);
+                return;
+            }
+            forEachSegment(genome.size(),
+                [&](size_t begin, size_t end, size_t s) {
+                    int8_t * out = reinterpret_cast<int8_t *>(row);
+                    const float min = ranges[2 * s];
+                    const float max = ranges[2 * s + 1];
+                    for (size_t k = begin; k < end; k++) {
+                        out[k] = quantizeInt8(genome[k], min, max);
+                        genome[k] = core::kernels::quantized_to_float<
+                            int8_t>(out[k], min, max);
+                    }
+                });
+        }
+
+        /**
+         * Widen a packed row.
+         * @param row
+         * @param ranges
+         * @param genome out.
+         */
+        void decode(const uint8_t * row, const float * ranges,
+                    MutableGenomeView genome) const {
+            switch (mPrecision) {
+                case GenomePrecision::fp16: {
+                    const uint16_t * in = reinterpret_cast<const uint16_t *>(row);
+                    for (size_t k = 0; k < genome.size(); k++) {
+                        genome[k] = fromHalf(in[k]);
+                    }
+                    break;
+                }
+                case GenomePrecision::bf16: {
+                    const uint16_t * in = reinterpret_cast<const uint16_t *>(row);
+                    for (size_t k = 0; k < genome.size(); k++) {
+                        genome[k] = fromBfloat(in[k]);
+                    }
+                    break;
+                }
+                case GenomePrecision::int8:
+                    forEachSegment(genome.size(),
+                        [&](size_t begin, size_t end, size_t s) {
+                            const int8_t * in =
+                                reinterpret_cast<const int8_t *>(row);
+                            const float min = ranges[2 * s];
+                            const float max = ranges[2 * s + 1];
+                            for (size_t k = begin; k < end; k++) {
+                                genome[k] = core::kernels::quantized_to_float<
+                                    int8_t>(in[k], min, max);
+                            }
+                        });
+                    break;
+                default:
+                    std::memcpy(genome.data(), row,
+                                genome.size() * sizeof(float_t));
+            }
+        }
+
+        /**
+         * IEEE half, rounded to nearest even. Overflow saturates to
+         * infinity, tiny values become subnormals or zero.
+         */
+        static uint16_t toHalf(float value) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            const uint32_t sign = (bits >> 16) & 0x8000;
+            const uint32_t magnitude = bits & 0x7fffffff;
+
+            if (magnitude >= 0x7f800000) {
+                // Infinity stays infinity, NaN stays a (quiet) NaN.
+                return static_cast<uint16_t>(
+                    sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0));
+            }
+            if (magnitude >= 0x477ff000) {
+                return static_cast<uint16_t>(sign | 0x7c00);
+            }
+            if (magnitude < 0x38800000) {
+                // Subnormal half: shift the full mantissa into place.
+                const uint32_t shift = 126 - (magnitude >> 23);
+                if (shift > 24) {
+                    return static_cast<uint16_t>(sign);
+                }
+                const uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+                uint32_t half = mantissa >> shift;
+                const uint32_t rest = mantissa & ((1u << shift) - 1);
+                const uint32_t halfway = 1u << (shift - 1);
+                if (rest > halfway || (rest == halfway && (half & 1))) {
+                    half++;
+                }
+                return static_cast<uint16_t>(sign | half);
+            }
+
+            uint32_t half = (magnitude - 0x38000000) >> 13;
+            const uint32_t rest = magnitude & 0x1fff;
+            if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+                half++;
+            }
+            return static_cast<uint16_t>(sign | half);
+        }
+
+        static float fromHalf(uint16_t half) {
+            const uint32_t sign = uint32_t(half & 0x8000) << 16;
+            const uint32_t exponent = (half >> 10) & 0x1f;
+            uint32_t mantissa = half & 0x3ff;
+            uint32_t bits;
+
+            if (exponent == 0x1f) {
+                bits = sign | 0x7f800000 | (mantissa << 13);
+            }
+            else if (exponent != 0) {
+                bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+            }
+            else if (mantissa == 0) {
+                bits = sign;
+            }
+            else {
+                // Subnormal half, normal float.
+                uint32_t e = 113;
+                while (!(mantissa & 0x400)) {
+                    mantissa <<= 1;
+                    e--;
+                }
+                bits = sign | (e << 23) | ((mantissa & 0x3ff) << 13);
+            }
+
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        /**
+         * bfloat16, rounded to nearest even.
+         */
+        static uint16_t toBfloat(float value) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            if ((bits & 0x7fffffff) > 0x7f800000) {
+                return static_cast<uint16_t>((bits >> 16) | 0x40);
+            }
+            bits += 0x7fff + ((bits >> 16) & 1);
+            return static_cast<uint16_t>(bits >> 16);
+        }
+
+        static float fromBfloat(uint16_t bfloat) {
+            const uint32_t bits = uint32_t(bfloat) << 16;
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+    private:
+        GenomePrecision mPrecision;
+        std::vector<size_t> mSegments;
+
+        template <typename F>
+        void forEachSegment(size_t length, F f) const {
+            if (mSegments.empty()) {
+                f(0, length, 0);
+                return;
+            }
+            size_t begin = 0;
+            for (size_t s = 0; s < mSegments.size(); s++) {
+                f(begin, std::min(begin + mSegments[s], length), s);
+                begin += mSegments[s];
+            }
+        }
+
+        static void encodeInt8(MutableGenomeView genome, size_t begin,
+                               size_t end, int8_t * out, float * range,
+                               const float * keep) {
+            float min = 0;
+            float max = 0;
+            if (begin < end) {
+                auto extremes = std::minmax_element(genome.begin() + begin,
+                                                    genome.begin() + end);
+                min = static_cast<float>(*extremes.first);
+                max = static_cast<float>(*extremes.second);
+            }
+            if (keep != nullptr
+                && keep[1] - keep[0] <= maxKeptSpread * (max - min)) {
+                // Grow the kept range only as far as the genes need.
+                min = std::min(min, keep[0]);
+                max = std::max(max, keep[1]);
+            }
+            range[0] = min;
+            range[1] = max;
+
+            for (size_t k = begin; k < end; k++) {
+                out[k] = quantizeInt8(genome[k], min, max);
+                genome[k] = core::kernels::quantized_to_float<int8_t>(
+                    out[k], min, max);
+            }
+        }
+
+        /**
+         * Nearest code to value. A value decoded from [min, max] before gets
+         * its own code back, even where the kernel's rounding of the offset
+         * would land on a neighbour.
+         */
+        static int8_t quantizeInt8(float_t value, float min, float max) {
+            using core::kernels::quantized_to_float;
+            int8_t code = core::kernels::float_to_quantized<int8_t>(
+                value, min, max);
+            float_t error = std::abs(
+                quantized_to_float<int8_t>(code, min, max) - value);
+            for (int step : {-1, 1}) {
+                const int neighbour = int(code) + step;
+                if (error == 0 || neighbour < INT8_MIN
+                    || neighbour > INT8_MAX) {
+                    continue;
+                }
+                const float_t e = std::abs(quantized_to_float<int8_t>(
+                    int8_t(neighbour), min, max) - value);
+                if (e < error) {
+                    code = int8_t(neighbour);
+                    error = e;
+                }
+            }
+            return code;
+        }
+    };
+}
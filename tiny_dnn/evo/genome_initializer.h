@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "tiny_dnn/evo/genome_view.h"
+#include "tiny_dnn/evo/random_stream.h"
+#include "tiny_dnn/network.h"
+#include "tiny_dnn/util/nn_error.h"
+
+namespace tiny_dnn {
+
+    /**
+     * Draws initial genomes, one weight vector at a time.
+     *
+     * uniform fills every gene from [-delta, delta]. xavier, lecun and he
+     * follow the weight_init functions of the same name, at their default
+     * scales, with each layer's own fan-in and fan-out; biases start at 0,
+     * as with the layers' default weight_init::constant.
+     *
+     * weight_init's functions draw from the global generator. These draw
+     * from a RandomStream, so genomes can be built on any thread straight
+     * into their storage.
+     */
+    class GenomeInitializer {
+    public:
+        /**
+         * @param scheme uniform, xavier, lecun or he.
+         * @param delta  half-width of uniform.
+         * @param net    network the genomes are for.
+         */
+        GenomeInitializer(const std::string & scheme, float delta,
+                          network<sequential> & net) {
+            if (!isKnown(scheme)) {
+                throw nn_error("Unknown weight init: " + scheme);
+            }
+
+            for (auto layer : net) {
+                // weights() lists the trainable inputs in channel order.
+                const std::vector<vector_type> types = layer->in_types();
+                const std::vector<vec_t *> weights = layer->weights();
+                size_t k = 0;
+                for (size_t i = 0; i < types.size(); i++) {
+                    if (!is_trainable_weight(types[i])) {
+                        continue;
+                    }
+
+                    Segment segment;
+                    segment.size = weights[k++]->size();
+                    segment.normal = false;
+
+                    const float_t fan_in = float_t(layer->fan_in_size(i));
+                    const float_t fan_out = float_t(layer->fan_out_size(i));
+                    if (scheme == "uniform") {
+                        segment.scale = delta;
+                    }
+                    else if (types[i] == vector_type::bias) {
+                        segment.scale = 0;
+                    }
+                    else if (scheme == "xavier") {
+                        segment.scale = std::sqrt(float_t(6)
+                                                  / (fan_in + fan_out));
+                    }
+                    else if (scheme == "lecun") {
+                        segment.scale = float_t(1) / std::sqrt(fan_in);
+                    }
+                    else {
+                        segment.normal = true;
+                        segment.scale = std::sqrt(float_t(2) / fan_in);
+                    }
+                    mSegments.push_back(segment);
+                }
+            }
+        }
+
+        static bool isKnown(const std::string & scheme) {
+            return scheme == "uniform" || scheme == "xavier"
+                || scheme == "lecun" || scheme == "he";
+        }
+
+        /**
+         * Draw a genome.
+         * @param genome out, of the network's weight count.
+         * @param stream
+         */
+        void fill(MutableGenomeView genome, RandomStream & stream) const {
+            float_t * dst = genome.data();
+            for (const Segment & segment : mSegments) {
+                MutableGenomeView part(dst, segment.size);
+                if (segment.scale == 0) {
+                    std::fill(part.begin(), part.end(), float_t(0));
+                }
+                else if (segment.normal) {
+                    stream.fillNormal(part, 0, segment.scale);
+                }
+                else {
+                    stream.fillUniform(part, -segment.scale, segment.scale);
+                }
+                dst += segment.size;
+            }
+        }
+
+    private:
+        /// One weight vector: uniform from [-scale, scale], or normal with
+        /// standard deviation scale.
+        struct Segment {
+            size_t size;
+            bool normal;
+            float_t scale;
+        };
+
+        std::vector<Segment> mSegments;
+    };
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include "tiny_dnn/config.h"
+
+namespace tiny_dnn {
+
+    /**
+     * Non-owning view over a contiguous run of genes.
+     * Views are cheap to pass by value and are only valid for as long as the
+     * storage they point into is alive and not resized.
+     */
+    template <typename T>
+    struct GenomeSpan {
+        GenomeSpan() : mData(nullptr), mSize(0) { }
+        GenomeSpan(T * data, size_t size) : mData(data), mSize(size) { }
+
+        /**
+         * Allow a mutable view to be used wherever a read-only one is needed.
+         */
+        template <typename U>
+        GenomeSpan(const GenomeSpan<U> & other)
+            : mData(other.data()), mSize(other.size()) { }
+
+        T * data() const { return mData; }
+        size_t size() const { return mSize; }
+        bool empty() const { return mSize == 0; }
+
+        T * begin() const { return mData; }
+        T * end() const { return mData + mSize; }
+
+        T & operator[](size_t i) const { return mData[i]; }
+
+        /**
+         * Sub-view of count genes starting at offset.
+         * @param offset
+         * @param count
+         * @return view
+         */
+        GenomeSpan<T> slice(size_t offset, size_t count) const {
+            return GenomeSpan<T>(mData + offset, count);
+        }
+
+    private:
+        T * mData;
+        size_t mSize;
+    };
+
+    typedef GenomeSpan<const float_t> GenomeView;
+    typedef GenomeSpan<float_t> MutableGenomeView;
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "tiny_dnn/evo/evolver.h"
+#include "tiny_dnn/evo/migration.h"
+#include "tiny_dnn/evo/params.h"
+#include "tiny_dnn/evo/random.h"
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace tiny_dnn {
+
+    /**
+     * Island model LEEA.
+     *
+     * Several independent Evolvers, one per island, run side by side. Every
+     * migration_interval generations an island sends copies of its
+     * migrants best individuals to its neighbours and replaces its least fit
+     * individuals with whatever has arrived for it. Sending and receiving
+     * never block, so islands drift apart in generation count rather than
+     * waiting for each other.
+     *
+     * Islands run as threads over a LocalTransport, or as forked processes
+     * over a SharedMemoryTransport. Any other MigrationTransport may be used
+     * with runThreads().
+     */
+    template <typename Error, size_t N = 1>
+    class IslandModel {
+    public:
+        /// factory(island, random) builds the island's Evolver. Calls are
+        /// serialized.
+        typedef std::function<std::unique_ptr<Evolver<Error, N>>(size_t,
+                                                                 Random *)>
+            factory_t;
+
+        /**
+         * @param params islands, migration_interval, migrants and topology
+         *               are used here, the rest is up to the factory.
+         * @param seed   island i's Random is seeded with seed + i.
+         * @param factory
+         */
+        IslandModel(const EvoParams & params, int seed, factory_t factory)
+            : mParams(params), mSeed(seed), mFactory(factory) {
+            mParams.validate();
+        }
+
+        /**
+         * Neighbours an island sends its migrants to.
+         * @param topology ring or full.
+         * @param islands
+         * @param island
+         * @return destinations
+         */
+        static std::vector<size_t> neighbours(const std::string & topology,
+                                              size_t islands, size_t island) {
+            std::vector<size_t> destinations;
+            if (islands < 2) {
+                return destinations;
+            }
+            if (topology == "ring") {
+                destinations.push_back((island + 1) % islands);
+            }
+            else if (topology == "full") {
+                for (size_t other = 0; other < islands; other++) {
+                    if (other != island) {
+                        destinations.push_back(other);
+                    }
+                }
+            }
+            else {
+                throw nn_error("Unknown island topology: " + topology);
+            }
+            return destinations;
+        }
+
+        /**
+         * Run every island on its own thread until max_generations.
+         * @param transport shared by the islands.
+         * @return each island's champion, by island.
+         */
+        std::vector<Migrant> runThreads(MigrationTransport & transport) {
+            const size_t islands = mParams.islands;
+            std::vector<std::thread> threads;
+            std::exception_ptr error;
+            std::mutex error_mutex;
+
+            for (size_t i = 0; i < islands; i++) {
+                threads.emplace_back([&, i] {
+                    try {
+                        runIsland(i, transport);
+                    }
+                    catch (...) {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        if (!error) {
+                            error = std::current_exception();
+                        }
+                    }
+                });
+            }
+            for (auto & thread : threads) {
+                thread.join();
+            }
+            if (error) {
+                std::rethrow_exception(error);
+            }
+
+            return collect(transport);
+        }
+
+        /**
+         * Run on threads over an in-process transport.
+         * @return each island's champion, by island.
+         */
+        std::vector<Migrant> runThreads() {
+            LocalTransport transport(mParams.islands);
+            return runThreads(transport);
+        }
+
+#ifndef _WIN32
+        /**
+         * Run every island in a process of its own, forked from this one.
+         * Call from a single threaded process: only the calling thread
+         * survives a fork.
+         * @param genome_length weights per network.
+         * @return each island's champion, by island.
+         */
+        std::vector<Migrant> runProcesses(size_t genome_length) {
+            const size_t islands = mParams.islands;
+            SharedMemoryTransport transport(islands, genome_length,
+                                            std::max<size_t>(mParams.migrants, 1));
+
+            std::vector<pid_t> children;
+            for (size_t i = 0; i < islands; i++) {
+                pid_t pid = fork();
+                if (pid < 0) {
+                    break;
+                }
+                if (pid == 0) {
+                    int status = 0;
+                    try {
+                        runIsland(i, transport);
+                    }
+                    catch (const std::exception & e) {
+                        std::cerr << "Island " << i << ": " << e.what()
+                                  << std::endl;
+                        status = 1;
+                    }
+                    _exit(status);
+                }
+                children.push_back(pid);
+            }
+
+            bool failed = children.size() != islands;
+            for (pid_t pid : children) {
+                int status = 0;
+                if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status)
+                    || WEXITSTATUS(status) != 0) {
+                    failed = true;
+                }
+            }
+            if (failed) {
+                throw nn_error("An island process failed");
+            }
+
+            return collect(transport);
+        }
+#endif
+
+    private:
+        EvoParams mParams;
+        int mSeed;
+        factory_t mFactory;
+        std::mutex mFactoryMutex;
+
+        /**
+         * Evolve one island to the end, migrating as it goes, then report
+         * its champion.
+         */
+        void runIsland(size_t island, MigrationTransport & transport) {
+            Random random(mSeed + static_cast<int>(island));
+            std::unique_ptr<Evolver<Error, N>> evolver;
+            {
+                // Building networks draws from the global generator.
+                std::lock_guard<std::mutex> lock(mFactoryMutex);
+                evolver = mFactory(island, &random);
+            }
+
+            const std::vector<size_t> destinations =
+                neighbours(mParams.topology, mParams.islands, island);
+
+            while (!evolver->isFinished()) {
+                evolver->evolve(mParams.migration_interval);
+                if (evolver->isFinished() || destinations.empty()) {
+                    continue;
+                }
+
+                evolver->immigrate(transport.receive(island));
+
+                std::vector<Migrant> elites =
+                    evolver->getElites(mParams.migrants);
+                for (Migrant & elite : elites) {
+                    elite.source = island;
+                }
+                for (size_t destination : destinations) {
+                    transport.send(island, destination, elites);
+                }
+            }
+
+            std::vector<Migrant> champion = evolver->getElites(1);
+            champion[0].source = island;
+            transport.report(island, champion[0]);
+        }
+
+        std::vector<Migrant> collect(MigrationTransport & transport) {
+            std::vector<Migrant> champions;
+            for (size_t i = 0; i < mParams.islands; i++) {
+                std::vector<Migrant> result = transport.getResult(i);
+                if (result.empty()) {
+                    throw nn_error("An island didn't report");
+                }
+                champions.push_back(result[0]);
+            }
+            return champions;
+        }
+    };
+}
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "tiny_dnn/config.h"
+#include "tiny_dnn/util/nn_error.h"
+
+namespace tiny_dnn {
+
+    /**
+     * What the Evolver records about one generation.
+     * Fitness and error describe the population at the start of the
+     * generation, timings the work done from there to the next one.
+     */
+    struct GenerationMetrics {
+        uint64_t generation;
+
+        float bestFitness;
+        double meanFitness;
+        float p10Fitness; //< 10th percentile.
+        float medianFitness;
+        float p90Fitness; //< 90th percentile.
+
+        float_t lowestError;
+        double meanError;
+
+        float mutationPower;
+        float mutationRate;
+
+        double sortSeconds;
+        double reproduceSeconds;
+        double evalSeconds;
+
+        uint32_t speciesCount; //< 0 without speciation.
+        uint32_t largestSpecies; //< Members of the largest species.
+    };
+
+    /**
+     * Receives the Evolver's per-generation metrics.
+     * record() is called from the generation loop and should return
+     * quickly; wrap slow sinks in an AsyncMetricsSink.
+     */
+    class MetricsSink {
+    public:
+        virtual ~MetricsSink() { }
+
+        virtual void record(const GenerationMetrics & metrics) = 0;
+
+        /// Push out anything buffered.
+        virtual void flush() { }
+    };
+
+    /**
+     * Human readable lines, in the style printInfo() used.
+     */
+    class ConsoleMetricsSink : public MetricsSink {
+    public:
+        explicit ConsoleMetricsSink(std::ostream & os = std::cout) : mOs(os) { }
+
+        void record(const GenerationMetrics & m) override {
+            mOs << "Generation " << m.generation
+                << ": best fitness " << m.bestFitness
+                << ", average fitness " << m.meanFitness
+                << ", lowest error " << m.lowestError
+                << ", average error " << m.meanError << '\n'
+                << "    eval " << m.evalSeconds
+                << "s, sort " << m.sortSeconds
+                << "s, reproduce " << m.reproduceSeconds << "s\n";
+            if (m.speciesCount != 0) {
+                mOs << "    " << m.speciesCount << " species, largest "
+                    << m.largestSpecies << '\n';
+            }
+            mOs.flush();
+        }
+
+    private:
+        std::ostream & mOs;
+    };
+
+    /**
+     * One comma separated row per generation, after a header row.
+     */
+    class CsvMetricsSink : public MetricsSink {
+    public:
+        explicit CsvMetricsSink(std::ostream & os) : mOs(&os) { writeHeader(); }
+
+        explicit CsvMetricsSink(const std::string & path)
+            : mFile(new std::ofstream(path.c_str())), mOs(mFile.get()) {
+            if (!*mFile) {
+                throw nn_error("Can't open metrics file: " + path);
+            }
+            writeHeader();
+        }
+
+        void record(const GenerationMetrics & m) override {
+            *mOs << m.generation << ',' << m.bestFitness << ','
+                 << m.meanFitness << ',' << m.p10Fitness << ','
+                 << m.medianFitness << ',' << m.p90Fitness << ','
+                 << m.lowestError << ',' << m.meanError << ','
+                 << m.mutationPower << ',' << m.mutationRate << ','
+                 << m.sortSeconds << ',' << m.reproduceSeconds << ','
+                 << m.evalSeconds << ',' << m.speciesCount << ','
+                 << m.largestSpecies << '\n';
+        }
+
+        void flush() override { mOs->flush(); }
+
+    private:
+        std::unique_ptr<std::ofstream> mFile;
+        std::ostream * mOs;
+
+        void writeHeader() {
+            *mOs << "generation,best_fitness,mean_fitness,p10_fitness,"
+                    "median_fitness,p90_fitness,lowest_error,mean_error,"
+                    "mutation_power,mutation_rate,sort_seconds,"
+                    "reproduce_seconds,eval_seconds,species_count,"
+                    "largest_species\n";
+        }
+    };
+
+    /**
+     * One JSON object per line and generation.
+     */
+    class JsonLinesMetricsSink : public MetricsSink {
+    public:
+        explicit JsonLinesMetricsSink(std::ostream & os) : mOs(&os) { }
+
+        explicit JsonLinesMetricsSink(const std::string & path)
+            : mFile(new std::ofstream(path.c_str())), mOs(mFile.get()) {
+            if (!*mFile) {
+                throw nn_error("Can't open metrics file: " + path);
+            }
+        }
+
+        void record(const GenerationMetrics & m) override {
+            *mOs << "{\"generation\":" << m.generation
+                 << ",\"best_fitness\":" << m.bestFitness
+                 << ",\"mean_fitness\":" << m.meanFitness
+                 << ",\"p10_fitness\":" << m.p10Fitness
+                 << ",\"median_fitness\":" << m.medianFitness
+                 << ",\"p90_fitness\":" << m.p90Fitness
+                 << ",\"lowest_error\":" << m.lowestError
+                 << ",\"mean_error\":" << m.meanError
+                 << ",\"mutation_power\":" << m.mutationPower
+                 << ",\"mutation_rate\":" << m.mutationRate
+                 << ",\"sort_seconds\":" << m.sortSeconds
+                 << ",\"reproduce_seconds\":" << m.reproduceSeconds
+                 << ",\"eval_seconds\":" << m.evalSeconds
+                 << ",\"species_count\":" << m.speciesCount
+                 << ",\"largest_species\":" << m.largestSpecies << "}\n";
+        }
+
+        void flush() override { mOs->flush(); }
+
+    private:
+        std::unique_ptr<std::ofstream> mFile;
+        std::ostream * mOs;
+    };
+
+    /**
+     * Keeps the last capacity records in memory, as raw structs. Nothing
+     * is formatted or written unless asked, so it's cheap enough to leave
+     * on for every generation.
+     */
+    class RingBufferMetricsSink : public MetricsSink {
+    public:
+        explicit RingBufferMetricsSink(size_t capacity)
+            : mRecords(std::max<size_t>(capacity, 1)) { }
+
+        void record(const GenerationMetrics & metrics) override {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mRecords[mCount % mRecords.size()] = metrics;
+            mCount++;
+        }
+
+        /**
+         * Records still held, oldest first.
+         * @return records
+         */
+        std::vector<GenerationMetrics> getRecords() const {
+            std::lock_guard<std::mutex> lock(mMutex);
+            std::vector<GenerationMetrics> records;
+            const size_t held = std::min(mCount, mRecords.size());
+            for (size_t k = mCount - held; k < mCount; k++) {
+                records.push_back(mRecords[k % mRecords.size()]);
+            }
+            return records;
+        }
+
+        /**
+         * Write the records held, oldest first, as raw GenerationMetrics.
+         * @param os binary stream.
+         */
+        void dump(std::ostream & os) const {
+            for (const GenerationMetrics & metrics : getRecords()) {
+                os.write(reinterpret_cast<const char *>(&metrics),
+                         sizeof(metrics));
+            }
+        }
+
+        /// Records ever received, including those overwritten since.
+        size_t getCount() const {
+            std::lock_guard<std::mutex> lock(mMutex);
+            return mCount;
+        }
+
+    private:
+        mutable std::mutex mMutex;
+        std::vector<GenerationMetrics> mRecords;
+        size_t mCount = 0;
+    };
+
+    /**
+     * Forwards every record to several sinks, in the order they were added.
+     */
+    class MultiMetricsSink : public MetricsSink {
+    public:
+        void add(std::shared_ptr<MetricsSink> sink) { mSinks.push_back(sink); }
+
+        void record(const GenerationMetrics & metrics) override {
+            for (auto & sink : mSinks) {
+                sink->record(metrics);
+            }
+        }
+
+        void flush() override {
+            for (auto & sink : mSinks) {
+                sink->flush();
+            }
+        }
+
+    private:
+        std::vector<std::shared_ptr<MetricsSink>> mSinks;
+    };
+
+    /**
+     * Forwards records to another sink from a background thread, so the
+     * generation loop never waits on formatting or I/O.
+     */
+    class AsyncMetricsSink : public MetricsSink {
+    public:
+        explicit AsyncMetricsSink(std::shared_ptr<MetricsSink> sink)
+            : mSink(sink), mThread([this] { writerLoop(); }) { }
+
+        ~AsyncMetricsSink() {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mStop = true;
+            }
+            mWake.notify_one();
+            mThread.join();
+        }
+
+        AsyncMetricsSink(const AsyncMetricsSink &) = delete;
+        AsyncMetricsSink & operator=(const AsyncMetricsSink &) = delete;
+
+        void record(const GenerationMetrics & metrics) override {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mPending.push_back(metrics);
+            }
+            mWake.notify_one();
+        }
+
+        /**
+         * Wait until everything recorded so far reached the wrapped sink,
+         * then flush it.
+         */
+        void flush() override {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mIdle.wait(lock, [this] { return mPending.empty() && !mWriting; });
+            mSink->flush();
+        }
+
+    private:
+        std::shared_ptr<MetricsSink> mSink;
+        std::mutex mMutex;
+        std::condition_variable mWake;
+        std::condition_variable mIdle;
+        std::vector<GenerationMetrics> mPending;
+        bool mWriting = false;
+        bool mStop = false;
+        std::thread mThread;
+
+        void writerLoop() {
+            std::vector<GenerationMetrics> batch;
+            std::unique_lock<std::mutex> lock(mMutex);
+            for (;;) {
+                mWake.wait(lock, [this] { return mStop || !mPending.empty(); });
+                if (mPending.empty() && mStop) {
+                    break;
+                }
+
+                batch.swap(mPending);
+                mWriting = true;
+                lock.unlock();
+                for (const GenerationMetrics & metrics : batch) {
+                    mSink->record(metrics);
+                }
+                batch.clear();
+                lock.lock();
+                mWriting = false;
+                mIdle.notify_all();
+            }
+            mSink->flush();
+        }
+    };
+}
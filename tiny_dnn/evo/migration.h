@@ -0,0 +1,263 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "tiny_dnn/config.h"
+#include "tiny_dnn/util/nn_error.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sys/mman.h>
+#endif
+
+namespace tiny_dnn {
+
+    /**
+     * A genome travelling between islands.
+     */
+    struct Migrant {
+        std::vector<float_t> genome;
+        float fitness;
+        size_t source; //< Island it left from.
+    };
+
+    /**
+     * Carries migrants between islands.
+     *
+     * Every (source, destination) pair has its own mailbox holding the
+     * latest message only: a send overwrites whatever the destination
+     * hasn't picked up yet, and receive() takes what is there without
+     * waiting. Islands never wait on each other.
+     *
+     * The (i, i) mailbox is never used for migration; it carries island
+     * i's final result back to whoever runs the islands.
+     */
+    class MigrationTransport {
+    public:
+        virtual ~MigrationTransport() { }
+
+        virtual size_t getIslandCount() const = 0;
+
+        /**
+         * Post migrants, replacing any not yet received.
+         * @param from
+         * @param to
+         * @param migrants
+         */
+        virtual void send(size_t from, size_t to,
+                          const std::vector<Migrant> & migrants) = 0;
+
+        /**
+         * Take everything that has arrived for an island.
+         * @param to
+         * @return migrants, possibly none.
+         */
+        virtual std::vector<Migrant> receive(size_t to) = 0;
+
+        /**
+         * Publish an island's result.
+         * @param island
+         * @param champion
+         */
+        void report(size_t island, const Migrant & champion) {
+            send(island, island, std::vector<Migrant>(1, champion));
+        }
+
+        /**
+         * Result published by an island.
+         * @param island
+         * @return champions, empty if the island hasn't reported.
+         */
+        virtual std::vector<Migrant> getResult(size_t island) = 0;
+    };
+
+    /**
+     * Transport between islands living in the same process.
+     */
+    class LocalTransport : public MigrationTransport {
+    public:
+        explicit LocalTransport(size_t islands)
+            : mIslands(islands), mMailboxes(islands * islands),
+              mMutexes(islands) { }
+
+        size_t getIslandCount() const override { return mIslands; }
+
+        void send(size_t from, size_t to,
+                  const std::vector<Migrant> & migrants) override {
+            std::lock_guard<std::mutex> lock(mMutexes[to]);
+            auto & mailbox = mMailboxes[to * mIslands + from];
+            mailbox = migrants;
+            for (Migrant & migrant : mailbox) {
+                migrant.source = from;
+            }
+        }
+
+        std::vector<Migrant> receive(size_t to) override {
+            std::vector<Migrant> arrived;
+            std::lock_guard<std::mutex> lock(mMutexes[to]);
+            for (size_t from = 0; from < mIslands; from++) {
+                if (from == to) {
+                    continue;
+                }
+                auto & mailbox = mMailboxes[to * mIslands + from];
+                std::move(mailbox.begin(), mailbox.end(),
+                          std::back_inserter(arrived));
+                mailbox.clear();
+            }
+            return arrived;
+        }
+
+        std::vector<Migrant> getResult(size_t island) override {
+            std::lock_guard<std::mutex> lock(mMutexes[island]);
+            return mMailboxes[island * mIslands + island];
+        }
+
+    private:
+        size_t mIslands;
+        std::vector<std::vector<Migrant>> mMailboxes;
+        std::vector<std::mutex> mMutexes;
+    };
+
+#ifndef _WIN32
+    /**
+     * Transport between islands running as processes forked from the one
+     * that created it. Mailboxes live in an anonymous shared mapping, each
+     * guarded by a process-shared mutex, so a message costs one copy in and
+     * one copy out.
+     */
+    class SharedMemoryTransport : public MigrationTransport {
+    public:
+        /**
+         * Map the mailboxes. Must happen before forking.
+         * @param islands
+         * @param genome_length genes per migrant.
+         * @param capacity      most migrants per message.
+         */
+        SharedMemoryTransport(size_t islands, size_t genome_length,
+                              size_t capacity)
+            : mIslands(islands), mLength(genome_length),
+              mCapacity(std::max<size_t>(capacity, 1)) {
+            const size_t line = 64;
+            mStride = sizeof(Header) + mCapacity * sizeof(float_t)
+                    + mCapacity * mLength * sizeof(float_t);
+            mStride = (mStride + line - 1) / line * line;
+            mBytes = mStride * mIslands * mIslands;
+
+            void * memory = mmap(nullptr, mBytes, PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                throw nn_error("Can't map migration mailboxes");
+            }
+            mMemory = static_cast<char *>(memory);
+
+            pthread_mutexattr_t attributes;
+            pthread_mutexattr_init(&attributes);
+            pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+            for (size_t m = 0; m < mIslands * mIslands; m++) {
+                Header * header = mailbox(m);
+                pthread_mutex_init(&header->mutex, &attributes);
+                header->count = 0;
+            }
+            pthread_mutexattr_destroy(&attributes);
+        }
+
+        ~SharedMemoryTransport() {
+            for (size_t m = 0; m < mIslands * mIslands; m++) {
+                pthread_mutex_destroy(&mailbox(m)->mutex);
+            }
+            munmap(mMemory, mBytes);
+        }
+
+        SharedMemoryTransport(const SharedMemoryTransport &) = delete;
+        SharedMemoryTransport & operator=(const SharedMemoryTransport &) = delete;
+
+        size_t getIslandCount() const override { return mIslands; }
+
+        void send(size_t from, size_t to,
+                  const std::vector<Migrant> & migrants) override {
+            Header * header = mailbox(to * mIslands + from);
+            const size_t count = std::min(migrants.size(), mCapacity);
+
+            for (size_t k = 0; k < count; k++) {
+                if (migrants[k].genome.size() != mLength) {
+                    throw nn_error("Migrant genome length mismatch");
+                }
+            }
+
+            pthread_mutex_lock(&header->mutex);
+            for (size_t k = 0; k < count; k++) {
+                fitness(header)[k] = migrants[k].fitness;
+                std::memcpy(genes(header) + k * mLength,
+                            migrants[k].genome.data(),
+                            mLength * sizeof(float_t));
+            }
+            header->count = count;
+            pthread_mutex_unlock(&header->mutex);
+        }
+
+        std::vector<Migrant> receive(size_t to) override {
+            std::vector<Migrant> arrived;
+            for (size_t from = 0; from < mIslands; from++) {
+                if (from != to) {
+                    take(to * mIslands + from, from, true, &arrived);
+                }
+            }
+            return arrived;
+        }
+
+        std::vector<Migrant> getResult(size_t island) override {
+            std::vector<Migrant> result;
+            take(island * mIslands + island, island, false, &result);
+            return result;
+        }
+
+    private:
+        struct Header {
+            pthread_mutex_t mutex;
+            size_t count;
+        };
+
+        size_t mIslands;
+        size_t mLength;
+        size_t mCapacity;
+        size_t mStride;
+        size_t mBytes;
+        char * mMemory;
+
+        Header * mailbox(size_t m) const {
+            return reinterpret_cast<Header *>(mMemory + m * mStride);
+        }
+
+        float_t * fitness(Header * header) const {
+            return reinterpret_cast<float_t *>(header + 1);
+        }
+
+        float_t * genes(Header * header) const {
+            return reinterpret_cast<float_t *>(fitness(header) + mCapacity);
+        }
+
+        void take(size_t m, size_t from, bool clear,
+                  std::vector<Migrant> * out) {
+            Header * header = mailbox(m);
+            pthread_mutex_lock(&header->mutex);
+            for (size_t k = 0; k < header->count; k++) {
+                const float_t * src = genes(header) + k * mLength;
+                Migrant migrant;
+                migrant.genome.assign(src, src + mLength);
+                migrant.fitness = fitness(header)[k];
+                migrant.source = from;
+                out->push_back(std::move(migrant));
+            }
+            if (clear) {
+                header->count = 0;
+            }
+            pthread_mutex_unlock(&header->mutex);
+        }
+    };
+#endif
+}
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "tiny_dnn/evo/params.h"
+#include "tiny_dnn/evo/random_stream.h"
+#include "tiny_dnn/evo/sample_view.h"
+#include "tiny_dnn/util/nn_error.h"
+#include "tiny_dnn/util/util.h"
+
+namespace tiny_dnn {
+
+    /**
+     * Takes care of dispatching minibatches.
+     *
+     * A minibatch is a list of indices into the training set, read through
+     * SampleViews, so no sample is copied. Each epoch visits the training
+     * set in one of three orders:
+     *  - sequential: as stored.
+     *  - shuffle:    a fresh permutation every epoch.
+     *  - stratified: a fresh permutation every epoch, with the classes of
+     *                the one-hot labels spread evenly over it, so that any
+     *                run of consecutive samples holds each class about in
+     *                proportion to its frequency.
+     * Permutations are drawn from RandomStream(seed, epoch), so the batches
+     * only depend on the seed and the position in the data.
+     *
+     * Batches are drawn inline, a lookup per sample. With prefetching on,
+     * the one costly step, building the permutation of a shuffled or
+     * stratified epoch, runs on a background thread once the batch after
+     * the current one is about to cross into the next epoch.
+     */
+    class MiniBatchHandler {
+    public:
+        /**
+         * @param labels training labels.
+         * @param data training data.
+         * @param sample_count samples per batch.
+         * @param order sequential, shuffle or stratified.
+         * @param prefetch build the next epoch's order in the background.
+         */
+        MiniBatchHandler(std::shared_ptr<std::vector<vec_t>> labels,
+                         std::shared_ptr<std::vector<vec_t>> data,
+                         size_t sample_count = Params::sample_count,
+                         const std::string & order = "sequential",
+                         bool prefetch = false)
+            : mSampleCount(sample_count), mTrainLabels(labels),
+              mTrainData(data), mPrefetch(prefetch) {
+            if (order == "sequential") mOrder = SEQUENTIAL;
+            else if (order == "shuffle") mOrder = SHUFFLE;
+            else if (order == "stratified") mOrder = STRATIFIED;
+            else throw nn_error("Unknown batch order: " + order);
+        }
+
+        /**
+         * A copy starts from the same position, without the order being
+         * built: it draws the same batches as the original would.
+         */
+        MiniBatchHandler(const MiniBatchHandler & other)
+            : mSampleCount(other.mSampleCount), mOrder(other.mOrder),
+              mSeed(other.mSeed), mTrainLabels(other.mTrainLabels),
+              mTrainData(other.mTrainData), mPrefetch(other.mPrefetch),
+              mIndex(other.mIndex), mEpoch(other.mEpoch) { }
+
+        MiniBatchHandler & operator=(const MiniBatchHandler &) = delete;
+
+        ~MiniBatchHandler() { wait(); }
+
+        /**
+         * Seed the shuffled orders.
+         * @param seed
+         */
+        void setSeed(uint64_t seed) {
+            wait();
+            mSeed = seed;
+            mPermutationEpoch = none;
+            mAheadEpoch = none;
+        }
+
+        /**
+         * Move on to the next batch.
+         * @return indices of its samples in the training set.
+         */
+        const std::vector<uint32_t> & next() {
+            draw();
+
+            // The batch after this one reaches into the next epoch: build
+            // that epoch's order while this batch is evaluated.
+            const size_t epoch = mEpoch + 1;
+            if (mPrefetch && mOrder != SEQUENTIAL
+                && mIndex + mSampleCount > mTrainLabels->size()
+                && mPermutationEpoch != epoch && mAheadEpoch != epoch) {
+                wait();
+                mAheadEpoch = epoch;
+                mWorker = std::thread([this, epoch] {
+                    permute(epoch, &mAhead);
+                });
+            }
+            return mBatch;
+        }
+
+        /// Data of the batch last returned by next().
+        SampleView getData() const { return SampleView(*mTrainData, mBatch); }
+
+        /// Labels of the batch last returned by next().
+        SampleView getLabels() const {
+            return SampleView(*mTrainLabels, mBatch);
+        }
+
+        /**
+         * Copy the next mini batch into the provided vector pointers.
+         * @param mini_labels
+         * @param mini_data
+         */
+        void nextBatch(std::vector<vec_t> * mini_labels,
+                       std::vector<vec_t> * mini_data) {
+            next();
+            getLabels().gather(mini_labels);
+            getData().gather(mini_data);
+        }
+
+        size_t getEpoch() const { return mEpoch; }
+
+        /// Position of the next sample in the epoch's order.
+        size_t getIndex() const { return mIndex; }
+
+        /**
+         * Continue from a saved cursor.
+         * @param index next sample.
+         * @param epoch
+         */
+        void setPosition(size_t index, size_t epoch) {
+            mIndex = index;
+            mEpoch = epoch;
+        }
+
+    private:
+        enum Order { SEQUENTIAL, SHUFFLE, STRATIFIED };
+
+        static const size_t none = SIZE_MAX;
+
+        size_t mSampleCount;
+        Order mOrder;
+        uint64_t mSeed = 0;
+        std::shared_ptr<std::vector<vec_t>> mTrainLabels;
+        std::shared_ptr<std::vector<vec_t>> mTrainData;
+        bool mPrefetch;
+
+        /// Cursor just past the batch last returned.
+        size_t mIndex = 0;
+        size_t mEpoch = 0;
+        std::vector<uint32_t> mBatch;
+
+        /// Order of mPermutationEpoch.
+        std::vector<uint32_t> mPermutation;
+        size_t mPermutationEpoch = none;
+
+        /// Order of mAheadEpoch, built by mWorker. Only read after wait().
+        std::vector<uint32_t> mAhead;
+        size_t mAheadEpoch = none;
+        std::thread mWorker;
+
+        void wait() {
+            if (mWorker.joinable()) {
+                mWorker.join();
+            }
+        }
+
+        /**
+         * Fill mBatch with the batch at the cursor and move past it.
+         */
+        void draw() {
+            const size_t size = mTrainLabels->size();
+            mBatch.resize(mSampleCount);
+            for (size_t i = 0; i < mSampleCount; i++) {
+                if (mIndex >= size) {
+                    // We've rolled into the new epoch.
+                    mEpoch++;
+                    mIndex = 0;
+                }
+
+                if (mOrder == SEQUENTIAL) {
+                    mBatch[i] = static_cast<uint32_t>(mIndex);
+                }
+                else {
+                    if (mPermutationEpoch != mEpoch) {
+                        usePermutation(mEpoch);
+                    }
+                    mBatch[i] = mPermutation[mIndex];
+                }
+                mIndex++;
+            }
+        }
+
+        /**
+         * Make mPermutation the order of epoch, taking it from the worker
+         * if it built that one.
+         */
+        void usePermutation(size_t epoch) {
+            wait();
+            if (mAheadEpoch == epoch) {
+                mPermutation.swap(mAhead);
+                mAheadEpoch = none;
+            }
+            else {
+                permute(epoch, &mPermutation);
+            }
+            mPermutationEpoch = epoch;
+        }
+
+        static void shuffle(std::vector<uint32_t> & v, RandomStream & stream) {
+            for (size_t i = v.size(); i > 1; i--) {
+                size_t j = std::min(
+                    static_cast<size_t>(stream.getDouble() * i), i - 1);
+                std::swap(v[i - 1], v[j]);
+            }
+        }
+
+        /**
+         * Build the order of an epoch. Reads only the settings, so it may
+         * run on the worker.
+         */
+        void permute(size_t epoch, std::vector<uint32_t> * order) const {
+            const size_t size = mTrainLabels->size();
+            RandomStream stream(mSeed, epoch);
+
+            if (mOrder == SHUFFLE) {
+                order->resize(size);
+                for (size_t i = 0; i < size; i++) {
+                    (*order)[i] = static_cast<uint32_t>(i);
+                }
+                shuffle(*order, stream);
+                return;
+            }
+
+            // Shuffle every class on its own, then interleave them: the
+            // r-th of a class's n samples goes at (r + u) / n of the
+            // epoch, u being one random offset per class.
+            std::vector<std::vector<uint32_t>> classes;
+            for (size_t i = 0; i < size; i++) {
+                const vec_t & label = (*mTrainLabels)[i];
+                const size_t c = std::max_element(label.begin(), label.end())
+                               - label.begin();
+                if (c >= classes.size()) {
+                    classes.resize(c + 1);
+                }
+                classes[c].push_back(static_cast<uint32_t>(i));
+            }
+
+            std::vector<std::pair<double, uint32_t>> keyed;
+            keyed.reserve(size);
+            for (auto & members : classes) {
+                shuffle(members, stream);
+                const double offset = stream.getDouble();
+                for (size_t r = 0; r < members.size(); r++) {
+                    keyed.emplace_back((r + offset) / members.size(),
+                                       members[r]);
+                }
+            }
+            std::sort(keyed.begin(), keyed.end());
+
+            order->resize(size);
+            for (size_t i = 0; i < size; i++) {
+                (*order)[i] = keyed[i].second;
+            }
+        }
+    };
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "tiny_dnn/evo/genome_view.h"
+#include "tiny_dnn/evo/random_stream.h"
+#include "tiny_dnn/util/nn_error.h"
+#include "tiny_dnn/util/parallel_for.h"
+#include "tiny_dnn/util/util.h"
+
+namespace tiny_dnn {
+
+    /**
+     * A block of standard normal noise shared by every worker.
+     *
+     * A perturbation of a W gene genome is the W values starting at some
+     * offset, so it's known by that offset alone: workers regenerate it
+     * from a seed instead of storing it, and the gradient estimate reads it
+     * back from the same place.
+     *
+     * The table is filled in chunks, each from its own RandomStream keyed
+     * by (seed, chunk), so its content only depends on the seed.
+     */
+    class NoiseTable {
+    public:
+        /**
+         * @param size values.
+         * @param seed
+         */
+        NoiseTable(size_t size, uint64_t seed) : mNoise(size) {
+            const size_t chunks = (size + chunkSize - 1) / chunkSize;
+            for_i(true, chunks, [&](size_t c) {
+                RandomStream stream(seed, c);
+                const size_t begin = c * chunkSize;
+                const size_t end = std::min(size, begin + chunkSize);
+                stream.fillNormal(MutableGenomeView(&mNoise[begin],
+                                                    end - begin),
+                                  0, 1);
+            }, 1);
+        }
+
+        size_t size() const { return mNoise.size(); }
+
+        /**
+         * Draw where a perturbation of length values starts.
+         * @param stream
+         * @param length
+         * @return offset
+         */
+        size_t sampleOffset(RandomStream & stream, size_t length) const {
+            if (length > mNoise.size()) {
+                throw nn_error("Noise table smaller than the genome");
+            }
+            return static_cast<size_t>(stream.next()
+                                       % (mNoise.size() - length + 1));
+        }
+
+        /**
+         * @param offset
+         * @param length
+         * @return the perturbation at offset.
+         */
+        GenomeView get(size_t offset, size_t length) const {
+            return GenomeView(mNoise.data() + offset, length);
+        }
+
+    private:
+        static const size_t chunkSize = 1 << 16;
+
+        std::vector<float_t> mNoise;
+    };
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "tiny_dnn/optimizers/optimizer.h"
+#include "tiny_dnn/util/nn_error.h"
+
+namespace tiny_dnn {
+
+    /**
+     * Build one of the gradient optimizers the evo settings can name.
+     * @param name          sgd or adam.
+     * @param learning_rate
+     * @return optimizer
+     */
+    inline std::unique_ptr<optimizer> makeOptimizer(const std::string & name,
+                                                    float learning_rate) {
+        if (name == "sgd") {
+            std::unique_ptr<gradient_descent> opt(new gradient_descent());
+            opt->alpha = learning_rate;
+            return std::move(opt);
+        }
+        if (name == "adam") {
+            std::unique_ptr<adam> opt(new adam());
+            opt->alpha = learning_rate;
+            return std::move(opt);
+        }
+        throw nn_error("Unknown optimizer: " + name);
+    }
+}
@@ -1,9 +1,18 @@
 /**
- * This should 100% be comthing that reads the params.config file.
- * I can't be asked to make/find a file reader though :)
+ * Compile time defaults (Params) and their run time counterpart (EvoParams),
+ * which can be read from a params.config style file and overridden by hand.
  */
 #pragma once
 
+#include <cstddef>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include "tiny_dnn/util/nn_error.h"
+
 namespace tiny_dnn {
     struct Params {
       Params() = delete;
@@ -26,4 +35,360 @@ namespace tiny_dnn {
       static const size_t tracking_stride = 1000; // Every N generations, print out info.
       static constexpr float min_fitness = 0.00001;
     };
+
+    /**
+     * Run time LEEA settings, handed to the Evolver on construction.
+     * Defaults to Params. Keys are the field names, the same ones used in
+     * params.config:
+     *
+     *     population_size = 1000   ## Anything after a '#' is ignored.
+     */
+    struct EvoParams {
+        size_t population_size = Params::population_size;
+        size_t max_generations = Params::max_generations;
+        size_t sample_count = Params::sample_count;
+        float mutation_power = Params::mutation_power;
+        float mutation_power_decay = Params::mutation_power_decay;
+        float mutation_rate = Params::mutation_rate;
+        float mutation_rate_decay = Params::mutation_rate_decay;
+        float sex_proportion = Params::sex_proportion;
+        float selection_proportion = Params::selection_proportion;
+        float initial_weights_delta = Params::initial_weights_delta;
+        /// Initial genomes: uniform from [-initial_weights_delta,
+        /// initial_weights_delta], or per layer xavier, lecun or he.
+        std::string weight_init = "uniform";
+        float fitness_decay_rate = Params::fitness_decay_rate;
+        size_t tracking_stride = Params::tracking_stride;
+        float min_fitness = Params::min_fitness;
+        size_t threads = 0; //< Evaluation threads, 0 uses every core.
+        /// Pin evaluation threads to cpus, spread over the NUMA nodes.
+        bool pin_threads = false;
+        /// Set by code running several evolvers side by side, e.g. one per
+        /// island: their evaluation threads are threads [pin_first,
+        /// pin_first + threads) of pin_total placed together, so that they
+        /// pin onto separate cpus. 0 places just this evolver's.
+        size_t pin_first = 0;
+        size_t pin_total = 0;
+        /// Parent selection: roulette, tournament or rank.
+        std::string selection = "roulette";
+        size_t tournament_size = 3; //< Candidates per tournament.
+        float rank_pressure = 1.5; //< Rank selection pressure, in [1, 2].
+        /// Score mutated offspring incrementally from their parent's first
+        /// layer when the network allows it.
+        bool delta_evaluation = true;
+        size_t islands = 1; //< Independent populations, each of population_size.
+        size_t migration_interval = 10; //< Generations between migrations.
+        size_t migrants = 5; //< Elites each island sends per migration.
+        /// Who islands send to: ring or full.
+        std::string topology = "ring";
+        /// Run islands as forked processes rather than threads.
+        bool island_processes = false;
+        /// Snapshot file written every checkpoint_interval generations.
+        std::string checkpoint_path = "";
+        size_t checkpoint_interval = 0; //< 0 disables checkpoints.
+        /// Order minibatches visit the training set in every epoch:
+        /// sequential, shuffle or stratified (by one-hot class).
+        std::string batch_order = "sequential";
+        /// Build the next epoch's shuffled or stratified order while the
+        /// current batch is evaluated. Costs a thread start per epoch.
+        bool prefetch_batches = false;
+        /// Skip evaluating genomes already scored on the same minibatch,
+        /// e.g. unmutated clones. Costs hashing every crossover child.
+        bool fitness_cache = false;
+        /// How genes are stored: float, fp16, bf16 or int8. The narrow
+        /// formats round every offspring and turn delta_evaluation off.
+        std::string genome_precision = "float";
+        /// Elites refined by gradient descent every generation, their
+        /// trained weights written back into their genomes. 0 disables.
+        size_t refine_elites = 0;
+        size_t refine_steps = 1; //< Gradient steps per refined elite.
+        /// Refinement optimizer: sgd or adam.
+        std::string refine_optimizer = "sgd";
+        float refine_learning_rate = 0.01;
+        /// Population optimizer: leea (Evolver) or es (EvolutionStrategy).
+        std::string engine = "leea";
+        float es_sigma = 0.02; //< Standard deviation of the ES perturbations.
+        float es_learning_rate = 0.01;
+        /// Optimizer applying the ES gradient estimate: sgd or adam.
+        std::string es_optimizer = "adam";
+        /// Normal values shared by the ES perturbations, at least one genome.
+        size_t noise_table_size = 1 << 24;
+        /// Group the population into species by genome distance and select
+        /// parents on fitness shared within their species.
+        bool speciation = false;
+        /// RMS gene distance within which genomes share a species.
+        float species_threshold = 0.5;
+        /// Species count the threshold is steered towards, 0 keeps it fixed.
+        size_t species_target = 8;
+        size_t max_species = 32; //< Beyond it, genomes join the nearest species.
+
+        /**
+         * Read settings from a params.config style file.
+         * @param path
+         * @return params, defaults for keys the file doesn't mention.
+         */
+        static EvoParams fromFile(const std::string & path) {
+            std::ifstream ifs(path.c_str());
+            if (!ifs) {
+                throw nn_error("Can't open parameter file: " + path);
+            }
+
+            EvoParams params;
+            params.parse(ifs);
+            return params;
+        }
+
+        /**
+         * Apply every "key = value" line of a stream.
+         * @param is
+         */
+        void parse(std::istream & is) {
+            std::string line;
+            while (std::getline(is, line)) {
+                line = line.substr(0, line.find('#'));
+
+                size_t eq = line.find('=');
+                if (eq == std::string::npos) {
+                    if (trim(line).empty()) {
+                        continue;
+                    }
+                    throw nn_error("Malformed parameter line: " + line);
+                }
+
+                set(trim(line.substr(0, eq)), trim(line.substr(eq + 1)));
+            }
+        }
+
+        /**
+         * Apply a "key=value" override, e.g. from the command line.
+         * @param assignment
+         */
+        void set(const std::string & assignment) {
+            size_t eq = assignment.find('=');
+            if (eq == std::string::npos) {
+                throw nn_error("Expected key=value, got: " + assignment);
+            }
+            set(trim(assignment.substr(0, eq)),
+                trim(assignment.substr(eq + 1)));
+        }
+
+        /**
+         * Set one setting by name.
+         * @param key
+         * @param value
+         */
+        void set(const std::string & key, const std::string & value) {
+            if (key == "population_size") read(key, value, &population_size);
+            else if (key == "max_generations") read(key, value, &max_generations);
+            else if (key == "sample_count") read(key, value, &sample_count);
+            else if (key == "mutation_power") read(key, value, &mutation_power);
+            else if (key == "mutation_power_decay") read(key, value, &mutation_power_decay);
+            else if (key == "mutation_rate") read(key, value, &mutation_rate);
+            else if (key == "mutation_rate_decay") read(key, value, &mutation_rate_decay);
+            else if (key == "sex_proportion") read(key, value, &sex_proportion);
+            else if (key == "selection_proportion") read(key, value, &selection_proportion);
+            else if (key == "initial_weights_delta") read(key, value, &initial_weights_delta);
+            else if (key == "weight_init") read(key, value, &weight_init);
+            else if (key == "fitness_decay_rate") read(key, value, &fitness_decay_rate);
+            else if (key == "tracking_stride") read(key, value, &tracking_stride);
+            else if (key == "min_fitness") read(key, value, &min_fitness);
+            else if (key == "threads") read(key, value, &threads);
+            else if (key == "pin_threads") read(key, value, &pin_threads);
+            else if (key == "selection") read(key, value, &selection);
+            else if (key == "tournament_size") read(key, value, &tournament_size);
+            else if (key == "rank_pressure") read(key, value, &rank_pressure);
+            else if (key == "delta_evaluation") read(key, value, &delta_evaluation);
+            else if (key == "islands") read(key, value, &islands);
+            else if (key == "migration_interval") read(key, value, &migration_interval);
+            else if (key == "migrants") read(key, value, &migrants);
+            else if (key == "topology") read(key, value, &topology);
+            else if (key == "island_processes") read(key, value, &island_processes);
+            else if (key == "checkpoint_path") read(key, value, &checkpoint_path);
+            else if (key == "checkpoint_interval") read(key, value, &checkpoint_interval);
+            else if (key == "batch_order") read(key, value, &batch_order);
+            else if (key == "prefetch_batches") read(key, value, &prefetch_batches);
+            else if (key == "fitness_cache") read(key, value, &fitness_cache);
+            else if (key == "genome_precision") read(key, value, &genome_precision);
+            else if (key == "refine_elites") read(key, value, &refine_elites);
+            else if (key == "refine_steps") read(key, value, &refine_steps);
+            else if (key == "refine_optimizer") read(key, value, &refine_optimizer);
+            else if (key == "refine_learning_rate") read(key, value, &refine_learning_rate);
+            else if (key == "engine") read(key, value, &engine);
+            else if (key == "es_sigma") read(key, value, &es_sigma);
+            else if (key == "es_learning_rate") read(key, value, &es_learning_rate);
+            else if (key == "es_optimizer") read(key, value, &es_optimizer);
+            else if (key == "noise_table_size") read(key, value, &noise_table_size);
+            else if (key == "speciation") read(key, value, &speciation);
+            else if (key == "species_threshold") read(key, value, &species_threshold);
+            else if (key == "species_target") read(key, value, &species_target);
+            else if (key == "max_species") read(key, value, &max_species);
+            else throw nn_error("Unknown parameter: " + key);
+        }
+
+        /**
+         * Reject settings the Evolver can't run with.
+         */
+        void validate() const {
+            if (population_size == 0) {
+                throw nn_error("population_size must be positive");
+            }
+            if (sample_count == 0) {
+                throw nn_error("sample_count must be positive");
+            }
+            if (selection_proportion <= 0 || selection_proportion > 1
+                || size_t(population_size * selection_proportion) == 0) {
+                throw nn_error("selection_proportion must select at least "
+                               "one individual");
+            }
+            if (selection != "roulette" && selection != "tournament"
+                && selection != "rank") {
+                throw nn_error("Unknown selection scheme: " + selection);
+            }
+            if (tournament_size == 0) {
+                throw nn_error("tournament_size must be positive");
+            }
+            if (rank_pressure < 1 || rank_pressure > 2) {
+                throw nn_error("rank_pressure must be in [1, 2]");
+            }
+            if (weight_init != "uniform" && weight_init != "xavier"
+                && weight_init != "lecun" && weight_init != "he") {
+                throw nn_error("Unknown weight init: " + weight_init);
+            }
+            if (islands == 0) {
+                throw nn_error("islands must be positive");
+            }
+            if (migration_interval == 0) {
+                throw nn_error("migration_interval must be positive");
+            }
+            if (topology != "ring" && topology != "full") {
+                throw nn_error("Unknown island topology: " + topology);
+            }
+            if (genome_precision != "float" && genome_precision != "fp16"
+                && genome_precision != "bf16" && genome_precision != "int8") {
+                throw nn_error("Unknown genome precision: " + genome_precision);
+            }
+            if (batch_order != "sequential" && batch_order != "shuffle"
+                && batch_order != "stratified") {
+                throw nn_error("Unknown batch order: " + batch_order);
+            }
+            if (refine_optimizer != "sgd" && refine_optimizer != "adam") {
+                throw nn_error("Unknown refine optimizer: " + refine_optimizer);
+            }
+            if (refine_learning_rate <= 0) {
+                throw nn_error("refine_learning_rate must be positive");
+            }
+            if (engine != "leea" && engine != "es") {
+                throw nn_error("Unknown engine: " + engine);
+            }
+            if (es_sigma <= 0) {
+                throw nn_error("es_sigma must be positive");
+            }
+            if (es_learning_rate <= 0) {
+                throw nn_error("es_learning_rate must be positive");
+            }
+            if (es_optimizer != "sgd" && es_optimizer != "adam") {
+                throw nn_error("Unknown ES optimizer: " + es_optimizer);
+            }
+            if (noise_table_size == 0) {
+                throw nn_error("noise_table_size must be positive");
+            }
+            if (species_threshold <= 0) {
+                throw nn_error("species_threshold must be positive");
+            }
+            if (max_species == 0) {
+                throw nn_error("max_species must be positive");
+            }
+        }
+
+        /**
+         * Write the settings back out in params.config format.
+         * @param os
+         */
+        void print(std::ostream & os) const {
+            os << "population_size = " << population_size << std::endl
+               << "max_generations = " << max_generations << std::endl
+               << "sample_count = " << sample_count << std::endl
+               << "mutation_power = " << mutation_power << std::endl
+               << "mutation_power_decay = " << mutation_power_decay << std::endl
+               << "mutation_rate = " << mutation_rate << std::endl
+               << "mutation_rate_decay = " << mutation_rate_decay << std::endl
+               << "sex_proportion = " << sex_proportion << std::endl
+               << "selection_proportion = " << selection_proportion << std::endl
+               << "initial_weights_delta = " << initial_weights_delta << std::endl
+               << "weight_init = " << weight_init << std::endl
+               << "fitness_decay_rate = " << fitness_decay_rate << std::endl
+               << "tracking_stride = " << tracking_stride << std::endl
+               << "min_fitness = " << min_fitness << std::endl
+               << "threads = " << threads << std::endl
+               << "pin_threads = " << pin_threads << std::endl
+               << "selection = " << selection << std::endl
+               << "tournament_size = " << tournament_size << std::endl
+               << "rank_pressure = " << rank_pressure << std::endl
+               << "delta_evaluation = " << delta_evaluation << std::endl
+               << "islands = " << islands << std::endl
+               << "migration_interval = " << migration_interval << std::endl
+               << "migrants = " << migrants << std::endl
+               << "topology = " << topology << std::endl
+               << "island_processes = " << island_processes << std::endl
+               << "checkpoint_path = " << checkpoint_path << std::endl
+               << "checkpoint_interval = " << checkpoint_interval << std::endl
+               << "batch_order = " << batch_order << std::endl
+               << "prefetch_batches = " << prefetch_batches << std::endl
+               << "fitness_cache = " << fitness_cache << std::endl
+               << "genome_precision = " << genome_precision << std::endl
+               << "refine_elites = " << refine_elites << std::endl
+               << "refine_steps = " << refine_steps << std::endl
+               << "refine_optimizer = " << refine_optimizer << std::endl
+               << "refine_learning_rate = " << refine_learning_rate << std::endl
+               << "engine = " << engine << std::endl
+               << "es_sigma = " << es_sigma << std::endl
+               << "es_learning_rate = " << es_learning_rate << std::endl
+               << "es_optimizer = " << es_optimizer << std::endl
+               << "noise_table_size = " << noise_table_size << std::endl
+               << "speciation = " << speciation << std::endl
+               << "species_threshold = " << species_threshold << std::endl
+               << "species_target = " << species_target << std::endl
+               << "max_species = " << max_species << std::endl;
+        }
+
+    private:
+        static std::string trim(const std::string & s) {
+            const char * space = " \t\r\n";
+            size_t first = s.find_first_not_of(space);
+            if (first == std::string::npos) {
+                return std::string();
+            }
+            return s.substr(first, s.find_last_not_of(space) - first + 1);
+        }
+
+        template <typename T>
+        static void read(const std::string & key, const std::string & value,
+                         T * dst) {
+            std::istringstream iss(value);
+            T parsed;
+            if (!(iss >> parsed) || !(iss >> std::ws).eof()
+                || (std::is_unsigned<T>::value && value[0] == '-')) {
+                throw nn_error("Invalid value for " + key + ": " + value);
+            }
+            *dst = parsed;
+        }
+
+        static void read(const std::string &, const std::string & value,
+                         std::string * dst) {
+            *dst = value;
+        }
+
+        static void read(const std::string & key, const std::string & value,
+                         bool * dst) {
+            if (value == "1" || value == "true") {
+                *dst = true;
+            }
+            else if (value == "0" || value == "false") {
+                *dst = false;
+            }
+            else {
+                throw nn_error("Invalid value for " + key + ": " + value);
+            }
+        }
+    };
 }
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "tiny_dnn/config.h"
+#include "tiny_dnn/evo/genome_codec.h"
+#include "tiny_dnn/evo/genome_view.h"
+#include "tiny_dnn/util/aligned_allocator.h"
+#include "tiny_dnn/util/parallel_for.h"
+
+namespace tiny_dnn {
+
+    /**
+     * Population store for the Evolver.
+     * Every genome lives in one 64-byte aligned arena, one row per individual,
+     * each row padded to a whole number of cache lines. A second arena of the
+     * same shape holds the offspring being produced; swap() makes them the
+     * current population without any allocation.
+     *
+     * With a compressing GenomeCodec the arenas hold packed rows instead,
+     * and genomes are only reachable through readGenome() and
+     * writeGenome(), which widen and narrow them on the way.
+     */
+    class Population {
+    public:
+        static const size_t alignment = 64;
+        typedef aligned_allocator<float_t, alignment> allocator_t;
+
+        /**
+         * Allocate both arenas.
+         * @param size          number of individuals.
+         * @param genome_length number of genes per individual.
+         * @param codec         storage of the genes, float_t by default.
+         */
+        Population(size_t size, size_t genome_length,
+                   const GenomeCodec & codec = GenomeCodec())
+            : mSize(size), mLength(genome_length),
+              mStride(calculateStride(genome_length)), mCodec(codec),
+              mFitness(size, std::numeric_limits<float>::min()),
+              mOffspringFitness(size, std::numeric_limits<float>::min()) {
+            if (mCodec.isCompressed()) {
+                mPackedStride = (genome_length * mCodec.getBytesPerGene()
+                                 + alignment - 1) / alignment * alignment;
+                mPacked = allocatePacked();
+                mPackedOffspring = allocatePacked();
+                mRanges.resize(size * mCodec.getRangeCount());
+                mOffspringRanges.resize(size * mCodec.getRangeCount());
+            }
+            else {
+                mGenomes = allocateArena();
+                mOffspring = allocateArena();
+            }
+        }
+
+        ~Population() {
+            if (mCodec.isCompressed()) {
+                aligned_allocator<uint8_t, alignment> allocator;
+                allocator.deallocate(mPacked, mSize * mPackedStride);
+                allocator.deallocate(mPackedOffspring, mSize * mPackedStride);
+            }
+            else {
+                allocator_t allocator;
+                allocator.deallocate(mGenomes, mSize * mStride);
+                allocator.deallocate(mOffspring, mSize * mStride);
+            }
+        }
+
+        Population(const Population &) = delete;
+        Population & operator=(const Population &) = delete;
+
+        size_t size() const { return mSize; }
+        size_t getGenomeLength() const { return mLength; }
+
+        /**
+         * Distance in genes between the starts of two consecutive rows.
+         * @return stride
+         */
+        size_t getStride() const { return mStride; }
+
+        /**
+         * Are genomes stored packed? If so only readGenome() and
+         * writeGenome() may be used to reach them.
+         * @return compressed
+         */
+        bool isCompressed() const { return mCodec.isCompressed(); }
+
+        const GenomeCodec & getCodec() const { return mCodec; }
+
+        /**
+         * Bytes taken by the genomes of both arenas.
+         * @return bytes
+         */
+        size_t getArenaBytes() const {
+            return isCompressed()
+                ? 2 * (mSize * mPackedStride + mRanges.size() * sizeof(float))
+                : 2 * mSize * mStride * sizeof(float_t);
+        }
+
+        GenomeView getGenome(size_t i) const {
+            assert(!isCompressed());
+            return GenomeView(mGenomes + i * mStride, mLength);
+        }
+
+        MutableGenomeView getMutableGenome(size_t i) {
+            assert(!isCompressed());
+            return MutableGenomeView(mGenomes + i * mStride, mLength);
+        }
+
+        /**
+         * Row i of the offspring arena, to be written by reproduction.
+         * @param i
+         * @return view
+         */
+        MutableGenomeView getOffspring(size_t i) {
+            assert(!isCompressed());
+            return MutableGenomeView(mOffspring + i * mStride, mLength);
+        }
+
+        /**
+         * Genome i as floats: the arena row itself when genes are stored
+         * as float_t, otherwise widened into scratch.
+         * @param i
+         * @param scratch resized as needed.
+         * @return view, valid until scratch or the row changes.
+         */
+        GenomeView readGenome(size_t i, vec_t & scratch) const {
+            if (!isCompressed()) {
+                return getGenome(i);
+            }
+            return widen(mPacked, mRanges, i, scratch);
+        }
+
+        /**
+         * Like readGenome(), for getPreviousGenome().
+         */
+        GenomeView readPreviousGenome(size_t i, vec_t & scratch) const {
+            if (!isCompressed()) {
+                return getPreviousGenome(i);
+            }
+            return widen(mPackedOffspring, mOffspringRanges, i, scratch);
+        }
+
+        /**
+         * Store genome i. Packing rounds, and the rounded genes are written
+         * back into genome.
+         * @param i
+         * @param genome
+         */
+        void writeGenome(size_t i, MutableGenomeView genome) {
+            if (!isCompressed()) {
+                copyInto(genome, getMutableGenome(i));
+                return;
+            }
+            narrow(genome, mPacked, mRanges, i);
+        }
+
+        /**
+         * Like writeGenome(), into the offspring arena.
+         */
+        void writeOffspring(size_t i, MutableGenomeView genome) {
+            if (!isCompressed()) {
+                copyInto(genome, getOffspring(i));
+                return;
+            }
+            narrow(genome, mPackedOffspring, mOffspringRanges, i);
+        }
+
+        /**
+         * Like writeOffspring(), for a child bred from row parent of the
+         * current population: int8 segments keep the parent's ranges while
+         * the child's genes fit, so the genes it inherited unchanged are
+         * stored exactly.
+         * @param i
+         * @param genome
+         * @param parent
+         */
+        void writeOffspring(size_t i, MutableGenomeView genome,
+                            size_t parent) {
+            if (!isCompressed()) {
+                copyInto(genome, getOffspring(i));
+                return;
+            }
+            narrow(genome, mPackedOffspring, mOffspringRanges, i,
+                   mRanges.data() + parent * mCodec.getRangeCount());
+        }
+
+        /**
+         * The int8 ranges row i is stored on, getCodec().getRangeCount()
+         * floats. Nothing for other precisions.
+         * @param i
+         * @return ranges
+         */
+        const float * getRanges(size_t i) const {
+            return mRanges.data() + i * mCodec.getRangeCount();
+        }
+
+        /**
+         * Store genome i on the given ranges as they are, for genomes read
+         * back from getRanges() of an identical population.
+         * @param i
+         * @param genome
+         * @param ranges getCodec().getRangeCount() floats.
+         */
+        void restoreGenome(size_t i, MutableGenomeView genome,
+                           const float * ranges) {
+            if (!isCompressed()) {
+                copyInto(genome, getMutableGenome(i));
+                return;
+            }
+            const size_t count = mCodec.getRangeCount();
+            std::copy(ranges, ranges + count, mRanges.data() + i * count);
+            mCodec.encodeOnto(genome, mPacked + i * mPackedStride, ranges);
+        }
+
+        /**
+         * Row i of the previous generation. After swap() the parents stay
+         * in the offspring arena until the next reproduction overwrites them.
+         * @param i
+         * @return view
+         */
+        GenomeView getPreviousGenome(size_t i) const {
+            assert(!isCompressed());
+            return GenomeView(mOffspring + i * mStride, mLength);
+        }
+
+        float getFitness(size_t i) const { return mFitness[i]; }
+        void setFitness(size_t i, float fitness) { mFitness[i] = fitness; }
+
+        void setOffspringFitness(size_t i, float fitness) {
+            mOffspringFitness[i] = fitness;
+        }
+
+        const std::vector<float> & getFitnesses() const { return mFitness; }
+
+        /**
+         * Offspring become the current population, the old parents' rows
+         * are recycled as the next offspring arena.
+         */
+        void swap() {
+            std::swap(mGenomes, mOffspring);
+            std::swap(mPacked, mPackedOffspring);
+            mRanges.swap(mOffspringRanges);
+            std::swap(mFitness, mOffspringFitness);
+        }
+
+    private:
+        size_t mSize;
+        size_t mLength;
+        size_t mStride;
+        GenomeCodec mCodec;
+        float_t * mGenomes = nullptr;
+        float_t * mOffspring = nullptr;
+        /// Packed arenas and their per-row ranges, when compressed.
+        size_t mPackedStride = 0;
+        uint8_t * mPacked = nullptr;
+        uint8_t * mPackedOffspring = nullptr;
+        std::vector<float> mRanges;
+        std::vector<float> mOffspringRanges;
+        std::vector<float> mFitness;
+        std::vector<float> mOffspringFitness;
+
+        static void copyInto(GenomeView from, MutableGenomeView to) {
+            if (from.data() != to.data()) {
+                std::copy(from.begin(), from.end(), to.begin());
+            }
+        }
+
+        GenomeView widen(const uint8_t * arena,
+                         const std::vector<float> & ranges, size_t i,
+                         vec_t & scratch) const {
+            scratch.resize(mLength);
+            MutableGenomeView genome(scratch.data(), mLength);
+            mCodec.decode(arena + i * mPackedStride,
+                          ranges.data() + i * mCodec.getRangeCount(), genome);
+            return genome;
+        }
+
+        void narrow(MutableGenomeView genome, uint8_t * arena,
+                    std::vector<float> & ranges, size_t i,
+                    const float * keep = nullptr) {
+            mCodec.encode(genome, arena + i * mPackedStride,
+                          ranges.data() + i * mCodec.getRangeCount(), keep);
+        }
+
+        static size_t calculateStride(size_t genome_length) {
+            const size_t per_line = alignment / sizeof(float_t);
+            return ((genome_length + per_line - 1) / per_line) * per_line;
+        }
+
+        /**
+         * Allocate an arena and zero it row by row from the worker threads,
+         * so that on first-touch NUMA policies each row's pages land near
+         * the thread that later works on it.
+         */
+        float_t * allocateArena() {
+            allocator_t allocator;
+            float_t * arena = allocator.allocate(mSize * mStride);
+            for_i(true, mSize, [&](size_t i) {
+                std::fill(arena + i * mStride, arena + (i + 1) * mStride,
+                          float_t(0));
+            });
+            return arena;
+        }
+
+        uint8_t * allocatePacked() {
+            aligned_allocator<uint8_t, alignment> allocator;
+            uint8_t * arena = allocator.allocate(mSize * mPackedStride);
+            for_i(true, mSize, [&](size_t i) {
+                std::fill(arena + i * mPackedStride,
+                          arena + (i + 1) * mPackedStride, uint8_t(0));
+            });
+            return arena;
+        }
+    };
+}
@@ -7,6 +7,7 @@
 #pragma once
 
 #include<iostream>
+#include <cstdint>
 #include <memory>
 #include <random>
 
@@ -42,6 +43,44 @@ namespace tiny_dnn {
          */
         inline int getSeed() { return seed; }
 
+        /**
+         * Everything needed to continue the sequence later, e.g. from a
+         * checkpoint.
+         */
+        struct State {
+            int32_t seed;
+            int32_t inext;
+            int32_t inextp;
+            int32_t ma[56];
+            double expRV;
+        };
+
+        /**
+         * Capture the generator's position.
+         * @return state
+         */
+        State getState() const {
+            State state;
+            state.seed = seed;
+            state.inext = inext;
+            state.inextp = inextp;
+            for (int i = 0; i < 56; ++i) state.ma[i] = ma[i];
+            state.expRV = expRV;
+            return state;
+        }
+
+        /**
+         * Continue from a captured position.
+         * @param state from getState().
+         */
+        void setState(const State & state) {
+            seed = state.seed;
+            inext = state.inext;
+            inextp = state.inextp;
+            for (int i = 0; i < 56; ++i) ma[i] = state.ma[i];
+            expRV = state.expRV;
+        }
+
         /**
          * Generate a double between 0.0 and 1.0
          *
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "tiny_dnn/evo/genome_view.h"
+
+namespace tiny_dnn {
+
+    /**
+     * Small, fast generator for the evolutionary hot loops (xoshiro256**).
+     *
+     * Unlike Random, a stream is meant to be created on the spot from a key:
+     * RandomStream(seed, a, b) always produces the same sequence for the same
+     * (seed, a, b), e.g. (run seed, generation, offspring index). Work keyed
+     * like that can be spread over any number of threads and still give the
+     * same result. jump() skips 2^128 draws for splitting one stream in
+     * non-overlapping parts.
+     *
+     * fillUniform() and fillNormal() produce whole spans at once from
+     * lanes independent generators stepped side by side, a loop the
+     * compiler vectorizes. They take a single draw from the stream to seed
+     * the lanes, so what follows a fill doesn't depend on its length.
+     */
+    class RandomStream {
+    public:
+        /**
+         * @param seed run seed.
+         * @param a    first key, e.g. generation.
+         * @param b    second key, e.g. individual.
+         */
+        explicit RandomStream(uint64_t seed, uint64_t a = 0, uint64_t b = 0) {
+            // Mix the key through splitmix64 so neighbouring keys give
+            // unrelated states.
+            uint64_t key = seed;
+            uint64_t mixed = splitmix(key) ^ a;
+            mixed = splitmix(mixed) ^ b;
+            for (int i = 0; i < 4; i++) {
+                mState[i] = splitmix(mixed);
+            }
+        }
+
+        /**
+         * Next 64 random bits.
+         * @return bits
+         */
+        inline uint64_t next() {
+            const uint64_t result = rotl(mState[1] * 5, 7) * 9;
+            const uint64_t t = mState[1] << 17;
+
+            mState[2] ^= mState[0];
+            mState[3] ^= mState[1];
+            mState[1] ^= mState[2];
+            mState[0] ^= mState[3];
+            mState[2] ^= t;
+            mState[3] = rotl(mState[3], 45);
+
+            return result;
+        }
+
+        /**
+         * Generate a double between 0.0 and 1.0 (never 1.0).
+         * @return The pseudo random number.
+         */
+        inline double getDouble() {
+            return (next() >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+        /**
+         * Generate a double out of [min, max).
+         * @param min
+         * @param max
+         * @return The pseudo random number.
+         */
+        inline double getDouble(const double min, const double max) {
+            return getDouble() * (max - min) + min;
+        }
+
+        /**
+         * Number of failed Bernoulli(p) trials before the next success.
+         * Lets sparse operations jump straight to the next selected index
+         * instead of drawing once per element.
+         * @param p success probability.
+         * @return skip, SIZE_MAX when p <= 0.
+         */
+        inline size_t getGeometric(double p) {
+            if (p >= 1.0) {
+                return 0;
+            }
+            if (p <= 0.0) {
+                return SIZE_MAX;
+            }
+            // 1 - u lies in (0, 1], keeps log finite.
+            const double skip = std::floor(std::log(1.0 - getDouble())
+                                           / std::log(1.0 - p));
+            return (skip >= static_cast<double>(SIZE_MAX))
+                ? SIZE_MAX : static_cast<size_t>(skip);
+        }
+
+        /**
+         * Fill a span uniformly from [min, max), 24 random bits per value.
+         * @param out
+         * @param min
+         * @param max
+         */
+        void fillUniform(MutableGenomeView out, float_t min, float_t max) {
+            Lanes state(next());
+            uint64_t bits[lanes];
+            const float_t scale = (max - min) * float_t(1.0 / 16777216.0);
+            float_t * dst = out.data();
+
+            for (size_t k = 0; k < out.size(); k += lanes) {
+                state.next(bits);
+                const size_t count = std::min(size_t(lanes), out.size() - k);
+                for (size_t j = 0; j < count; j++) {
+                    dst[k + j] = float_t(bits[j] >> 40) * scale + min;
+                }
+            }
+        }
+
+        /**
+         * Fill a span with normal values (Box-Muller, two values per pair of
+         * draws).
+         * @param out
+         * @param mean
+         * @param sigma standard deviation.
+         */
+        void fillNormal(MutableGenomeView out, float_t mean, float_t sigma) {
+            Lanes state(next());
+            uint64_t first[lanes];
+            uint64_t second[lanes];
+            float_t radius[lanes];
+            float_t angle[lanes];
+            const float_t unit = float_t(1.0 / 16777216.0);
+            float_t * dst = out.data();
+
+            for (size_t k = 0; k < out.size(); k += 2 * lanes) {
+                state.next(first);
+                state.next(second);
+                for (size_t j = 0; j < lanes; j++) {
+                    // 1 - u lies in (0, 1], keeps log finite.
+                    const float_t u =
+                        float_t(1) - float_t(first[j] >> 40) * unit;
+                    radius[j] = sigma * std::sqrt(float_t(-2) * std::log(u));
+                    angle[j] = float_t(6.283185307179586)
+                             * (float_t(second[j] >> 40) * unit);
+                }
+
+                const size_t count = std::min(size_t(2 * lanes), out.size() - k);
+                for (size_t j = 0; j < std::min(size_t(lanes), count); j++) {
+                    dst[k + j] = mean + radius[j] * std::cos(angle[j]);
+                }
+                for (size_t j = lanes; j < count; j++) {
+                    dst[k + j] = mean + radius[j - lanes]
+                                      * std::sin(angle[j - lanes]);
+                }
+            }
+        }
+
+        /**
+         * Advance the stream by 2^128 draws.
+         */
+        void jump() {
+            static const uint64_t JUMP[] = {
+                0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+            };
+
+            uint64_t s[4] = {0, 0, 0, 0};
+            for (uint64_t jump : JUMP) {
+                for (int b = 0; b < 64; b++) {
+                    if (jump & (uint64_t(1) << b)) {
+                        for (int i = 0; i < 4; i++) {
+                            s[i] ^= mState[i];
+                        }
+                    }
+                    next();
+                }
+            }
+
+            for (int i = 0; i < 4; i++) {
+                mState[i] = s[i];
+            }
+        }
+
+    private:
+        static const size_t lanes = 8;
+
+        /**
+         * lanes xoshiro256** generators with their state laid out by word,
+         * so one step of all of them is a straight loop over arrays.
+         */
+        struct Lanes {
+            explicit Lanes(uint64_t seed) {
+                for (size_t j = 0; j < lanes; j++) {
+                    s0[j] = splitmix(seed);
+                    s1[j] = splitmix(seed);
+                    s2[j] = splitmix(seed);
+                    s3[j] = splitmix(seed);
+                }
+            }
+
+            void next(uint64_t * out) {
+                for (size_t j = 0; j < lanes; j++) {
+                    out[j] = rotl(s1[j] * 5, 7) * 9;
+                    const uint64_t t = s1[j] << 17;
+                    s2[j] ^= s0[j];
+                    s3[j] ^= s1[j];
+                    s1[j] ^= s2[j];
+                    s0[j] ^= s3[j];
+                    s2[j] ^= t;
+                    s3[j] = rotl(s3[j], 45);
+                }
+            }
+
+            uint64_t s0[lanes];
+            uint64_t s1[lanes];
+            uint64_t s2[lanes];
+            uint64_t s3[lanes];
+        };
+
+        uint64_t mState[4];
+
+        static inline uint64_t rotl(const uint64_t x, int k) {
+            return (x << k) | (x >> (64 - k));
+        }
+
+        static inline uint64_t splitmix(uint64_t & x) {
+            uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+    };
+}
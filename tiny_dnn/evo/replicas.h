@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "tiny_dnn/evo/genome_view.h"
+#include "tiny_dnn/network.h"
+
+namespace tiny_dnn {
+
+    /**
+     * One network per evaluation thread, with the weight vectors of each in
+     * genome order so genomes are loaded without walking the layers.
+     *
+     * Networks handed in are used as they are. The other slots stay empty
+     * until their thread first needs a network, which is then built from
+     * the first network's architecture. Only thread id ever touches slot
+     * id.
+     *
+     * Building replicas goes through the JSON model, so without
+     * serialization support every slot that is used needs a network of
+     * its own.
+     */
+    class NetworkReplicas {
+    public:
+        /**
+         * @param networks at least one, all of the same architecture.
+         * @param slots    total, at least networks.size() are kept.
+         */
+        NetworkReplicas(
+            const std::vector<std::shared_ptr<network<sequential>>> & networks,
+            size_t slots)
+            : mNetworks(networks) {
+            mNetworks.resize(std::max(networks.size(), slots));
+            mBindings.resize(mNetworks.size());
+        }
+
+        size_t size() const { return mNetworks.size(); }
+
+        /**
+         * Network of slot id, built on first use.
+         * @param id
+         * @return network
+         */
+        std::shared_ptr<network<sequential>> get(size_t id) {
+            if (!mNetworks[id]) {
+                // Building a network draws initial weights from the global
+                // generator, so replicas are built one at a time.
+                std::lock_guard<std::mutex> lock(mMutex);
+                mNetworks[id] = build();
+            }
+
+            if (mBindings[id].empty()) {
+                bind(id);
+            }
+
+            return mNetworks[id];
+        }
+
+        /**
+         * Copy a genome into the weights of slot id's network, one block
+         * copy per weight vector.
+         * @param genome
+         * @param id
+         */
+        void load(GenomeView genome, size_t id) {
+            const float_t * src = genome.data();
+            get(id);
+            for (vec_t * slot : mBindings[id]) {
+                std::copy(src, src + slot->size(), slot->begin());
+                src += slot->size();
+            }
+        }
+
+        /**
+         * Copy the weights of slot id's network out into a genome.
+         * @param id
+         * @param genome out.
+         */
+        void read(size_t id, MutableGenomeView genome) {
+            float_t * dst = genome.data();
+            get(id);
+            for (vec_t * slot : mBindings[id]) {
+                dst = std::copy(slot->begin(), slot->end(), dst);
+            }
+        }
+
+        /**
+         * Number of weights in a network, i.e. the genome length.
+         * @param net
+         * @return count
+         */
+        static size_t countWeights(network<sequential> & net) {
+            size_t count = 0;
+            for (auto layer : net) {
+                for (auto & weights : layer->weights()) {
+                    count += weights->size();
+                }
+            }
+            return count;
+        }
+
+    private:
+        std::vector<std::shared_ptr<network<sequential>>> mNetworks;
+        /// Per network, the weight vectors in genome order.
+        std::vector<std::vector<vec_t *>> mBindings;
+        /// Architecture used to build missing replicas, read on first use.
+        std::string mModel;
+        std::mutex mMutex;
+
+        /**
+         * A new network of the first network's architecture. Called with
+         * mMutex held.
+         * @return network
+         */
+        std::shared_ptr<network<sequential>> build() {
+#ifndef CNN_NO_SERIALIZATION
+            if (mModel.empty()) {
+                // The model holds only the layers' shapes, so reading it
+                // doesn't race with genomes being loaded into the weights.
+                mModel = mNetworks[0]->to_json();
+            }
+            auto replica = std::make_shared<network<sequential>>();
+            replica->from_json(mModel);
+            return replica;
+#else
+            throw nn_error("Network replicas are built through serialization, "
+                           "which tiny-dnn was built without. Pass a network "
+                           "for every evaluation thread instead.");
+#endif
+        }
+
+        /**
+         * Resolve a network's weight vectors once.
+         * @param id
+         */
+        void bind(size_t id) {
+            for (auto & layer : *(mNetworks[id])) {
+                std::vector<float_t> current;
+                for (vec_t * weights : layer->weights()) {
+                    mBindings[id].push_back(weights);
+                    current.insert(current.end(),
+                                   weights->begin(), weights->end());
+                }
+
+                // Mark the layer as initialized (as layer::load did)
+                // so a later setup() won't overwrite loaded genomes.
+                int idx = 0;
+                layer->load(current, idx);
+            }
+        }
+    };
+}
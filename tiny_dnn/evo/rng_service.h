@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include "tiny_dnn/evo/random.h"
+#include "tiny_dnn/evo/random_stream.h"
+
+namespace tiny_dnn {
+
+    /**
+     * Hands out the RandomStreams of a run.
+     *
+     * A service is just a seed. stream(a, b) is the stream of work item
+     * (a, b), e.g. (generation, individual), and split(key) is a whole new
+     * service for one purpose, or one more key such as a thread id. Nothing
+     * is shared or advanced, so any number of threads may draw streams at
+     * once, and work keyed by item rather than by thread gives the same
+     * result on any number of threads.
+     */
+    class RngService {
+    public:
+        /// Keys of split() for the purposes a run draws randomness for.
+        enum Purpose : uint64_t {
+            initialization = 1,
+            minibatch = 2,
+            noise = 3
+        };
+
+        explicit RngService(uint64_t seed = 0) : mSeed(seed) { }
+
+        /**
+         * Service seeded by 64 bits from a Random.
+         * @param random
+         * @return service
+         */
+        static RngService fromRandom(Random * random) {
+            return RngService((uint64_t(random->getUInt(UINT32_MAX)) << 32)
+                              | random->getUInt(UINT32_MAX));
+        }
+
+        uint64_t getSeed() const { return mSeed; }
+
+        void setSeed(uint64_t seed) { mSeed = seed; }
+
+        /**
+         * Stream of work item (a, b).
+         * @param a first key, e.g. generation.
+         * @param b second key, e.g. individual.
+         * @return stream
+         */
+        RandomStream stream(uint64_t a = 0, uint64_t b = 0) const {
+            return RandomStream(mSeed, a, b);
+        }
+
+        /**
+         * Independent child service. Its streams don't overlap with this
+         * service's or with those of other keys.
+         * @param key
+         * @return service
+         */
+        RngService split(uint64_t key) const {
+            return RngService(mix(mix(mSeed) ^ mix(~key)));
+        }
+
+    private:
+        uint64_t mSeed;
+
+        static uint64_t mix(uint64_t z) {
+            z += 0x9e3779b97f4a7c15ULL;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+    };
+}
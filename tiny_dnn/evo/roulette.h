@@ -6,13 +6,16 @@
 #include <limits>
 #include <iostream>
 #include "tiny_dnn/evo/individual.h"
+#include "tiny_dnn/evo/selector.h"
 
 namespace tiny_dnn {
 
 /**
  * Standard roulette wheel for fitness proportionate selection.
+ * The wheel is an alias table, so a spin costs the same no matter how many
+ * slots there are.
  */
-class Roulette {
+class Roulette : public Selector {
 
 public:
     /**
@@ -22,16 +25,29 @@ public:
     Roulette(const std::vector<std::shared_ptr<Individual>> & individuals,
              Random * random) {
         mRandom = random;
-        mSize = individuals.size();
+        reset(individuals.size(), [&](size_t i) {
+            return individuals[i]->getFitness();
+        });
+    }
+
+    /**
+     * Empty wheel, fill it with reset().
+     * @param random
+     */
+    explicit Roulette(Random * random) : mRandom(random) { }
 
-        float_t total(0.0);
-        for (auto individual : individuals) {
-            total += individual->getFitness();
-        }
+    /**
+     * Rebuild the wheel in place, reusing its storage.
+     * @param count   number of slots.
+     * @param fitness callable, fitness(i) gives the fitness of slot i.
+     */
+    template <typename Func>
+    void reset(size_t count, Func fitness) {
+        mTable.build(count, fitness);
+    }
 
-        for (auto individual : individuals) {
-            mProbDist.push_back(individual->getFitness() / total);
-        }
+    void reset(const std::vector<float> & fitness) override {
+        reset(fitness.size(), [&fitness](size_t i) { return fitness[i]; });
     }
 
     /**
@@ -39,24 +55,27 @@ public:
      * @return i, the index chosen from the fitness distribution.
      */
     size_t spin() {
-        float_t r_val = mRandom->getDouble(0, 1);
-
-        for (size_t i = 0; i < mSize; i++) {
-            r_val -= mProbDist[i];
+        return mTable.sample(mRandom->getDouble(0, 1));
+    }
 
-            if (r_val <= 0) {
-                return i;
-            }
-        }
+    /**
+     * Spin with a caller provided generator (e.g. a RandomStream).
+     * The wheel isn't modified, so threads may spin it concurrently.
+     * @param stream
+     * @return i, the index chosen from the fitness distribution.
+     */
+    template <typename Stream>
+    size_t spin(Stream & stream) const {
+        return mTable.sample(stream.getDouble());
+    }
 
-        // Gaurd for rounding error.
-        return mSize - 1;
+    size_t select(RandomStream & stream) const override {
+        return spin(stream);
     }
 
 private:
     Random * mRandom;
-    size_t mSize = 0;
-    std::vector<float_t> mProbDist;
+    AliasTable mTable;
 };
 
 }
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "tiny_dnn/util/util.h"
+
+namespace tiny_dnn {
+
+    /**
+     * Read only view of some samples of a data set, picked by index.
+     * Lets a minibatch be handed around without copying its vec_ts out of
+     * the training set. Without indices the view is the whole vector, so a
+     * plain std::vector<vec_t> converts to one implicitly.
+     */
+    class SampleView {
+    public:
+        SampleView(const std::vector<vec_t> & samples)
+            : mSamples(&samples), mIndices(nullptr),
+              mSize(samples.size()) { }
+
+        /**
+         * @param samples the whole data set, must outlive the view.
+         * @param indices which samples, in order; must outlive the view.
+         */
+        SampleView(const std::vector<vec_t> & samples,
+                   const std::vector<uint32_t> & indices)
+            : mSamples(&samples), mIndices(indices.data()),
+              mSize(indices.size()) { }
+
+        size_t size() const { return mSize; }
+
+        const vec_t & operator[](size_t j) const {
+            return (*mSamples)[mIndices != nullptr ? mIndices[j] : j];
+        }
+
+        /**
+         * Copy the samples out, for code that wants a plain vector.
+         * @param out resized to size().
+         */
+        void gather(std::vector<vec_t> * out) const {
+            out->resize(mSize);
+            for (size_t j = 0; j < mSize; j++) {
+                (*out)[j] = (*this)[j];
+            }
+        }
+
+    private:
+        const std::vector<vec_t> * mSamples;
+        const uint32_t * mIndices;
+        size_t mSize;
+    };
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+#include "tiny_dnn/evo/params.h"
+#include "tiny_dnn/evo/random.h"
+#include "tiny_dnn/evo/roulette.h"
+#include "tiny_dnn/evo/selector.h"
+
+namespace tiny_dnn {
+
+    /**
+     * Tournament selection: the fittest of k uniformly drawn candidates.
+     * O(k) per selection, nothing to build beyond a copy of the fitness.
+     */
+    class TournamentSelector : public Selector {
+    public:
+        /**
+         * @param size candidates per tournament, at least one.
+         */
+        explicit TournamentSelector(size_t size)
+            : mSize(std::max<size_t>(size, 1)) { }
+
+        void reset(const std::vector<float> & fitness) override {
+            mFitness = fitness;
+        }
+
+        size_t select(RandomStream & stream) const override {
+            const size_t count = mFitness.size();
+            size_t best = draw(stream, count);
+            for (size_t k = 1; k < mSize; k++) {
+                const size_t other = draw(stream, count);
+                if (mFitness[other] > mFitness[best]) {
+                    best = other;
+                }
+            }
+            return best;
+        }
+
+    private:
+        size_t mSize;
+        std::vector<float> mFitness;
+
+        static size_t draw(RandomStream & stream, size_t count) {
+            return std::min(count - 1,
+                            static_cast<size_t>(stream.getDouble() * count));
+        }
+    };
+
+    /**
+     * Linear rank selection. Candidates are weighted by rank rather than
+     * by fitness, the best getting pressure times the average weight and
+     * the worst 2 - pressure times it. Draws go through an alias table.
+     */
+    class RankSelector : public Selector {
+    public:
+        /**
+         * @param pressure in [1, 2], 1 is uniform.
+         */
+        explicit RankSelector(float pressure)
+            : mPressure(std::min(std::max(pressure, 1.0f), 2.0f)) { }
+
+        void reset(const std::vector<float> & fitness) override {
+            const size_t count = fitness.size();
+            mOrder.resize(count);
+            std::iota(mOrder.begin(), mOrder.end(), size_t(0));
+            std::sort(mOrder.begin(), mOrder.end(),
+                      [&fitness](size_t a, size_t b) {
+                          return fitness[a] > fitness[b];
+                      });
+
+            const double span = (count > 1) ? count - 1 : 1;
+            const double pressure = mPressure;
+            mTable.build(count, [&](size_t rank) {
+                return pressure - 2.0 * (pressure - 1.0) * rank / span;
+            });
+        }
+
+        size_t select(RandomStream & stream) const override {
+            return mOrder[mTable.sample(stream.getDouble())];
+        }
+
+    private:
+        float mPressure;
+        /// Candidate index by rank, best first.
+        std::vector<size_t> mOrder;
+        AliasTable mTable;
+    };
+
+    /**
+     * Selector named by params.selection.
+     * @param params
+     * @param random handed to the Roulette for its own spin().
+     * @return selector
+     */
+    inline std::unique_ptr<Selector> makeSelector(const EvoParams & params,
+                                                  Random * random) {
+        if (params.selection == "roulette") {
+            return std::unique_ptr<Selector>(new Roulette(random));
+        }
+        if (params.selection == "tournament") {
+            return std::unique_ptr<Selector>(
+                new TournamentSelector(params.tournament_size));
+        }
+        if (params.selection == "rank") {
+            return std::unique_ptr<Selector>(
+                new RankSelector(params.rank_pressure));
+        }
+        throw nn_error("Unknown selection scheme: " + params.selection);
+    }
+}
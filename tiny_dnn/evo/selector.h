@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include "tiny_dnn/config.h"
+#include "tiny_dnn/evo/random_stream.h"
+
+namespace tiny_dnn {
+
+    /**
+     * Common interface of the parent selection schemes.
+     * reset() is called once per generation with the fitness of every
+     * candidate, select() then picks candidates by index. select() doesn't
+     * modify the selector, so threads may call it concurrently, each with
+     * its own stream.
+     */
+    class Selector {
+    public:
+        virtual ~Selector() { }
+
+        /**
+         * Rebuild for a new set of candidates. Fitness must be positive.
+         * @param fitness one value per candidate, in any order.
+         */
+        virtual void reset(const std::vector<float> & fitness) = 0;
+
+        /**
+         * Pick a candidate.
+         * @param stream
+         * @return index into the fitness handed to reset().
+         */
+        virtual size_t select(RandomStream & stream) const = 0;
+    };
+
+    /**
+     * Walker's alias method, built with Vose's algorithm.
+     * O(n) to build, O(1) per draw from a discrete distribution.
+     */
+    class AliasTable {
+    public:
+        /**
+         * Build the table in place, reusing its storage.
+         * Falls back to a uniform distribution if the weights don't sum to
+         * a positive, finite value.
+         * @param count  number of outcomes.
+         * @param weight callable, weight(i) gives the weight of outcome i.
+         */
+        template <typename Func>
+        void build(size_t count, Func weight) {
+            mProb.resize(count);
+            mAlias.resize(count);
+            mScaled.resize(count);
+            mSmall.clear();
+            mLarge.clear();
+
+            double total = 0;
+            for (size_t i = 0; i < count; i++) {
+                mScaled[i] = weight(i);
+                total += mScaled[i];
+            }
+
+            const bool uniform = !(total > 0) || !std::isfinite(total);
+            for (size_t i = 0; i < count; i++) {
+                mScaled[i] = uniform ? 1.0 : mScaled[i] * count / total;
+                (mScaled[i] < 1.0 ? mSmall : mLarge).push_back(i);
+            }
+
+            while (!mSmall.empty() && !mLarge.empty()) {
+                const size_t less = mSmall.back();
+                const size_t more = mLarge.back();
+                mSmall.pop_back();
+                mLarge.pop_back();
+
+                mProb[less] = mScaled[less];
+                mAlias[less] = more;
+
+                mScaled[more] = (mScaled[more] + mScaled[less]) - 1.0;
+                (mScaled[more] < 1.0 ? mSmall : mLarge).push_back(more);
+            }
+
+            // Whatever is left is 1 up to rounding error.
+            for (size_t i : mLarge) {
+                mProb[i] = 1.0;
+                mAlias[i] = i;
+            }
+            for (size_t i : mSmall) {
+                mProb[i] = 1.0;
+                mAlias[i] = i;
+            }
+        }
+
+        /**
+         * Draw an outcome.
+         * @param r uniform in [0, 1).
+         * @return outcome
+         */
+        size_t sample(double r) const {
+            const double scaled = r * mProb.size();
+            size_t i = static_cast<size_t>(scaled);
+            if (i >= mProb.size()) {
+                // Guard for rounding error.
+                i = mProb.size() - 1;
+            }
+            return (scaled - i < mProb[i]) ? i : mAlias[i];
+        }
+
+        size_t size() const { return mProb.size(); }
+
+    private:
+        std::vector<double> mProb;
+        std::vector<size_t> mAlias;
+
+        // Build scratch, kept around to avoid reallocating every generation.
+        std::vector<double> mScaled;
+        std::vector<size_t> mSmall;
+        std::vector<size_t> mLarge;
+    };
+}
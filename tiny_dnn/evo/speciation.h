@@ -0,0 +1,309 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "tiny_dnn/config.h"
+#include "tiny_dnn/evo/eval_scheduler.h"
+#include "tiny_dnn/evo/genome_view.h"
+#include "tiny_dnn/util/product.h"
+#include "tiny_dnn/util/util.h"
+
+namespace tiny_dnn {
+
+    /**
+     * Groups a population into species by genome distance, for fitness
+     * sharing.
+     *
+     * Genomes are compared through sketches: a count sketch of the genes,
+     * where every gene adds its value, with a sign, to one of sketchSize
+     * buckets picked by a hash of its position. The squared distance of two
+     * sketches estimates the squared distance of the genomes, and is one
+     * vectorize::dot of sketchSize floats once the sketches' norms are
+     * known, however long the genomes.
+     *
+     * Each species has a representative sketch, its fittest member of the
+     * previous generation. An individual joins the first species whose
+     * representative is within threshold of it; otherwise it founds a new
+     * species, or joins the nearest one once max_species exist. Assigning
+     * costs population * species comparisons, never population squared.
+     *
+     * Distances are RMS per gene, ||a - b|| / sqrt(W), so the threshold
+     * doesn't depend on the genome length.
+     */
+    class Speciation {
+    public:
+        static const size_t sketchSize = 32;
+
+        /**
+         * @param population
+         * @param genome_length
+         * @param threshold   initial RMS gene distance within a species.
+         * @param target      species count the threshold is steered
+         *                    towards, 0 keeps it fixed.
+         * @param max_species
+         */
+        Speciation(size_t population, size_t genome_length, float threshold,
+                   size_t target, size_t max_species)
+            : mGenomeLength(genome_length), mThreshold(threshold),
+              mTarget(target), mMaxSpecies(std::max<size_t>(max_species, 1)),
+              mSketches(population * sketchSize), mNorms(population),
+              mSpecies(population), mShared(population),
+              mNearest(population), mCodes(genome_length) {
+            for (size_t k = 0; k < genome_length; k++) {
+                const uint64_t h = mix(k);
+                mCodes[k] = static_cast<uint8_t>((h % sketchSize)
+                                                 | ((h >> 32) & 0x80));
+            }
+        }
+
+        /**
+         * Sketch individual i's genome. Safe to call concurrently for
+         * different individuals.
+         * @param i
+         * @param genome
+         */
+        void sketch(size_t i, GenomeView genome) {
+            float_t * row = &mSketches[i * sketchSize];
+            std::fill(row, row + sketchSize, float_t(0));
+            for (size_t k = 0; k < genome.size(); k++) {
+                const uint8_t code = mCodes[k];
+                row[code & 0x7f] += (code & 0x80) ? -genome[k] : genome[k];
+            }
+            mNorms[i] = vectorize::dot(row, row, sketchSize);
+        }
+
+        /**
+         * Sort the sketched population into species and share fitness
+         * within them.
+         * @param fitness   one value per individual.
+         * @param scheduler
+         */
+        void speciate(const std::vector<float> & fitness,
+                      EvalScheduler & scheduler) {
+            const size_t population = mNorms.size();
+            const size_t known = mRepresentatives.size() / sketchSize;
+
+            // Against last generation's representatives, in parallel.
+            scheduler.run(population, 0, [&](size_t begin, size_t end, size_t) {
+                for (size_t i = begin; i < end; i++) {
+                    mSpecies[i] = none;
+                    mNearest[i] = Nearest();
+                    for (size_t s = 0; s < known; s++) {
+                        const float d = representativeDistance(i, s);
+                        if (d < mNearest[i].distance) {
+                            mNearest[i].distance = d;
+                            mNearest[i].species = s;
+                        }
+                        if (d <= mThreshold) {
+                            mSpecies[i] = s;
+                            break;
+                        }
+                    }
+                }
+            });
+
+            // The rest found new species, or join one, in population order.
+            for (size_t i = 0; i < population; i++) {
+                if (mSpecies[i] != none) {
+                    continue;
+                }
+                const size_t count = mRepresentatives.size() / sketchSize;
+                for (size_t s = known; s < count; s++) {
+                    const float d = representativeDistance(i, s);
+                    if (d < mNearest[i].distance) {
+                        mNearest[i].distance = d;
+                        mNearest[i].species = s;
+                    }
+                    if (d <= mThreshold) {
+                        mSpecies[i] = s;
+                        break;
+                    }
+                }
+                if (mSpecies[i] != none) {
+                    continue;
+                }
+                if (count < mMaxSpecies) {
+                    mSpecies[i] = count;
+                    addRepresentative(i);
+                }
+                else {
+                    mSpecies[i] = mNearest[i].species;
+                }
+            }
+
+            compact(fitness);
+
+            if (mTarget != 0) {
+                // Wider species when there are too many, narrower when
+                // too few.
+                if (mSizes.size() > mTarget) {
+                    mThreshold *= 1.1f;
+                }
+                else if (mSizes.size() < mTarget) {
+                    mThreshold /= 1.1f;
+                }
+            }
+        }
+
+        /**
+         * Forget the species, e.g. when the population was replaced.
+         */
+        void clear() {
+            mRepresentatives.clear();
+            mRepresentativeNorms.clear();
+            mSizes.clear();
+        }
+
+        size_t getRepresentativeCount() const {
+            return mRepresentativeNorms.size();
+        }
+
+        /**
+         * What the next generation's speciate() starts from, besides the
+         * threshold: the representatives' sketches, sketchSize values each,
+         * followed by their norms.
+         * @param state out.
+         */
+        void getState(std::vector<float_t> * state) const {
+            state->assign(mRepresentatives.begin(), mRepresentatives.end());
+            state->insert(state->end(), mRepresentativeNorms.begin(),
+                          mRepresentativeNorms.end());
+        }
+
+        /**
+         * Continue from a saved threshold and getState().
+         * @param threshold
+         * @param state
+         * @param count representatives in state.
+         */
+        void setState(float threshold, const float_t * state, size_t count) {
+            mThreshold = threshold;
+            mRepresentatives.assign(state, state + count * sketchSize);
+            mRepresentativeNorms.assign(state + count * sketchSize,
+                                        state + count * (sketchSize + 1));
+            mSizes.clear();
+        }
+
+        /// Per individual, its fitness divided by its species' size.
+        const std::vector<float> & getSharedFitness() const { return mShared; }
+
+        size_t getSpecies(size_t i) const { return mSpecies[i]; }
+
+        size_t getSpeciesCount() const { return mSizes.size(); }
+
+        size_t getLargestSpecies() const {
+            return mSizes.empty()
+                ? 0 : *std::max_element(mSizes.begin(), mSizes.end());
+        }
+
+        float getThreshold() const { return mThreshold; }
+
+        /**
+         * Estimated RMS gene distance between two sketched individuals.
+         * @param a
+         * @param b
+         * @return distance
+         */
+        float distance(size_t a, size_t b) const {
+            return rms(mNorms[a] + mNorms[b]
+                       - 2 * vectorize::dot(&mSketches[a * sketchSize],
+                                            &mSketches[b * sketchSize],
+                                            sketchSize));
+        }
+
+    private:
+        static const size_t none = std::numeric_limits<size_t>::max();
+
+        struct Nearest {
+            float distance = std::numeric_limits<float>::max();
+            size_t species = 0;
+        };
+
+        size_t mGenomeLength;
+        float mThreshold;
+        size_t mTarget;
+        size_t mMaxSpecies;
+
+        /// Per individual, sketchSize values and their squared norm.
+        vec_t mSketches;
+        std::vector<float_t> mNorms;
+        std::vector<size_t> mSpecies;
+        std::vector<float> mShared;
+        std::vector<Nearest> mNearest;
+
+        /// Per species, its representative's sketch and squared norm.
+        vec_t mRepresentatives;
+        std::vector<float_t> mRepresentativeNorms;
+        std::vector<size_t> mSizes;
+        std::vector<size_t> mRenumber;
+        std::vector<size_t> mFittest;
+
+        /// Per gene, its bucket and, in the top bit, its sign.
+        std::vector<uint8_t> mCodes;
+
+        static uint64_t mix(uint64_t z) {
+            z += 0x9e3779b97f4a7c15ULL;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        float rms(float_t squared) const {
+            return std::sqrt(std::max<float_t>(squared, 0)
+                             / std::max<size_t>(mGenomeLength, 1));
+        }
+
+        float representativeDistance(size_t i, size_t s) const {
+            return rms(mNorms[i] + mRepresentativeNorms[s]
+                       - 2 * vectorize::dot(&mSketches[i * sketchSize],
+                                            &mRepresentatives[s * sketchSize],
+                                            sketchSize));
+        }
+
+        void addRepresentative(size_t i) {
+            mRepresentatives.insert(mRepresentatives.end(),
+                                    mSketches.begin() + i * sketchSize,
+                                    mSketches.begin() + (i + 1) * sketchSize);
+            mRepresentativeNorms.push_back(mNorms[i]);
+        }
+
+        /**
+         * Drop empty species, share fitness, and make every species' fittest
+         * member its next representative.
+         */
+        void compact(const std::vector<float> & fitness) {
+            const size_t count = mRepresentativeNorms.size();
+            mSizes.assign(count, 0);
+            mFittest.assign(count, size_t(none));
+            for (size_t i = 0; i < mSpecies.size(); i++) {
+                const size_t s = mSpecies[i];
+                mSizes[s]++;
+                if (mFittest[s] == none || fitness[i] > fitness[mFittest[s]]) {
+                    mFittest[s] = i;
+                }
+            }
+
+            mRenumber.assign(count, size_t(none));
+            mRepresentatives.clear();
+            mRepresentativeNorms.clear();
+            size_t next = 0;
+            for (size_t s = 0; s < count; s++) {
+                if (mSizes[s] == 0) {
+                    continue;
+                }
+                mRenumber[s] = next;
+                mSizes[next++] = mSizes[s];
+                addRepresentative(mFittest[s]);
+            }
+            mSizes.resize(next);
+
+            for (size_t i = 0; i < mSpecies.size(); i++) {
+                mSpecies[i] = mRenumber[mSpecies[i]];
+                mShared[i] = fitness[i] / mSizes[mSpecies[i]];
+            }
+        }
+    };
+}
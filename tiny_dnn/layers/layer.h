@@ -743,7 +743,7 @@ class layer : public node {
   vec_t weights_diff_;
 
   template <typename T, typename Func>
-  inline void for_i(T size, Func f, size_t grainsize = 100) {
+  inline void for_i(T size, Func f, size_t grainsize = 1) {
     tiny_dnn::for_i(parallelize_, size, f, grainsize);
   }
 
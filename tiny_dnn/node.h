@@ -30,6 +30,7 @@ namespace tiny_dnn {
 class node;
 class layer;
 class edge;
+class pipeline_executor;
 
 typedef std::shared_ptr<edge> edgeptr_t;
 
@@ -68,6 +69,7 @@ class node : public std::enable_shared_from_this<node> {
                       layer *tail,
                       size_t head_index,
                       size_t tail_index);
+  friend class pipeline_executor;
 
   mutable std::vector<edgeptr_t> prev_;
   mutable std::vector<edgeptr_t> next_;
@@ -18,6 +18,7 @@
 
 #include "tiny_dnn/layers/layer.h"
 #include "tiny_dnn/optimizers/optimizer.h"
+#include "tiny_dnn/util/dag_scheduler.h"
 #include "tiny_dnn/util/util.h"
 
 namespace cereal {
@@ -359,6 +360,7 @@ class sequential : public nodes {
 
 /**
  * generic graph network
+ * independent branches are run concurrently, see schedule().
  * @todo not implemented
  **/
 class graph : public nodes {
@@ -378,9 +380,9 @@ class graph : public nodes {
       output_layers_[i]->set_out_grads(&reordered_grad[i], 1);
     }
 
-    for (auto l = nodes_.rbegin(); l != nodes_.rend(); l++) {
-      (*l)->backward();
-    }
+    // task i of the backward schedule is the i-th node from the end.
+    backward_schedule_.run(
+      [&](size_t i) { nodes_[nodes_.size() - 1 - i]->backward(); });
   }
 
   std::vector<tensor_t> forward(const std::vector<tensor_t> &in_data) override {
@@ -400,9 +402,7 @@ class graph : public nodes {
                                                 1);
     }
 
-    for (auto l : nodes_) {
-      l->forward();
-    }
+    forward_schedule_.run([&](size_t i) { nodes_[i]->forward(); });
     return merge_outs();
   }
 
@@ -446,6 +446,7 @@ class graph : public nodes {
     output_layers_ = output;
 
     setup(false);
+    schedule();
   }
 
  private:
@@ -537,6 +538,7 @@ class graph : public nodes {
     for (auto out : gc.out_nodes) {
       output_layers_.push_back(nodes_[out]);
     }
+    schedule();
 #else
     throw nn_error("TinyDNN was not built with Serialization support");
 #endif  // CNN_NO_SERIALIZATION
@@ -566,6 +568,47 @@ class graph : public nodes {
     return merged;
   }
 
+  /**
+   * dependencies between the nodes, so that independent branches run
+   * concurrently.
+   *
+   * forward, a node waits for the producers of its inputs. backward, it
+   * waits for the consumers of its outputs; and since the consumers of one
+   * edge all write their gradient into it, they also wait for each other,
+   * in the order the nodes ran one after another before.
+   */
+  void schedule() {
+    const size_t n = nodes_.size();
+    std::unordered_map<const node *, size_t> index;
+    for (size_t i = 0; i < n; i++) index[nodes_[i]] = i;
+
+    std::vector<std::vector<size_t>> fwd(n), bwd(n);
+    for (size_t i = 0; i < n; i++) {
+      for (auto &e : nodes_[i]->prev()) {
+        if (!e || index.find(e->prev()) == index.end()) continue;
+        fwd[i].push_back(index[e->prev()]);
+      }
+
+      for (auto &e : nodes_[i]->next()) {
+        if (!e) continue;
+        std::vector<size_t> consumers;
+        for (auto c : e->next()) {
+          if (index.find(c) != index.end()) consumers.push_back(index[c]);
+        }
+        std::sort(consumers.rbegin(), consumers.rend());
+        for (size_t k = 0; k < consumers.size(); k++) {
+          bwd[n - 1 - i].push_back(n - 1 - consumers[k]);
+          if (k > 0) {
+            bwd[n - 1 - consumers[k]].push_back(n - 1 - consumers[k - 1]);
+          }
+        }
+      }
+    }
+
+    forward_schedule_  = dag_scheduler(fwd);
+    backward_schedule_ = dag_scheduler(bwd);
+  }
+
   size_t find_index(const std::vector<node *> &nodes, layer *target) {
     for (size_t i = 0; i < nodes.size(); i++) {
       if (nodes[i] == static_cast<node *>(&*target)) return i;
@@ -574,6 +617,8 @@ class graph : public nodes {
   }
   std::vector<layer *> input_layers_;
   std::vector<layer *> output_layers_;
+  dag_scheduler forward_schedule_;
+  dag_scheduler backward_schedule_;
 };
 
 template <typename OutputArchive>
@@ -0,0 +1,240 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "tiny_dnn/network.h"
+#include "tiny_dnn/util/concurrency.h"
+#include "tiny_dnn/util/spsc_queue.h"
+#include "tiny_dnn/util/topology.h"
+
+namespace tiny_dnn {
+
+/**
+ * pipelined inference on a sequential network.
+ *
+ * the layers are split into contiguous stages of about the same estimated
+ * cost, and every stage runs on its own thread. predict() cuts the input
+ * into micro-batches which flow through the stages over bounded
+ * single-producer/single-consumer queues, so while one stage works on a
+ * micro-batch the previous stage already works on the next one. this pays
+ * off on deep, narrow networks, whose layers are too small to be split
+ * well by for_i.
+ *
+ * a stage thread runs its layers' loops inline. the first layer of every
+ * stage reads from an edge of its own while predict() runs, so that no two
+ * stages share a buffer; the network's own edges are put back afterwards.
+ * the network must not be used elsewhere during predict().
+ */
+class pipeline_executor {
+ public:
+  /**
+   * @param net            network to run, set up on the way.
+   * @param stages         threads, at most one per layer. 0 picks
+   *                       max_concurrency().
+   * @param micro_batch    samples per item flowing through the stages.
+   * @param queue_capacity micro-batches waiting between two stages at most.
+   * @param pin            pin the stage threads to cpus placed by
+   *                       cpu_topology.
+   */
+  explicit pipeline_executor(network<sequential> &net,
+                             size_t stages         = 0,
+                             size_t micro_batch    = 1,
+                             size_t queue_capacity = 2,
+                             bool pin              = worker_affinity())
+    : micro_batch_(std::max<size_t>(micro_batch, 1)),
+      queue_capacity_(std::max<size_t>(queue_capacity, 1)),
+      pin_(pin) {
+    for (auto l : net) {
+      l->setup(false);
+      layers_.push_back(l);
+    }
+    if (layers_.empty()) throw nn_error("pipeline of an empty network");
+
+    if (stages == 0) stages = max_concurrency();
+    partition(std::min(stages, layers_.size()));
+
+    for (size_t s = 0; s < this->stages(); s++) {
+      layer *head = layers_[bounds_[s]];
+      inputs_.push_back(std::make_shared<edge>(nullptr, head->in_shape()[0],
+                                               vector_type::data));
+    }
+  }
+
+  pipeline_executor(const pipeline_executor &) = delete;
+  pipeline_executor &operator=(const pipeline_executor &) = delete;
+
+  size_t stages() const { return bounds_.size() - 1; }
+
+  /**
+   * index of the first layer of each stage, followed by the depth of the
+   * network.
+   */
+  const std::vector<size_t> &bounds() const { return bounds_; }
+
+  /**
+   * outputs for a set of samples, the same as network::predict for each of
+   * them. the first exception thrown by a layer is rethrown here.
+   */
+  std::vector<vec_t> predict(const std::vector<vec_t> &in) {
+    const size_t items = (in.size() + micro_batch_ - 1) / micro_batch_;
+    std::vector<vec_t> out;
+    out.reserve(in.size());
+    if (items == 0) return out;
+
+    std::vector<std::unique_ptr<spsc_queue<tensor_t>>> queues;
+    for (size_t s = 0; s <= stages(); s++) {
+      queues.emplace_back(new spsc_queue<tensor_t>(queue_capacity_));
+    }
+
+    // the first layer of each stage reads from its stage's own edge.
+    std::vector<edgeptr_t> detached;
+    for (size_t s = 0; s < stages(); s++) {
+      detached.push_back(layers_[bounds_[s]]->prev_[0]);
+      layers_[bounds_[s]]->prev_[0] = inputs_[s];
+    }
+
+    failed_ = false;
+    std::vector<std::thread> threads;
+    for (size_t s = 0; s < stages(); s++) {
+      threads.emplace_back([this, s, items, &queues] {
+        run_stage(s, items, *queues[s], *queues[s + 1]);
+      });
+    }
+    if (pin_) {
+      pin_workers(threads, cpu_topology::detect().placement(stages()));
+    }
+
+    // feed micro-batches in and take results out until every item is back.
+    size_t sent = 0, received = 0;
+    bool loaded = false;
+    tensor_t batch, result;
+    while (received < items && !failed_.load()) {
+      if (sent < items) {
+        if (!loaded) {
+          size_t first = sent * micro_batch_;
+          size_t last  = std::min(first + micro_batch_, in.size());
+          batch.assign(in.begin() + first, in.begin() + last);
+          loaded = true;
+        }
+        if (queues.front()->try_push(batch)) {
+          sent++;
+          loaded = false;
+          continue;
+        }
+      }
+      if (queues.back()->try_pop(result)) {
+        out.insert(out.end(), result.begin(), result.end());
+        received++;
+        continue;
+      }
+      std::this_thread::yield();
+    }
+
+    for (auto &thread : threads) thread.join();
+    for (size_t s = 0; s < stages(); s++) {
+      layers_[bounds_[s]]->prev_[0] = detached[s];
+    }
+
+    if (failed_.load()) std::rethrow_exception(error_);
+    return out;
+  }
+
+ private:
+  /**
+   * cut the layers into stages of contiguous layers, every stage taking
+   * about the same share of the total cost.
+   */
+  void partition(size_t stages) {
+    std::vector<double> prefix(layers_.size() + 1, 0);
+    for (size_t i = 0; i < layers_.size(); i++) {
+      prefix[i + 1] = prefix[i] + cost(*layers_[i]);
+    }
+
+    bounds_.assign(1, 0);
+    for (size_t s = 1; s < stages; s++) {
+      double target = prefix.back() * s / stages;
+      size_t i      = bounds_.back() + 1;
+      // leave at least one layer for each stage still to come.
+      while (i < layers_.size() - (stages - s) && prefix[i] < target) i++;
+      bounds_.push_back(i);
+    }
+    bounds_.push_back(layers_.size());
+  }
+
+  /**
+   * rough multiply-adds per sample: a layer with weights does fan-in of
+   * them for every output, others touch each output once.
+   */
+  static double cost(const layer &l) {
+    double outputs = static_cast<double>(l.out_shape()[0].size());
+    if (l.weights().empty()) return outputs;
+    return outputs * static_cast<double>(l.fan_in_size());
+  }
+
+  void run_stage(size_t s,
+                 size_t items,
+                 spsc_queue<tensor_t> &in,
+                 spsc_queue<tensor_t> &out) {
+    parallel_region region;
+    try {
+      layer *head = layers_[bounds_[s]];
+      layer *tail = layers_[bounds_[s + 1] - 1];
+      tensor_t item;
+      for (size_t i = 0; i < items; i++) {
+        if (!wait([&] { return in.try_pop(item); })) return;
+
+        // the previous stage's buffer goes back into circulation.
+        std::swap(*head->prev_[0]->get_data(), item);
+        for (size_t l = bounds_[s]; l < bounds_[s + 1]; l++) {
+          layers_[l]->forward();
+        }
+        item = *tail->next_[0]->get_data();
+
+        if (!wait([&] { return out.try_push(item); })) return;
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!failed_.load()) error_ = std::current_exception();
+      failed_ = true;
+    }
+  }
+
+  /**
+   * poll until ready() succeeds.
+   * @return false if another stage failed meanwhile.
+   */
+  template <typename Pred>
+  bool wait(const Pred &ready) {
+    while (!ready()) {
+      if (failed_.load()) return false;
+      std::this_thread::yield();
+    }
+    return true;
+  }
+
+  size_t micro_batch_;
+  size_t queue_capacity_;
+  bool pin_;
+  std::vector<layer *> layers_;
+  std::vector<size_t> bounds_;
+  /// input edge of the first layer of each stage.
+  std::vector<edgeptr_t> inputs_;
+  std::atomic<bool> failed_;
+  std::exception_ptr error_;
+  std::mutex mutex_;
+};
+
+}  // namespace tiny_dnn
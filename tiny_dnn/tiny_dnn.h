@@ -10,6 +10,7 @@
 #include "tiny_dnn/config.h"
 #include "tiny_dnn/network.h"
 #include "tiny_dnn/nodes.h"
+#include "tiny_dnn/pipeline.h"
 
 #include "tiny_dnn/core/framework/tensor.h"
 
@@ -60,6 +61,7 @@
 #include "tiny_dnn/util/deform.h"
 #include "tiny_dnn/util/graph_visualizer.h"
 #include "tiny_dnn/util/product.h"
+#include "tiny_dnn/util/topology.h"
 #include "tiny_dnn/util/weight_init.h"
 
 #include "tiny_dnn/io/cifar10_parser.h"
@@ -0,0 +1,108 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+namespace tiny_dnn {
+
+namespace detail {
+
+inline std::atomic<size_t> &concurrency_budget() {
+  static std::atomic<size_t> budget(
+    std::max<size_t>(std::thread::hardware_concurrency(), 1));
+  return budget;
+}
+
+/// concurrency_share of the current thread, 0 for none.
+inline size_t &concurrency_cap() {
+  static thread_local size_t cap = 0;
+  return cap;
+}
+
+}  // namespace detail
+
+/**
+ * most threads a single parallel_for of the built-in backends (the thread
+ * pool, std::async) and OpenMP splits its range over. on a thread holding
+ * a concurrency_share, at most its share.
+ */
+inline size_t max_concurrency() {
+  size_t budget = detail::concurrency_budget().load();
+  size_t cap    = detail::concurrency_cap();
+  return cap != 0 ? std::min(budget, cap) : budget;
+}
+
+/**
+ * change the budget, e.g. to leave cores to other work running next to
+ * tiny-dnn. 0 restores one thread per core.
+ */
+inline void set_max_concurrency(size_t threads) {
+  detail::concurrency_budget().store(
+    threads != 0 ? threads
+                 : std::max<size_t>(std::thread::hardware_concurrency(), 1));
+}
+
+/**
+ * marks the current thread as busy inside a parallel loop for as long as
+ * it's alive. parallel_for issued from such a thread, e.g. a layer's
+ * for_i inside a block of an outer loop or on a thread of the caller's own
+ * pool, runs inline instead of asking other threads for help.
+ */
+class parallel_region {
+ public:
+  parallel_region() { ++depth(); }
+  ~parallel_region() { --depth(); }
+
+  parallel_region(const parallel_region &) = delete;
+  parallel_region &operator=(const parallel_region &) = delete;
+
+  /// true when the current thread is inside a parallel loop.
+  static bool active() { return depth() != 0; }
+
+ private:
+  friend class concurrency_share;
+
+  static size_t &depth() {
+    static thread_local size_t depth = 0;
+    return depth;
+  }
+};
+
+/**
+ * hands the current thread a share of the budget for as long as it's
+ * alive, for work running side by side with other work of the same loop,
+ * e.g. independent branches of a graph. loops issued from the thread may
+ * split again, even inside a parallel_region, but over at most threads
+ * threads. the thread pool still runs them inline while it is busy with
+ * the outer loop.
+ */
+class concurrency_share {
+ public:
+  explicit concurrency_share(size_t threads)
+    : cap_(detail::concurrency_cap()), depth_(parallel_region::depth()) {
+    detail::concurrency_cap() = std::max<size_t>(threads, 1);
+    parallel_region::depth()  = 0;
+  }
+  ~concurrency_share() {
+    detail::concurrency_cap() = cap_;
+    parallel_region::depth()  = depth_;
+  }
+
+  concurrency_share(const concurrency_share &) = delete;
+  concurrency_share &operator=(const concurrency_share &) = delete;
+
+ private:
+  size_t cap_;
+  size_t depth_;
+};
+
+}  // namespace tiny_dnn
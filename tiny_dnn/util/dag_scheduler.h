@@ -0,0 +1,197 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+#include "concurrency.h"
+#include "nn_error.h"
+#include "parallel_for.h"
+
+namespace tiny_dnn {
+
+/**
+ * runs the tasks of a dependency graph, each once all the tasks it
+ * depends on have returned.
+ *
+ * while a single task is ready, the calling thread runs it by itself, so
+ * the loops inside it still get the whole max_concurrency() budget. when
+ * two or more are ready, e.g. at the fork of independent branches, workers
+ * (parallel_for blocks on the backend in use) take ready tasks from a
+ * shared list, and each task runs with an even share of the budget for
+ * the branches in flight. once the graph narrows to a single ready task
+ * again, the workers return and the calling thread goes on alone.
+ *
+ * a worker never waits for a particular other worker, so any number of them
+ * finishes the graph, even one running alone. a graph without two tasks
+ * that can ever run at once, or one run from inside a parallel loop, runs
+ * on the calling thread in a fixed topological order: smallest index
+ * first.
+ */
+class dag_scheduler {
+ public:
+  dag_scheduler() : width_(0) {}
+
+  /**
+   * @param deps deps[i] lists the tasks task i waits for.
+   */
+  explicit dag_scheduler(const std::vector<std::vector<size_t>> &deps)
+    : pending_(deps.size(), 0), next_(deps.size()), width_(0) {
+    for (size_t i = 0; i < deps.size(); i++) {
+      std::vector<size_t> unique = deps[i];
+      std::sort(unique.begin(), unique.end());
+      unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+      for (size_t d : unique) {
+        if (d >= deps.size() || d == i) throw nn_error("invalid dependency");
+        next_[d].push_back(i);
+      }
+      pending_[i] = unique.size();
+    }
+
+    // topological order, and the number of tasks on each level: tasks at
+    // the same distance from the roots never depend on each other.
+    std::vector<size_t> pending = pending_;
+    std::vector<size_t> level(size(), 0), per_level;
+    std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>>
+      ready;
+    for (size_t i = 0; i < size(); i++) {
+      if (pending[i] == 0) ready.push(i);
+    }
+    while (!ready.empty()) {
+      size_t task = ready.top();
+      ready.pop();
+      order_.push_back(task);
+      if (per_level.size() <= level[task]) per_level.resize(level[task] + 1);
+      width_ = std::max(width_, ++per_level[level[task]]);
+      for (size_t succ : next_[task]) {
+        level[succ] = std::max(level[succ], level[task] + 1);
+        if (--pending[succ] == 0) ready.push(succ);
+      }
+    }
+    if (order_.size() != size()) throw nn_error("cyclic dependencies");
+  }
+
+  size_t size() const { return pending_.size(); }
+
+  /// most tasks on one level of the graph, a bound on useful workers.
+  size_t width() const { return width_; }
+
+  /**
+   * call f(task) for every task, in dependency order. the first exception
+   * thrown by f is rethrown here, tasks not started by then are skipped.
+   */
+  template <typename Func>
+  void run(const Func &f) const {
+    const size_t budget = max_concurrency();
+    if (std::min(width_, budget) < 2 || parallel_region::active()) {
+      for (size_t task : order_) f(task);
+      return;
+    }
+
+    state st(pending_);
+    for (size_t i = size(); i-- > 0;) {
+      if (pending_[i] == 0) st.ready.push_back(i);
+    }
+
+    while (!st.ready.empty()) {
+      if (st.ready.size() == 1) {
+        size_t task = st.ready.back();
+        st.ready.pop_back();
+        f(task);
+        finish(st, task);
+        continue;
+      }
+
+      for_i(true, std::min(width_, budget),
+            [&](size_t) { branch_worker(st, budget, f); });
+      if (st.failed) std::rethrow_exception(st.error);
+    }
+  }
+
+ private:
+  /// progress of one run(), guarded by mutex.
+  struct state {
+    explicit state(const std::vector<size_t> &pending)
+      : pending(pending), running(0), failed(false) {}
+
+    std::vector<size_t> pending;
+    std::vector<size_t> ready;
+    size_t running;
+    bool failed;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable changed;
+  };
+
+  /// make ready the successors of task left without dependencies.
+  void finish(state &st, size_t task) const {
+    for (size_t succ : next_[task]) {
+      if (--st.pending[succ] == 0) st.ready.push_back(succ);
+    }
+  }
+
+  /**
+   * take ready tasks until the graph narrows back to a single ready task
+   * with none running, or a task fails.
+   */
+  template <typename Func>
+  void branch_worker(state &st, size_t budget, const Func &f) const {
+    std::unique_lock<std::mutex> lock(st.mutex);
+    for (;;) {
+      if (st.failed || (st.running == 0 && st.ready.size() <= 1)) {
+        st.changed.notify_all();
+        return;
+      }
+      if (st.ready.empty()) {
+        st.changed.wait(lock);
+        continue;
+      }
+
+      size_t task = st.ready.back();
+      st.ready.pop_back();
+      st.running++;
+      // an even share for this branch and those in flight or about to be.
+      size_t share = budget / (st.running + st.ready.size());
+      lock.unlock();
+
+      std::exception_ptr error;
+      try {
+        concurrency_share scope(share);
+        f(task);
+      } catch (...) {
+        error = std::current_exception();
+      }
+
+      lock.lock();
+      st.running--;
+      if (error) {
+        if (!st.failed) st.error = error;
+        st.failed = true;
+      } else {
+        finish(st, task);
+      }
+      st.changed.notify_all();
+    }
+  }
+
+  /// unfinished dependencies of each task before a run.
+  std::vector<size_t> pending_;
+  /// tasks depending on each task.
+  std::vector<std::vector<size_t>> next_;
+  std::vector<size_t> order_;
+  size_t width_;
+};
+
+}  // namespace tiny_dnn
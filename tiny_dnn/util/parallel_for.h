@@ -7,6 +7,7 @@
 */
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <limits>
@@ -15,6 +16,7 @@
 #include <vector>
 
 #include "aligned_allocator.h"
+#include "concurrency.h"
 #include "nn_error.h"
 #include "tiny_dnn/config.h"
 
@@ -31,12 +33,42 @@
 #include <thread>
 #endif
 
+#if defined(CNN_USE_THREAD_POOL) && !defined(CNN_SINGLE_THREAD)
+#include "thread_pool.h"
+#endif
+
 #if defined(CNN_USE_GCD) && !defined(CNN_SINGLE_THREAD)
 #include <dispatch/dispatch.h>
 #endif
 
 namespace tiny_dnn {
 
+namespace detail {
+
+/**
+ * iterations per block when count iterations are split over threads:
+ * even blocks, one per thread, but as few as it takes for every block to
+ * hold at least grainsize iterations.
+ */
+inline size_t block_size(size_t count, size_t grainsize, size_t threads) {
+  size_t blocks = std::min(threads, count / std::max<size_t>(grainsize, 1));
+  blocks        = std::max<size_t>(blocks, 1);
+  return (count + blocks - 1) / blocks;
+}
+
+/**
+ * grain handed to the TBB and GCD schedulers, which split ranges on their
+ * own: the 100 iterations for_ defaulted to before its grainsize became 1,
+ * or more if the caller asks for it. ranges no longer than that are split
+ * one iteration at a time, as they always were.
+ */
+inline size_t scheduler_grain(size_t count, size_t grainsize) {
+  size_t grain = std::max<size_t>(grainsize, 100);
+  return count > grain ? grain : 1;
+}
+
+}  // namespace detail
+
 #ifdef CNN_USE_TBB
 
 static tbb::task_scheduler_init tbbScheduler(
@@ -47,8 +79,10 @@ typedef tbb::blocked_range<size_t> blocked_range;
 template <typename Func>
 void parallel_for(size_t begin, size_t end, const Func &f, size_t grainsize) {
   assert(end >= begin);
+  if (begin == end) return;
   tbb::parallel_for(
-    blocked_range(begin, end, end - begin > grainsize ? grainsize : 1), f);
+    blocked_range(begin, end, detail::scheduler_grain(end - begin, grainsize)),
+    f);
 }
 
 template <typename Func>
@@ -86,7 +120,8 @@ void parallel_for(size_t begin,
                   const Func &f,
                   size_t /*grainsize*/) {
   assert(end >= begin);
-#pragma omp parallel for
+  int nthreads = static_cast<int>(max_concurrency());
+#pragma omp parallel for num_threads(nthreads)
   for (size_t i = begin; i < end; ++i) f(blocked_range(i, i + 1));
 }
 
@@ -95,17 +130,15 @@ void parallel_for(size_t begin,
 template <typename Func>
 void parallel_for(size_t begin, size_t end, const Func &f, size_t grainsize) {
   assert(end >= begin);
-  size_t count     = end - begin;
-  size_t blockSize = grainsize;
-  if (count < blockSize || blockSize == 0) {
-    blockSize = 1;
-  }
+  size_t count = end - begin;
+  if (count == 0) return;
+  size_t blockSize  = detail::scheduler_grain(count, grainsize);
   size_t blockCount = (count + blockSize - 1) / blockSize;
   assert(blockCount > 0);
 
   dispatch_apply(blockCount, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0),
                  ^(size_t block) {
-                   size_t blockStart = block * blockSize;
+                   size_t blockStart = begin + block * blockSize;
                    size_t blockEnd   = blockStart + blockSize;
                    if (blockEnd > end) {
                      blockEnd = end;
@@ -126,17 +159,43 @@ void parallel_for(size_t begin,
   xparallel_for(begin, end, f);
 }
 
+#elif defined(CNN_USE_THREAD_POOL)
+
+template <typename Func>
+void parallel_for(size_t begin, size_t end, const Func &f, size_t grainsize) {
+  assert(end >= begin);
+  if (begin == end) return;
+  if (parallel_region::active()) {
+    f(blocked_range(begin, end));
+    return;
+  }
+
+  thread_pool &pool = thread_pool::instance();
+  size_t count      = end - begin;
+  size_t blockSize  = detail::block_size(
+    count, grainsize, std::min(pool.size(), max_concurrency()));
+  size_t blockCount = (count + blockSize - 1) / blockSize;
+
+  pool.run(blockCount, [begin, end, blockSize, &f](size_t block) {
+    size_t blockBegin = begin + block * blockSize;
+    size_t blockEnd   = std::min(blockBegin + blockSize, end);
+    f(blocked_range(blockBegin, blockEnd));
+  });
+}
+
 #else
 
 template <typename Func>
-void parallel_for(size_t begin,
-                  size_t end,
-                  const Func &f,
-                  size_t /*grainsize*/) {
+void parallel_for(size_t begin, size_t end, const Func &f, size_t grainsize) {
   assert(end >= begin);
-  size_t nthreads  = std::thread::hardware_concurrency();
-  size_t blockSize = (end - begin) / nthreads;
-  if (blockSize * nthreads < end - begin) blockSize++;
+  if (begin == end) return;
+  size_t blockSize =
+    detail::block_size(end - begin, grainsize, max_concurrency());
+  if (parallel_region::active() || blockSize >= end - begin) {
+    f(blocked_range(begin, end));
+    return;
+  }
+  size_t nthreads = (end - begin + blockSize - 1) / blockSize;
 
   std::vector<std::future<void> > futures;
 
@@ -147,6 +206,7 @@ void parallel_for(size_t begin,
   for (size_t i = 0; i < nthreads; i++) {
     futures.push_back(
       std::move(std::async(std::launch::async, [blockBegin, blockEnd, &f] {
+        parallel_region region;
         f(blocked_range(blockBegin, blockEnd));
       })));
 
@@ -168,9 +228,16 @@ bool value_representation(U const &value) {
   return static_cast<U>(static_cast<T>(value)) == value;
 }
 
+/**
+ * run f over blocked ranges covering [begin, end), in parallel if asked to.
+ * grainsize is the fewest iterations worth handing to another thread. the
+ * built-in backends split the range into at most max_concurrency() blocks,
+ * none of them smaller than that; TBB and GCD are handed a grain of at
+ * least 100 iterations and split the range themselves.
+ */
 template <typename T, typename Func>
 inline void for_(
-  bool parallelize, size_t begin, T end, Func f, size_t grainsize = 100) {
+  bool parallelize, size_t begin, T end, Func f, size_t grainsize = 1) {
   static_assert(std::is_integral<T>::value, "end must be integral type");
   parallelize = parallelize && value_representation<size_t>(end);
   parallelize ? parallel_for(begin, end, f, grainsize)
@@ -178,7 +245,7 @@ inline void for_(
 }
 
 template <typename T, typename Func>
-inline void for_i(bool parallelize, T size, Func f, size_t grainsize = 100u) {
+inline void for_i(bool parallelize, T size, Func f, size_t grainsize = 1u) {
 #ifdef CNN_SINGLE_THREAD
   for (size_t i = 0; i < size; ++i) {
     f(i);
@@ -198,7 +265,7 @@ inline void for_i(bool parallelize, T size, Func f, size_t grainsize = 100u) {
 }
 
 template <typename T, typename Func>
-inline void for_i(T size, Func f, size_t grainsize = 100) {
+inline void for_i(T size, Func f, size_t grainsize = 1) {
   for_i(true, size, f, grainsize);
 }
 
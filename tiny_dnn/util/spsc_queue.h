@@ -0,0 +1,73 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace tiny_dnn {
+
+/**
+ * bounded queue between exactly one producer thread and one consumer
+ * thread. a ring of slots with an atomic head and tail, so neither side
+ * ever takes a lock; both sides poll, try_push on a full queue and try_pop
+ * on an empty one just return false.
+ *
+ * items are moved in and swapped out, so buffers travel with them instead
+ * of being reallocated on every push.
+ */
+template <typename T>
+class spsc_queue {
+ public:
+  /// @param capacity items the queue holds at most, at least 1.
+  explicit spsc_queue(size_t capacity)
+    : slots_(capacity + 1), head_(0), tail_(0) {}
+
+  spsc_queue(const spsc_queue &) = delete;
+  spsc_queue &operator=(const spsc_queue &) = delete;
+
+  size_t capacity() const { return slots_.size() - 1; }
+
+  /**
+   * producer side.
+   * @return false if the queue is full; item is left untouched.
+   */
+  bool try_push(T &item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t next = tail + 1 == slots_.size() ? 0 : tail + 1;
+    if (next == head_.load(std::memory_order_acquire)) return false;
+    std::swap(slots_[tail], item);
+    tail_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * consumer side. the popped item is swapped into item, which hands the
+   * old contents of item back to the producer to be reused.
+   * @return false if the queue is empty.
+   */
+  bool try_pop(T &item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) return false;
+    std::swap(slots_[head], item);
+    head_.store(head + 1 == slots_.size() ? 0 : head + 1,
+                std::memory_order_release);
+    return true;
+  }
+
+ private:
+  std::vector<T> slots_;
+  std::atomic<size_t> head_;
+  // keeps the consumer's and the producer's index on separate cache lines.
+  char pad_[64];
+  std::atomic<size_t> tail_;
+};
+
+}  // namespace tiny_dnn
@@ -0,0 +1,208 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "concurrency.h"
+#include "topology.h"
+
+namespace tiny_dnn {
+
+/**
+ * Persistent workers for parallel_for (CNN_USE_THREAD_POOL).
+ *
+ * The workers are started once and wait for jobs, so a parallel_for costs
+ * a wake-up instead of creating threads. A job is a number of blocks;
+ * workers and the calling thread claim blocks from an atomic counter, with
+ * no lock on the way. Idle workers spin for a while, then park on a
+ * condition variable.
+ *
+ * One job runs at a time. A job posted while another is running, e.g. from
+ * another thread, runs on its caller. Blocks run inside a parallel_region,
+ * so loops nested in them run inline.
+ */
+class thread_pool {
+ public:
+  /**
+   * @param threads total, including the thread calling run().
+   * @param pin     pin the workers to cpus placed by cpu_topology; the
+   *                calling thread keeps its own affinity.
+   */
+  explicit thread_pool(size_t threads, bool pin = false)
+    : current_(nullptr),
+      active_(0),
+      epoch_(0),
+      sleeping_(0),
+      busy_(false),
+      stop_(false),
+      unpinned_(0) {
+    for (size_t i = 1; i < threads; i++) {
+      workers_.emplace_back([this] { work(); });
+    }
+    if (pin && !workers_.empty()) {
+      std::vector<int> cpus = cpu_topology::detect().placement(threads);
+      cpus.erase(cpus.begin());  // the calling thread's
+      unpinned_ = pin_workers(workers_, cpus);
+    }
+  }
+
+  ~thread_pool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto &worker : workers_) worker.join();
+  }
+
+  thread_pool(const thread_pool &) = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
+
+  /**
+   * pool shared by every parallel_for, one thread per core, pinned if
+   * set_worker_affinity(true) was called before its first use.
+   */
+  static thread_pool &instance() {
+    static thread_pool pool(
+      std::max<size_t>(std::thread::hardware_concurrency(), 1),
+      worker_affinity());
+    return pool;
+  }
+
+  /// threads taking part in a job, the caller included.
+  size_t size() const { return workers_.size() + 1; }
+
+  /// workers that were to be pinned but couldn't be.
+  size_t unpinned() const { return unpinned_; }
+
+  /**
+   * call f(block) for every block in [0, blocks), and return once all
+   * calls returned. the first exception thrown by a block is rethrown
+   * here, blocks not started by then are skipped.
+   */
+  template <typename Func>
+  void run(size_t blocks, const Func &f) {
+    bool idle = false;
+    if (blocks < 2 || workers_.empty() ||
+        !busy_.compare_exchange_strong(idle, true)) {
+      parallel_region region;
+      for (size_t b = 0; b < blocks; b++) f(b);
+      return;
+    }
+
+    job j;
+    j.invoke = [](const void *fn, size_t block) {
+      (*static_cast<const Func *>(fn))(block);
+    };
+    j.fn     = &f;
+    j.blocks = blocks;
+    j.next   = 0;
+    j.failed = false;
+
+    current_.store(&j);
+    epoch_.fetch_add(1);
+    if (sleeping_.load() > 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      wake_.notify_all();
+    }
+
+    j.execute();
+
+    // every block is claimed; wait for the workers still running one.
+    current_.store(nullptr);
+    while (active_.load() != 0) std::this_thread::yield();
+    busy_.store(false);
+
+    if (j.failed.load()) std::rethrow_exception(j.error);
+  }
+
+ private:
+  struct job {
+    void (*invoke)(const void *, size_t);
+    const void *fn;
+    size_t blocks;
+    std::atomic<size_t> next;
+    std::atomic<bool> failed;
+    std::exception_ptr error;
+
+    void execute() {
+      parallel_region region;
+      try {
+        for (size_t b = next.fetch_add(1); b < blocks;
+             b        = next.fetch_add(1)) {
+          invoke(fn, b);
+        }
+      } catch (...) {
+        bool first = false;
+        if (failed.compare_exchange_strong(first, true)) {
+          error = std::current_exception();
+        }
+        next.store(blocks);
+      }
+    }
+  };
+
+  /// polls of epoch_ before a worker parks.
+  static const int spin_count = 1 << 14;
+
+  void work() {
+    uint64_t seen = epoch_.load();
+    for (;;) {
+      if (!wait(seen)) return;
+      seen = epoch_.load();
+
+      // active_ goes up before current_ is read, so run() can't return
+      // while the job it points to is still in use.
+      active_.fetch_add(1);
+      job *j = current_.load();
+      if (j != nullptr) j->execute();
+      active_.fetch_sub(1);
+    }
+  }
+
+  /**
+   * wait for a job newer than seen.
+   * @return false once the pool is shutting down.
+   */
+  bool wait(uint64_t seen) {
+    for (int i = 0; i < spin_count; i++) {
+      if (epoch_.load(std::memory_order_relaxed) != seen) return true;
+      if (stop_.load(std::memory_order_relaxed)) return false;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    sleeping_.fetch_add(1);
+    wake_.wait(lock, [&] { return stop_.load() || epoch_.load() != seen; });
+    sleeping_.fetch_sub(1);
+    return !stop_.load();
+  }
+
+  std::atomic<job *> current_;
+  /// workers inside a job.
+  std::atomic<size_t> active_;
+  /// bumped for every job, workers wait for it to change.
+  std::atomic<uint64_t> epoch_;
+  std::atomic<size_t> sleeping_;
+  std::atomic<bool> busy_;
+  std::atomic<bool> stop_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::vector<std::thread> workers_;
+  size_t unpinned_;
+};
+
+}  // namespace tiny_dnn
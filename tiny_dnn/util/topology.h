@@ -0,0 +1,290 @@
+/*
+    Copyright (c) 2013, Taiga Nomi and the respective contributors
+    All rights reserved.
+
+    Use of this source code is governed by a BSD-style license that can be found
+    in the LICENSE file.
+*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nn_error.h"
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace tiny_dnn {
+
+/**
+ * cpus of the machine grouped by NUMA node, read from Linux sysfs.
+ *
+ * used to place worker threads: placement() spreads workers over the
+ * nodes in contiguous groups, so that the workers sharing a node also
+ * share the replicas and activations they first-touched there. elsewhere,
+ * or when sysfs can't be read, the machine is one node of
+ * hardware_concurrency() cpus.
+ */
+class cpu_topology {
+ public:
+  cpu_topology() {
+    std::vector<int> cpus(
+      std::max<size_t>(std::thread::hardware_concurrency(), 1));
+    for (size_t i = 0; i < cpus.size(); i++) cpus[i] = static_cast<int>(i);
+    nodes_.push_back(cpus);
+  }
+
+  /**
+   * topology of this machine as far as this process may run, read once.
+   */
+  static const cpu_topology &detect() {
+    static const cpu_topology topology =
+      from_sysfs("/sys/devices/system", allowed_cpus());
+    return topology;
+  }
+
+  /**
+   * read a sysfs tree (node<N>/cpulist under root/node), keeping only the
+   * cpus listed in root/cpu/online and, unless it is empty, in allowed.
+   * @param root    e.g. /sys/devices/system
+   * @param allowed e.g. allowed_cpus()
+   */
+  static cpu_topology from_sysfs(const std::string &root,
+                                 std::vector<int> allowed = {}) {
+    cpu_topology topology;
+#if defined(__linux__)
+    std::vector<int> online = parse_cpulist(read_line(root + "/cpu/online"));
+    std::sort(online.begin(), online.end());
+    std::sort(allowed.begin(), allowed.end());
+    auto usable = [&](int cpu) {
+      return (online.empty() ||
+              std::binary_search(online.begin(), online.end(), cpu)) &&
+             (allowed.empty() ||
+              std::binary_search(allowed.begin(), allowed.end(), cpu));
+    };
+
+    std::vector<int> ids;
+    if (DIR *dir = opendir((root + "/node").c_str())) {
+      while (dirent *entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+            name.find_first_not_of("0123456789", 4) == std::string::npos) {
+          ids.push_back(std::stoi(name.substr(4)));
+        }
+      }
+      closedir(dir);
+    }
+    std::sort(ids.begin(), ids.end());
+
+    std::vector<std::vector<int>> nodes;
+    for (int id : ids) {
+      std::vector<int> cpus = parse_cpulist(
+        read_line(root + "/node/node" + std::to_string(id) + "/cpulist"));
+      cpus.erase(std::remove_if(cpus.begin(), cpus.end(),
+                                [&](int cpu) { return !usable(cpu); }),
+                 cpus.end());
+      if (!cpus.empty()) nodes.push_back(cpus);
+    }
+
+    if (nodes.empty()) {
+      // no NUMA information: a single node of every usable cpu.
+      std::vector<int> cpus = online.empty() ? allowed : online;
+      cpus.erase(std::remove_if(cpus.begin(), cpus.end(),
+                                [&](int cpu) { return !usable(cpu); }),
+                 cpus.end());
+      if (!cpus.empty()) nodes.push_back(cpus);
+    }
+    if (!nodes.empty()) topology.nodes_ = nodes;
+#else
+    (void)root;
+    (void)allowed;
+#endif
+    return topology;
+  }
+
+  /**
+   * cpus in the affinity mask of this process, e.g. as narrowed by taskset
+   * or a cgroup cpuset. empty where that can't be told.
+   */
+  static std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+      for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+      }
+    }
+#endif
+    return cpus;
+  }
+
+  /**
+   * "0-3,8,10-11" style list, as in sysfs, to cpu numbers.
+   */
+  static std::vector<int> parse_cpulist(const std::string &list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+      if (range.find_first_of("0123456789") == std::string::npos) continue;
+      size_t dash = range.find('-');
+      int first   = std::stoi(range.substr(0, dash));
+      int last =
+        dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+      for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+    }
+    return cpus;
+  }
+
+  size_t node_count() const { return nodes_.size(); }
+
+  const std::vector<int> &cpus(size_t node) const { return nodes_[node]; }
+
+  size_t cpu_count() const {
+    size_t count = 0;
+    for (auto &node : nodes_) count += node.size();
+    return count;
+  }
+
+  /**
+   * node of each of workers threads: contiguous groups, as even as the
+   * nodes allow.
+   */
+  std::vector<size_t> worker_nodes(size_t workers) const {
+    std::vector<size_t> nodes(workers);
+    for (size_t w = 0; w < workers; w++) {
+      nodes[w] = w * nodes_.size() / workers;
+    }
+    return nodes;
+  }
+
+  /**
+   * cpu for each of workers threads. workers of a node take its cpus in
+   * turn.
+   *
+   * several thread groups sharing the machine, e.g. one per island, each
+   * take their slice of a single placement so that they don't pin onto the
+   * same cpus: group g of n groups of t threads passes first = g * t and
+   * total = n * t.
+   * @param workers threads to place.
+   * @param first   index of the first of them among total.
+   * @param total   threads placed together, 0 for first + workers.
+   */
+  std::vector<int> placement(size_t workers,
+                             size_t first = 0,
+                             size_t total = 0) const {
+    total = std::max(total, first + workers);
+    std::vector<size_t> nodes = worker_nodes(total);
+    std::vector<int> cpus(total);
+    std::vector<size_t> used(nodes_.size(), 0);
+    for (size_t w = 0; w < total; w++) {
+      const std::vector<int> &node = nodes_[nodes[w]];
+      cpus[w] = node[used[nodes[w]]++ % node.size()];
+    }
+    return std::vector<int>(cpus.begin() + first,
+                            cpus.begin() + first + workers);
+  }
+
+ private:
+  std::vector<std::vector<int>> nodes_;
+
+  static std::string read_line(const std::string &path) {
+    std::ifstream ifs(path.c_str());
+    std::string line;
+    std::getline(ifs, line);
+    return line;
+  }
+};
+
+namespace detail {
+
+#if defined(__linux__)
+inline bool pin_thread(pthread_t thread, int cpu) {
+  if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+#endif
+
+}  // namespace detail
+
+/**
+ * pin the calling thread to one cpu.
+ * @return false where affinity isn't supported or the cpu is unavailable.
+ */
+inline bool pin_current_thread(int cpu) {
+#if defined(__linux__)
+  return detail::pin_thread(pthread_self(), cpu);
+#else
+  (void)cpu;
+  return false;
+#endif
+}
+
+/**
+ * pin a running thread to one cpu, from the thread that started it, so the
+ * outcome is known before it is used.
+ * @return false where affinity isn't supported or the cpu is unavailable.
+ */
+inline bool pin_thread(std::thread &thread, int cpu) {
+#if defined(__linux__)
+  return detail::pin_thread(thread.native_handle(), cpu);
+#else
+  (void)thread;
+  (void)cpu;
+  return false;
+#endif
+}
+
+/**
+ * pin threads[i] to cpus[i], warning about those that couldn't be.
+ * @return number of threads left unpinned.
+ */
+inline size_t pin_workers(std::vector<std::thread> &threads,
+                          const std::vector<int> &cpus) {
+  size_t failed = 0;
+  for (size_t i = 0; i < threads.size() && i < cpus.size(); i++) {
+    if (!pin_thread(threads[i], cpus[i])) failed++;
+  }
+  if (failed > 0) {
+    nn_warn("could not pin " + std::to_string(failed) + " of " +
+            std::to_string(threads.size()) + " threads");
+  }
+  return failed;
+}
+
+namespace detail {
+
+inline std::atomic<bool> &worker_affinity_flag() {
+  static std::atomic<bool> flag(false);
+  return flag;
+}
+
+}  // namespace detail
+
+/**
+ * opt in to pinning the workers of the built-in thread pool, placed by
+ * cpu_topology::detect(). takes effect for a pool started afterwards, i.e.
+ * call it before the first parallel_for.
+ */
+inline void set_worker_affinity(bool pin) {
+  detail::worker_affinity_flag().store(pin);
+}
+
+inline bool worker_affinity() { return detail::worker_affinity_flag().load(); }
+
+}  // namespace tiny_dnn